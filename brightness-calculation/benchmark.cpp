@@ -0,0 +1,151 @@
+/**
+ * @file benchmark.cpp
+ * @brief Micro-benchmarks for the brightness calculation kernels
+ *
+ * Measures:
+ * - The Color arithmetic chain used per light in calculateBrightness, once
+ *   through out-of-line (noinline) operators, which reproduces the former
+ *   layout with the operators in color.cpp, and once through the inline
+ *   constexpr operators from color.h
+ * - calculateBrightness called once per query from this translation unit;
+ *   without link-time optimisation every call is an opaque cross-TU call,
+ *   with the release-lto presets it can be inlined into the loop
+ * - End-to-end calculateBrightnessBatch throughput for every instruction
+ *   set variant the CPU supports
+ *
+ * Each measurement is repeated and the fastest run is reported.
+ *
+ * Usage: brightness-benchmark [query_count]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "vector3d.h"
+#include "color.h"
+#include "light.h"
+#include "material.h"
+#include "illumination.h"
+#include "cpu_dispatch.h"
+
+namespace {
+
+constexpr int kRepeats = 5;
+
+// Out-of-line copies of the Color operators, as they were compiled before
+[[gnu::noinline]] Color scaleOutOfLine(const Color& c, const double s) noexcept {
+    return {c.r * s, c.g * s, c.b * s};
+}
+
+[[gnu::noinline]] Color addOutOfLine(const Color& a, const Color& b) noexcept {
+    return {a.r + b.r, a.g + b.g, a.b + b.b};
+}
+
+[[gnu::noinline]] Color modulateOutOfLine(const Color& a, const Color& b) noexcept {
+    return {a.r * b.r, a.g * b.g, a.b * b.b};
+}
+
+// E * color * (diffuse + specular) * (1 / pi), summed over all inputs
+Color chainOutOfLine(const std::vector<Color>& E, const std::vector<double>& k, const Color& color) noexcept {
+    Color total;
+    for (std::size_t i = 0; i < E.size(); ++i) {
+        total = addOutOfLine(total, scaleOutOfLine(scaleOutOfLine(modulateOutOfLine(E[i], color), k[i]), 1.0 / M_PI));
+    }
+    return total;
+}
+
+Color chainInline(const std::vector<Color>& E, const std::vector<double>& k, const Color& color) noexcept {
+    Color total;
+    for (std::size_t i = 0; i < E.size(); ++i) {
+        total += E[i] * color * k[i] * (1.0 / M_PI);
+    }
+    return total;
+}
+
+// Fastest of kRepeats runs of f, in nanoseconds per item
+template <typename F>
+double bestNsPerItem(const std::size_t items, F&& f) {
+    double best = 1e300;
+    for (int r = 0; r < kRepeats; ++r) {
+        const auto start = std::chrono::steady_clock::now();
+        f();
+        const auto stop = std::chrono::steady_clock::now();
+        const double ns = std::chrono::duration<double, std::nano>(stop - start).count();
+        best = std::min(best, ns / static_cast<double>(items));
+    }
+    return best;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const long long requested = argc > 1 ? std::atoll(argv[1]) : 1000000;
+    if (requested <= 0) {
+        std::cerr << "Error: Query count must be positive.\n";
+        return 1;
+    }
+    const std::size_t count = static_cast<std::size_t>(requested);
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+    // Color chain inputs
+    std::vector<Color> E(count);
+    std::vector<double> k(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        E[i] = Color(unit(rng), unit(rng), unit(rng));
+        k[i] = unit(rng);
+    }
+    const Color materialColor(0.8, 0.6, 0.4);
+
+    Color sink;
+    const double outOfLineNs = bestNsPerItem(count, [&] { sink += chainOutOfLine(E, k, materialColor); });
+    const double inlineNs = bestNsPerItem(count, [&] { sink += chainInline(E, k, materialColor); });
+
+    // End-to-end brightness over a fixed scene with four lights
+    const std::vector<Light> lights = {
+        {Vector3D(1, 1, 1), Vector3D(0, 0, -1), Color(1, 1, 1)},
+        {Vector3D(-1, 1, 1), Vector3D(0, 0, -1), Color(2, 2, 2)},
+        {Vector3D(0, -1, 2), Vector3D(0, 0.5, -1), Color(1, 0.5, 0.2)},
+        {Vector3D(2, 2, 3), Vector3D(-1, -1, -1), Color(0.3, 0.3, 1)}
+    };
+    const Vector3D P0(0, 0, 0), P1(1, 0, 0), P2(0, 1, 0);
+    const Material material = {Color(1, 1, 1), 0.7, 0.3, 10.0};
+    std::vector<BrightnessQuery> queries(count);
+    for (auto& q : queries) {
+        q.x = unit(rng);
+        q.y = unit(rng) * (1.0 - q.x);
+        q.viewDir = Vector3D(unit(rng) - 0.5, unit(rng) - 0.5, 1.0);
+    }
+    std::vector<Color> brightness(count);
+    const double perCallNs = bestNsPerItem(count, [&] {
+        for (std::size_t i = 0; i < count; ++i) {
+            brightness[i] = calculateBrightness(lights, P0, P1, P2, queries[i].x, queries[i].y,
+                                                queries[i].viewDir, material);
+        }
+        sink += brightness[count / 2];
+    });
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Color chain, out-of-line operators: " << outOfLineNs << " ns/item\n";
+    std::cout << "Color chain, inline operators:      " << inlineNs << " ns/item\n";
+    std::cout << "calculateBrightness, one call per query (" << lights.size() << " lights): "
+              << perCallNs << " ns/query\n";
+
+    const IsaLevel detected = detectIsa();
+    for (int level = 0; level <= static_cast<int>(detected); ++level) {
+        forceIsa(static_cast<IsaLevel>(level));
+        const double batchNs = bestNsPerItem(count, [&] {
+            calculateBrightnessBatch(lights, P0, P1, P2, material, queries.data(), count, brightness.data());
+            sink += brightness[count / 2];
+        });
+        std::cout << "calculateBrightnessBatch [" << isaName(activeIsa()) << "] (" << lights.size()
+                  << " lights): " << batchNs << " ns/query\n";
+    }
+    std::cout << "(checksum " << std::setprecision(6) << sink.r + sink.g + sink.b << ")\n";
+    return 0;
+}
@@ -0,0 +1,60 @@
+# Verify that the brightness kernels contain no out-of-line operator calls.
+#
+# Usage: cmake -DOBJDUMP=<objdump> -DBINARY=<executable> -P check_inlining.cmake
+#
+# Disassembles the kernels in BINARY and fails if any of them calls anything
+# but the libm functions sqrt and pow or another kernel. An operator that is
+# not inlined shows up as a call (returning its Vector3D or Color temporary
+# through memory), so a clean listing means every operator chain was fused.
+
+set(kernels
+    "calculateBrightness\\("
+    "calculateIllumination\\("
+    "\\(anonymous namespace\\)::brightnessBatch(Baseline|Sse4|Avx2|Avx512)\\("
+)
+set(allowed "<(sqrt|pow)(@plt)?>")
+
+if(NOT OBJDUMP OR NOT BINARY)
+    message(FATAL_ERROR "Usage: cmake -DOBJDUMP=<objdump> -DBINARY=<executable> -P check_inlining.cmake")
+endif()
+
+execute_process(
+    COMMAND ${OBJDUMP} -d -C --no-show-raw-insn ${BINARY}
+    OUTPUT_VARIABLE listing
+    RESULT_VARIABLE status
+)
+if(NOT status EQUAL 0)
+    message(FATAL_ERROR "${OBJDUMP} failed on ${BINARY}")
+endif()
+
+string(REPLACE ";" "\\;" listing "${listing}")
+string(REPLACE "\n" ";" lines "${listing}")
+
+list(JOIN kernels "|" kernel_pattern)
+
+set(current "")
+set(checked 0)
+set(failures "")
+foreach(line IN LISTS lines)
+    if(line MATCHES "^[0-9a-f]+ <(.*)>:$")
+        set(current "")
+        if(CMAKE_MATCH_1 MATCHES "^(${kernel_pattern})")
+            set(current "${CMAKE_MATCH_0}")
+            math(EXPR checked "${checked} + 1")
+        endif()
+    elseif(current AND line MATCHES "\tcall")
+        if(NOT line MATCHES "${allowed}" AND NOT line MATCHES "<(${kernel_pattern})")
+            string(STRIP "${line}" line)
+            list(APPEND failures "${current}...: ${line}")
+        endif()
+    endif()
+endforeach()
+
+if(checked EQUAL 0)
+    message(FATAL_ERROR "No brightness kernels found in ${BINARY}")
+endif()
+if(failures)
+    list(JOIN failures "\n  " report)
+    message(FATAL_ERROR "Out-of-line calls in the brightness kernels:\n  ${report}")
+endif()
+message(STATUS "${checked} brightness kernels checked: no out-of-line operator calls")
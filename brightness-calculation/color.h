@@ -6,6 +6,10 @@
  * 
  * Represents colors in RGB color space with double precision
  * for accurate lighting calculations.
+ *
+ * All operators are constexpr and defined inline, so chains such as
+ * E * color * k * (1.0 / M_PI) compile into straight-line arithmetic with
+ * the intermediate colors kept in registers.
  */
 class Color {
 public:
@@ -17,35 +21,47 @@ public:
      * @param g_ Green component (default: 0.0)
      * @param b_ Blue component (default: 0.0)
      */
-    Color(double r_ = 0.0, double g_ = 0.0, double b_ = 0.0) noexcept;
+    constexpr Color(double r_ = 0.0, double g_ = 0.0, double b_ = 0.0) noexcept
+        : r(r_), g(g_), b(b_) {}
 
     /**
      * @brief Multiply color by a scalar (brightness adjustment)
      * @param scalar Multiplication factor
      * @return Scaled color
      */
-    Color operator*(double scalar) const noexcept;
+    constexpr Color operator*(double scalar) const noexcept {
+        return {r * scalar, g * scalar, b * scalar};
+    }
 
     /**
      * @brief Add two colors (color blending)
      * @param other Color to add
      * @return Sum of colors
      */
-    Color operator+(const Color& other) const noexcept;
+    constexpr Color operator+(const Color& other) const noexcept {
+        return {r + other.r, g + other.g, b + other.b};
+    }
 
     /**
      * @brief Multiply two colors component-wise (color modulation)
      * @param other Color to multiply with
      * @return Component-wise product
      */
-    Color operator*(const Color& other) const noexcept;
+    constexpr Color operator*(const Color& other) const noexcept {
+        return {r * other.r, g * other.g, b * other.b};
+    }
     
     /**
      * @brief Add and assign another color to this color
      * @param other Color to add
      * @return Reference to this color after addition
      */
-    Color& operator+=(const Color& other) noexcept;
+    constexpr Color& operator+=(const Color& other) noexcept {
+        r += other.r;
+        g += other.g;
+        b += other.b;
+        return *this;
+    }
 };
 
 #endif // COLOR_H
\ No newline at end of file
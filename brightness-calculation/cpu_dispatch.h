@@ -0,0 +1,99 @@
+#ifndef CPU_DISPATCH_H
+#define CPU_DISPATCH_H
+
+#include <array>
+#include <cstddef>
+
+/**
+ * @brief Instruction set levels for which kernels are compiled
+ *
+ * Ordered from least to most capable; a CPU supporting a level supports
+ * every level below it. The AVX2 and AVX-512 variants may contract
+ * multiply-adds into FMA instructions, so their results can differ from
+ * the baseline in the last bit.
+ */
+enum class IsaLevel : int {
+    Baseline = 0, ///< Compiler default (SSE2 on x86-64)
+    SSE4 = 1,     ///< SSE4.2 + POPCNT
+    AVX2 = 2,     ///< AVX2 + FMA
+    AVX512 = 3    ///< AVX-512 F/VL/DQ/BW
+};
+
+/**
+ * @brief Detect the best instruction set level supported by this CPU
+ */
+IsaLevel detectIsa() noexcept;
+
+/**
+ * @brief Instruction set level used by dispatched kernels
+ *
+ * Determined once on first use: the detected level, or the level named by
+ * the FORCE_ISA environment variable (baseline, sse4, avx2, avx512) when
+ * set. A forced level is never raised above what the CPU supports.
+ */
+IsaLevel activeIsa() noexcept;
+
+/**
+ * @brief Force dispatched kernels to a specific level (e.g. for testing)
+ * @param level Requested level
+ * @return false if the CPU does not support the level (the best supported
+ *         level below it is used instead)
+ */
+bool forceIsa(IsaLevel level) noexcept;
+
+/**
+ * @brief Human-readable name of a level ("baseline", "sse4", "avx2", "avx512")
+ */
+const char* isaName(IsaLevel level) noexcept;
+
+/**
+ * @brief Parse a level name as accepted by FORCE_ISA
+ * @param name Level name
+ * @param level Receives the parsed level
+ * @return false if the name is unknown
+ */
+bool parseIsa(const char* name, IsaLevel& level) noexcept;
+
+// Target attributes for kernel variants; only GCC/Clang on x86-64 get real variants
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CPU_DISPATCH_X86 1
+#define TARGET_SSE4 __attribute__((target("sse4.2,popcnt")))
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define TARGET_AVX512 __attribute__((target("avx512f,avx512vl,avx512dq,avx512bw,avx2,fma")))
+#define KERNEL_INLINE inline __attribute__((always_inline))
+#else
+#define CPU_DISPATCH_X86 0
+#define KERNEL_INLINE inline
+#endif
+
+/**
+ * @brief Function pointers to the variants of one kernel, indexed by IsaLevel
+ *
+ * select() returns the variant for the active level, falling back to lower
+ * levels for variants that were not provided (nullptr).
+ *
+ * @tparam Fn Function pointer type of the kernel
+ */
+template <typename Fn>
+class DispatchTable {
+public:
+    constexpr DispatchTable(Fn baseline, Fn sse4, Fn avx2, Fn avx512) noexcept
+        : variants_{baseline, sse4, avx2, avx512} {}
+
+    /**
+     * @brief Variant for the active instruction set level
+     */
+    Fn select() const noexcept {
+        for (int level = static_cast<int>(activeIsa()); level > 0; --level) {
+            if (variants_[static_cast<std::size_t>(level)]) {
+                return variants_[static_cast<std::size_t>(level)];
+            }
+        }
+        return variants_[0];
+    }
+
+private:
+    std::array<Fn, 4> variants_;
+};
+
+#endif // CPU_DISPATCH_H
@@ -1,6 +1,7 @@
 #include "illumination.h"
 #include <cmath>
 #include <algorithm>
+#include "cpu_dispatch.h"
 
 /**
  * Helper function to check if a point and reference are on the same side of a plane.
@@ -97,4 +98,116 @@ Color calculateBrightness(const std::vector<Light>& lights,
     }
 
     return totalBrightness;
+}
+
+namespace {
+
+/**
+ * Batch brightness kernel body, compiled once per instruction set.
+ * Follows calculateBrightness exactly, but the triangle edges, the surface
+ * normal and the normalized light directions are computed once per batch
+ * instead of once per query and light.
+ */
+KERNEL_INLINE void brightnessBatchBody(const std::vector<Light>& lights,
+                                       const Vector3D& P0, const Vector3D& P1, const Vector3D& P2,
+                                       const Material& material,
+                                       const BrightnessQuery* queries, const std::size_t count,
+                                       const Vector3D* lightDirs, Color* brightness) noexcept {
+    const Vector3D edge1 = (P1 - P0).normalized();
+    const Vector3D edge2 = (P2 - P0).normalized();
+    const Vector3D N = (P2 - P0).cross(P1 - P0).normalized();
+
+    for (std::size_t i = 0; i < count; ++i) {
+        const Vector3D& viewDir = queries[i].viewDir;
+        const Vector3D PT = P0 + edge1 * queries[i].x + edge2 * queries[i].y;
+        const Vector3D viewN = viewDir.dot(N) < 0 ? N * -1.0 : N;
+
+        Color totalBrightness;
+        for (std::size_t l = 0; l < lights.size(); ++l) {
+            const Light& light = lights[l];
+
+            // Illumination, as in calculateIllumination
+            Color E;
+            const double dotPoint = (light.position - PT).dot(N);
+            const double dotRef = (viewDir - PT).dot(N);
+            if (dotPoint * dotRef > 0) {
+                const Vector3D s_vec = PT - light.position;
+                const double R2 = s_vec.norm() * s_vec.norm();
+                const Vector3D s_normalized = s_vec.normalized();
+                const double cos_alpha = std::max(0.0, s_normalized.dot(N));
+                const double cos_theta = std::max(0.0, s_normalized.dot(lightDirs[l]));
+                E = light.intensity * (cos_theta * cos_alpha / R2);
+            }
+
+            // Diffuse and Blinn-Phong specular terms
+            const Vector3D s = (light.position - PT).normalized();
+            const Vector3D h = (viewDir + s).normalized();
+            const double specular = material.specular * std::pow(std::max(0.0, h.dot(viewN)), material.exponent);
+            totalBrightness += E * material.color * (material.diffuse + specular) * (1.0 / M_PI);
+        }
+        brightness[i] = totalBrightness;
+    }
+}
+
+using BrightnessBatchFn = void (*)(const std::vector<Light>&, const Vector3D&, const Vector3D&, const Vector3D&,
+                                   const Material&, const BrightnessQuery*, std::size_t,
+                                   const Vector3D*, Color*) noexcept;
+
+void brightnessBatchBaseline(const std::vector<Light>& lights,
+                             const Vector3D& P0, const Vector3D& P1, const Vector3D& P2,
+                             const Material& material, const BrightnessQuery* queries, const std::size_t count,
+                             const Vector3D* lightDirs, Color* brightness) noexcept {
+    brightnessBatchBody(lights, P0, P1, P2, material, queries, count, lightDirs, brightness);
+}
+
+#if CPU_DISPATCH_X86
+TARGET_SSE4 void brightnessBatchSse4(const std::vector<Light>& lights,
+                                     const Vector3D& P0, const Vector3D& P1, const Vector3D& P2,
+                                     const Material& material, const BrightnessQuery* queries,
+                                     const std::size_t count, const Vector3D* lightDirs,
+                                     Color* brightness) noexcept {
+    brightnessBatchBody(lights, P0, P1, P2, material, queries, count, lightDirs, brightness);
+}
+
+TARGET_AVX2 void brightnessBatchAvx2(const std::vector<Light>& lights,
+                                     const Vector3D& P0, const Vector3D& P1, const Vector3D& P2,
+                                     const Material& material, const BrightnessQuery* queries,
+                                     const std::size_t count, const Vector3D* lightDirs,
+                                     Color* brightness) noexcept {
+    brightnessBatchBody(lights, P0, P1, P2, material, queries, count, lightDirs, brightness);
+}
+
+TARGET_AVX512 void brightnessBatchAvx512(const std::vector<Light>& lights,
+                                         const Vector3D& P0, const Vector3D& P1, const Vector3D& P2,
+                                         const Material& material, const BrightnessQuery* queries,
+                                         const std::size_t count, const Vector3D* lightDirs,
+                                         Color* brightness) noexcept {
+    brightnessBatchBody(lights, P0, P1, P2, material, queries, count, lightDirs, brightness);
+}
+
+constexpr DispatchTable<BrightnessBatchFn> kBrightnessBatch{
+    brightnessBatchBaseline, brightnessBatchSse4, brightnessBatchAvx2, brightnessBatchAvx512};
+#else
+constexpr DispatchTable<BrightnessBatchFn> kBrightnessBatch{
+    brightnessBatchBaseline, nullptr, nullptr, nullptr};
+#endif
+
+} // namespace
+
+/**
+ * Calculate brightness for a batch of queries sharing lights, triangle and material.
+ * Dispatched to the best kernel variant for this CPU.
+ */
+void calculateBrightnessBatch(const std::vector<Light>& lights,
+                              const Vector3D& P0, const Vector3D& P1, const Vector3D& P2,
+                              const Material& material,
+                              const BrightnessQuery* queries, const std::size_t count,
+                              Color* brightness) noexcept {
+    // Light directions are normalized once for the whole batch
+    std::vector<Vector3D> lightDirs;
+    lightDirs.reserve(lights.size());
+    for (const auto& light : lights) {
+        lightDirs.push_back(light.direction.normalized());
+    }
+    kBrightnessBatch.select()(lights, P0, P1, P2, material, queries, count, lightDirs.data(), brightness);
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #ifndef ILLUMINATION_H
 #define ILLUMINATION_H
 
+#include <cstddef>
 #include <vector>
 #include "vector3d.h"
 #include "color.h"
@@ -63,4 +64,37 @@ Color calculateBrightness(const std::vector<Light>& lights,
                          double x, double y, const Vector3D& viewDir,
                          const Material& material) noexcept;
 
+/**
+ * @brief One brightness query: a point on the triangle and a view direction
+ */
+class BrightnessQuery {
+public:
+    double x = 0.0;   ///< Local coordinate along edge P0->P1
+    double y = 0.0;   ///< Local coordinate along edge P0->P2
+    Vector3D viewDir; ///< View direction vector
+};
+
+/**
+ * @brief Calculate brightness for a batch of queries on the same surface
+ *
+ * Evaluates calculateBrightness for every query with a shared set of
+ * lights, triangle and material. Surface and light invariants are computed
+ * once per batch, and the kernel is compiled for several instruction sets
+ * with the best one selected at runtime (see cpu_dispatch.h).
+ *
+ * @param lights Vector of light sources
+ * @param P0 First vertex of the triangle
+ * @param P1 Second vertex of the triangle
+ * @param P2 Third vertex of the triangle
+ * @param material Material properties of the surface
+ * @param queries Array of queries
+ * @param count Number of queries
+ * @param brightness Output array receiving the RGB brightness per query
+ */
+void calculateBrightnessBatch(const std::vector<Light>& lights,
+                              const Vector3D& P0, const Vector3D& P1, const Vector3D& P2,
+                              const Material& material,
+                              const BrightnessQuery* queries, std::size_t count,
+                              Color* brightness) noexcept;
+
 #endif // ILLUMINATION_H
\ No newline at end of file
@@ -11,40 +11,50 @@
  * - Triangle vertices: P0, P1, P2 coordinates
  * - Material properties: color (r,g,b), diffuse coefficient, specular coefficient, exponent
  * - Query point: local coordinates (x,y) and view direction (dx,dy,dz)
+ *
+ * Streaming mode:
+ *   brightness-calculation --stream [input]
+ * reads the same layout from a file (or stdin when omitted or '-'), but any
+ * number of query points may follow the material line. Queries are parsed,
+ * evaluated and printed by overlapping pipeline stages in constant memory.
+ * Degenerate queries are rejected by a validation pre-pass (see
+ * validation.h), print as black and are summarised on stderr.
  */
 
 #include <iostream>
 #include <fstream>
 #include <vector>
 #include <iomanip>
+#include <exception>
+#include <string>
 #include "vector3d.h"
 #include "color.h"
 #include "light.h"
 #include "material.h"
 #include "illumination.h"
+#include "pipeline.h"
+#include "query_stream.h"
+#include "validation.h"
 
-int main() {
-    // Open input file
-    std::ifstream inputFile("input.txt");
-    if (!inputFile) {
-        std::cerr << "Error: Failed to open 'input.txt'.\n";
-        return 1;
-    }
-
+/**
+ * @brief Read light sources, triangle and material from an input stream
+ * @return false (after printing the error) if any section is malformed
+ */
+bool readScene(std::istream& inputFile, std::vector<Light>& lights,
+               Vector3D& P0, Vector3D& P1, Vector3D& P2, Material& material) {
     // Read number of light sources
     int lightCount = 0;
     if (!(inputFile >> lightCount) || lightCount <= 0) {
         std::cerr << "Error: Invalid number of light sources.\n";
-        return 1;
+        return false;
     }
 
     // Read light source data
-    std::vector<Light> lights;
     for (int i = 0; i < lightCount; ++i) {
         double lx, ly, lz, ldx, ldy, ldz, lr, lg, lb;
         if (!(inputFile >> lx >> ly >> lz >> ldx >> ldy >> ldz >> lr >> lg >> lb)) {
             std::cerr << "Error: Invalid data for light source #" << i + 1 << ".\n";
-            return 1;
+            return false;
         }
 
         lights.push_back({
@@ -55,12 +65,11 @@ int main() {
     }
 
     // Read triangle vertices
-    Vector3D P0, P1, P2;
     if (!(inputFile >> P0.x >> P0.y >> P0.z
                    >> P1.x >> P1.y >> P1.z
                    >> P2.x >> P2.y >> P2.z)) {
         std::cerr << "Error: Invalid triangle coordinates.\n";
-        return 1;
+        return false;
     }
 
     // Read material properties
@@ -68,10 +77,101 @@ int main() {
     double kd, ks, ke;
     if (!(inputFile >> color.r >> color.g >> color.b >> kd >> ks >> ke)) {
         std::cerr << "Error: Invalid material parameters.\n";
+        return false;
+    }
+
+    material = {color, kd, ks, ke};
+    return true;
+}
+
+/**
+ * @brief Evaluate an unbounded stream of queries against one scene
+ * @param inputPath Input file, or "-" for stdin
+ * @return Process exit code
+ */
+int runStream(const std::string& inputPath) {
+    std::ifstream inputFile;
+    if (inputPath != "-") {
+        inputFile.open(inputPath);
+        if (!inputFile) {
+            std::cerr << "Error: Failed to open '" << inputPath << "'.\n";
+            return 1;
+        }
+    }
+    std::istream& in = inputPath == "-" ? std::cin : inputFile;
+
+    std::vector<Light> lights;
+    Vector3D P0, P1, P2;
+    Material material{};
+    if (!readScene(in, lights, P0, P1, P2, material)) {
         return 1;
     }
 
-    Material material = {color, kd, ks, ke};
+    // reader -> batcher -> evaluator -> writer with bounded queues in between
+    constexpr std::size_t chunkSize = 1024;
+    std::string error;
+    BrightnessWriter writer(stdout);
+    ValidationReport report; // Only touched by the evaluator stage
+    try {
+        runPipeline(
+            batched(readBrightnessQueries(in, error), chunkSize),
+            [&](const std::vector<BrightnessQuery>& queries) {
+                std::vector<Color> brightness(queries.size());
+                calculateBrightnessBatchValidated(lights, P0, P1, P2, material, queries.data(), queries.size(),
+                                                  brightness.data(), report);
+                return brightness;
+            },
+            [&writer](const std::vector<Color>& brightness) {
+                writer.write(brightness);
+            });
+    } catch (const std::exception& e) {
+        writer.flush();
+        std::cerr << "Error: " << e.what() << ".\n";
+        return 1;
+    }
+
+    if (!writer.flush()) {
+        std::cerr << "Error: Failed to write results.\n";
+        return 1;
+    }
+    if (!error.empty()) {
+        std::cerr << "Error: " << error << ".\n";
+        return 1;
+    }
+    if (report.rejected != 0) {
+        std::cerr << "Warning: " << report.rejected << " of " << report.checked
+                  << " queries rejected and written as black (" << report.nonFinite << " non-finite, "
+                  << report.degenerateTriangles << " degenerate triangles, " << report.zeroDirections
+                  << " zero directions, " << report.coincidentLights << " coincident lights, "
+                  << report.invalidMaterials << " invalid materials).\n";
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1) {
+        const std::string mode = argv[1];
+        if (mode == "--stream" && argc <= 3) {
+            return runStream(argc == 3 ? argv[2] : "-");
+        }
+        std::cerr << "Usage: " << argv[0] << " [--stream [input]]\n";
+        return 1;
+    }
+
+    // Open input file
+    std::ifstream inputFile("input.txt");
+    if (!inputFile) {
+        std::cerr << "Error: Failed to open 'input.txt'.\n";
+        return 1;
+    }
+
+    // Read light sources, triangle and material
+    std::vector<Light> lights;
+    Vector3D P0, P1, P2;
+    Material material{};
+    if (!readScene(inputFile, lights, P0, P1, P2, material)) {
+        return 1;
+    }
 
     // Read query point and view direction
     double x, y;
@@ -81,6 +181,13 @@ int main() {
         return 1;
     }
 
+    // Reject input the shading model is undefined for
+    const std::uint8_t defects = classifyQuery(lights, P0, P1, P2, material, {x, y, viewDir});
+    if (defects != DefectNone) {
+        std::cerr << "Error: Invalid input (" << describeDefect(defects) << ").\n";
+        return 1;
+    }
+
     // Calculate brightness at the specified point
     Color brightness = calculateBrightness(lights, P0, P1, P2, x, y, viewDir, material);
 
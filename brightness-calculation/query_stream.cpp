@@ -0,0 +1,68 @@
+#include "query_stream.h"
+#include <charconv>
+
+namespace {
+
+// Size of the output buffer
+constexpr std::size_t kBufferSize = 1 << 20;
+
+// Longest line for one result: three fixed-point numbers plus separators
+constexpr std::size_t kMaxLine = 3 * 348 + 3;
+
+} // namespace
+
+// Read five numbers per query until the stream ends
+Generator<BrightnessQuery> readBrightnessQueries(std::istream& in, std::string& error) {
+    std::size_t index = 0;
+    for (;;) {
+        BrightnessQuery query;
+        if (!(in >> query.x)) {
+            break;
+        }
+        ++index;
+        if (!(in >> query.y >> query.viewDir.x >> query.viewDir.y >> query.viewDir.z)) {
+            error = "Invalid point or view direction data in query #" + std::to_string(index);
+            break;
+        }
+        co_yield query;
+    }
+    if (error.empty() && !in.eof()) {
+        error = "Invalid point or view direction data in query #" + std::to_string(index + 1);
+    }
+}
+
+// Allocate the output buffer
+BrightnessWriter::BrightnessWriter(std::FILE* stream)
+    : stream_(stream), buffer_(kBufferSize) {}
+
+BrightnessWriter::~BrightnessWriter() {
+    flush();
+}
+
+// Format results with std::to_chars, flushing whenever the buffer runs low
+void BrightnessWriter::write(const std::vector<Color>& brightness) {
+    for (const Color& c : brightness) {
+        if (buffer_.size() - size_ < kMaxLine) {
+            flush();
+        }
+        char* out = buffer_.data() + size_;
+        char* const last = buffer_.data() + buffer_.size();
+        out = std::to_chars(out, last, c.r, std::chars_format::fixed, 6).ptr;
+        *out++ = ' ';
+        out = std::to_chars(out, last, c.g, std::chars_format::fixed, 6).ptr;
+        *out++ = ' ';
+        out = std::to_chars(out, last, c.b, std::chars_format::fixed, 6).ptr;
+        *out++ = '\n';
+        size_ = static_cast<std::size_t>(out - buffer_.data());
+    }
+}
+
+// Hand the buffered bytes to the stream
+bool BrightnessWriter::flush() {
+    bool ok = true;
+    if (size_ > 0) {
+        ok = std::fwrite(buffer_.data(), 1, size_, stream_) == size_;
+        size_ = 0;
+    }
+    return ok && std::fflush(stream_) == 0;
+}
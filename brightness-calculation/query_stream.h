@@ -0,0 +1,62 @@
+#ifndef QUERY_STREAM_H
+#define QUERY_STREAM_H
+
+#include <cstdio>
+#include <istream>
+#include <string>
+#include <vector>
+#include "color.h"
+#include "illumination.h"
+#include "pipeline.h"
+
+/**
+ * @brief Pipeline source stage: parse brightness queries from a stream
+ *
+ * Each query is five numbers: local coordinates x y followed by the view
+ * direction (x y z). The coroutine suspends after every query, so the
+ * stream may be arbitrarily long.
+ *
+ * @param in Input stream (must outlive the generator)
+ * @param error Receives a description if the stream ends in a malformed query
+ * @return Generator of queries
+ */
+Generator<BrightnessQuery> readBrightnessQueries(std::istream& in, std::string& error);
+
+/**
+ * @brief Buffered writer of brightness results
+ *
+ * Formats "R G B" lines with six decimals (as in the single-query output)
+ * into a private buffer and writes it to the stream in large blocks.
+ */
+class BrightnessWriter {
+public:
+    /**
+     * @brief Create a writer
+     * @param stream Open output stream (not owned)
+     */
+    explicit BrightnessWriter(std::FILE* stream);
+
+    /**
+     * @brief Flush remaining output
+     */
+    ~BrightnessWriter();
+
+    /**
+     * @brief Append results to the output
+     * @param brightness Results in query order
+     */
+    void write(const std::vector<Color>& brightness);
+
+    /**
+     * @brief Write buffered output to the stream
+     * @return false if the stream reported an error
+     */
+    bool flush();
+
+private:
+    std::FILE* stream_;
+    std::vector<char> buffer_;
+    std::size_t size_ = 0;
+};
+
+#endif // QUERY_STREAM_H
@@ -0,0 +1,177 @@
+#include "validation.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace {
+
+// Relative tolerances of the degeneracy tests
+constexpr double kMinSine = 1e-9;
+constexpr double kCoincidence = 1e-9;
+
+// Queries validated and evaluated together, so the block stays in cache
+constexpr std::size_t kBlock = 256;
+
+// x - x is 0 for every finite x and NaN for NaN and infinity; the sums
+// below are 0 unless some input is not finite, and cannot overflow
+double difference(const double x) noexcept {
+    return x - x;
+}
+
+double difference(const Vector3D& v) noexcept {
+    return (v.x - v.x) + (v.y - v.y) + (v.z - v.z);
+}
+
+double difference(const Color& c) noexcept {
+    return (c.r - c.r) + (c.g - c.g) + (c.b - c.b);
+}
+
+} // namespace
+
+void ValidationReport::add(const std::uint8_t defects) noexcept {
+    ++checked;
+    rejected += defects != DefectNone;
+    nonFinite += (defects & DefectNonFinite) != 0;
+    degenerateTriangles += (defects & DefectDegenerateTriangle) != 0;
+    zeroDirections += (defects & DefectZeroDirection) != 0;
+    coincidentLights += (defects & DefectCoincidentLight) != 0;
+    invalidMaterials += (defects & DefectInvalidMaterial) != 0;
+}
+
+// Written without early exits, like the illuminance validation: every test
+// runs and the flags are combined at the end. Squared quantities are
+// compared so no square root or division is needed
+std::uint8_t classifySurface(const std::vector<Light>& lights,
+                             const Vector3D& P0, const Vector3D& P1, const Vector3D& P2,
+                             const Material& material) noexcept {
+    double zero = difference(P0) + difference(P1) + difference(P2);
+    bool zeroDirection = false;
+    for (const auto& light : lights) {
+        zero += difference(light.position) + difference(light.direction) + difference(light.intensity);
+        zeroDirection |= !(light.direction.dot(light.direction) > 0.0);
+    }
+    zero += difference(material.color) + difference(material.diffuse) + difference(material.specular) +
+            difference(material.exponent);
+    const bool nonFinite = !(zero == 0.0);
+    const bool negative = !(std::min({material.color.r, material.color.g, material.color.b, material.diffuse,
+                                      material.specular, material.exponent}) >= 0.0);
+
+    const Vector3D e1 = P1 - P0;
+    const Vector3D e2 = P2 - P0;
+    const Vector3D c = e2.cross(e1);
+    const double l1 = e1.dot(e1);
+    const double l2 = e2.dot(e2);
+    const bool degenerate = !(l1 > 0.0) | !(l2 > 0.0) | !(c.dot(c) > kMinSine * kMinSine * l1 * l2);
+
+    // A non-finite surface only reports that reason
+    const bool finite = !nonFinite;
+    return static_cast<std::uint8_t>(nonFinite * DefectNonFinite | (finite & zeroDirection) * DefectZeroDirection |
+                                     (finite & degenerate) * DefectDegenerateTriangle |
+                                     (finite & negative) * DefectInvalidMaterial);
+}
+
+namespace {
+
+// Per-query checks once the surface is known to be valid, without early exits
+std::uint8_t pointDefects(const std::vector<Light>& lights, const Vector3D& P0,
+                          const Vector3D& edge1, const Vector3D& edge2, const BrightnessQuery& query) noexcept {
+    const bool nonFinite = !(difference(query.x) + difference(query.y) + difference(query.viewDir) == 0.0);
+    const bool zeroDirection = !(query.viewDir.dot(query.viewDir) > 0.0);
+    const Vector3D PT = P0 + edge1 * query.x + edge2 * query.y;
+    bool coincident = false;
+    for (const auto& light : lights) {
+        const Vector3D s = PT - light.position;
+        const double tolerance2 = kCoincidence * kCoincidence * (1.0 + light.position.dot(light.position));
+        coincident |= !(s.dot(s) > tolerance2);
+    }
+
+    // A non-finite query only reports that reason
+    const bool finite = !nonFinite;
+    return static_cast<std::uint8_t>(nonFinite * DefectNonFinite | (finite & zeroDirection) * DefectZeroDirection |
+                                     (finite & coincident) * DefectCoincidentLight);
+}
+
+} // namespace
+
+std::uint8_t classifyQuery(const std::vector<Light>& lights,
+                           const Vector3D& P0, const Vector3D& P1, const Vector3D& P2,
+                           const Material& material, const BrightnessQuery& query) noexcept {
+    // The point on the triangle is undefined for a non-finite or degenerate surface
+    const std::uint8_t surface = classifySurface(lights, P0, P1, P2, material);
+    const bool pointDefined = !(surface & (DefectNonFinite | DefectDegenerateTriangle));
+    return static_cast<std::uint8_t>(
+        surface | pointDefined * pointDefects(lights, P0, (P1 - P0).normalized(), (P2 - P0).normalized(), query));
+}
+
+const char* describeDefect(const std::uint8_t defects) noexcept {
+    if (defects & DefectNonFinite) {
+        return "non-finite input";
+    }
+    if (defects & DefectDegenerateTriangle) {
+        return "degenerate triangle";
+    }
+    if (defects & DefectZeroDirection) {
+        return "zero direction";
+    }
+    if (defects & DefectCoincidentLight) {
+        return "light coincides with the point";
+    }
+    if (defects & DefectInvalidMaterial) {
+        return "negative material color or coefficient";
+    }
+    return "valid";
+}
+
+// Surface checks run once per batch, point checks once per query
+std::size_t validateQueries(const std::vector<Light>& lights,
+                            const Vector3D& P0, const Vector3D& P1, const Vector3D& P2,
+                            const Material& material, const BrightnessQuery* queries, const std::size_t count,
+                            std::uint8_t* defects, ValidationReport& report) noexcept {
+    const std::uint8_t surface = classifySurface(lights, P0, P1, P2, material);
+    const bool pointDefined = !(surface & (DefectNonFinite | DefectDegenerateTriangle));
+    const Vector3D edge1 = (P1 - P0).normalized();
+    const Vector3D edge2 = (P2 - P0).normalized();
+
+    std::size_t valid = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        defects[i] = static_cast<std::uint8_t>(
+            surface | pointDefined * pointDefects(lights, P0, edge1, edge2, queries[i]));
+        report.add(defects[i]);
+        valid += defects[i] == DefectNone;
+    }
+    return valid;
+}
+
+// Classify, compact and evaluate one block at a time while it is in cache,
+// and scatter the results back. An all-valid block goes to the kernel in place
+void calculateBrightnessBatchValidated(const std::vector<Light>& lights,
+                                       const Vector3D& P0, const Vector3D& P1, const Vector3D& P2,
+                                       const Material& material,
+                                       const BrightnessQuery* queries, const std::size_t count,
+                                       Color* brightness, ValidationReport& report) {
+    std::array<std::uint8_t, kBlock> defects;
+    std::vector<BrightnessQuery> accepted(std::min(count, kBlock));
+    std::vector<Color> results(accepted.size());
+    for (std::size_t begin = 0; begin < count; begin += kBlock) {
+        const std::size_t size = std::min(kBlock, count - begin);
+        const BrightnessQuery* block = queries + begin;
+        const std::size_t valid = validateQueries(lights, P0, P1, P2, material, block, size, defects.data(), report);
+        if (valid == size) {
+            calculateBrightnessBatch(lights, P0, P1, P2, material, block, size, brightness + begin);
+            continue;
+        }
+
+        std::size_t next = 0;
+        for (std::size_t i = 0; i < size; ++i) {
+            if (defects[i] == DefectNone) {
+                accepted[next++] = block[i];
+            }
+        }
+        calculateBrightnessBatch(lights, P0, P1, P2, material, accepted.data(), valid, results.data());
+
+        next = 0;
+        for (std::size_t i = 0; i < size; ++i) {
+            brightness[begin + i] = defects[i] == DefectNone ? results[next++] : Color();
+        }
+    }
+}
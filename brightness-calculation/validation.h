@@ -0,0 +1,112 @@
+#ifndef VALIDATION_H
+#define VALIDATION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "vector3d.h"
+#include "color.h"
+#include "light.h"
+#include "material.h"
+#include "illumination.h"
+
+/**
+ * @brief Reasons a query is rejected by validation (bit flags)
+ *
+ * Each of these makes calculateBrightness divide by zero or return
+ * NaN/infinity, or leaves the shading direction undefined.
+ */
+enum QueryDefect : std::uint8_t {
+    DefectNone = 0,
+    DefectNonFinite = 1 << 0,          ///< An input is NaN or infinite
+    DefectDegenerateTriangle = 1 << 1, ///< Zero-length edge or collinear vertices
+    DefectZeroDirection = 1 << 2,      ///< A light direction or the view direction is the zero vector
+    DefectCoincidentLight = 1 << 3,    ///< The point on the triangle coincides with a light
+    DefectInvalidMaterial = 1 << 4     ///< A material color or coefficient is negative
+};
+
+/**
+ * @brief Counts of rejected queries by defect
+ *
+ * A query with several defects is counted once per defect but only once
+ * in rejected.
+ */
+class ValidationReport {
+public:
+    std::size_t checked = 0;             ///< Queries classified
+    std::size_t rejected = 0;            ///< Queries with at least one defect
+    std::size_t nonFinite = 0;           ///< Queries with DefectNonFinite
+    std::size_t degenerateTriangles = 0; ///< Queries with DefectDegenerateTriangle
+    std::size_t zeroDirections = 0;      ///< Queries with DefectZeroDirection
+    std::size_t coincidentLights = 0;    ///< Queries with DefectCoincidentLight
+    std::size_t invalidMaterials = 0;    ///< Queries with DefectInvalidMaterial
+
+    /**
+     * @brief Count one classified query
+     * @param defects QueryDefect flags of the query
+     */
+    void add(std::uint8_t defects) noexcept;
+};
+
+/**
+ * @brief Classify the inputs shared by all queries of a batch
+ *
+ * Checks the triangle (the sine of the angle at P0 must exceed 1e-9),
+ * every light for non-finite values and zero directions, and the material
+ * for non-finite or negative colors and coefficients (a negative exponent
+ * makes the specular term infinite where it is zero).
+ *
+ * @return QueryDefect flags, DefectNone for a valid surface
+ */
+std::uint8_t classifySurface(const std::vector<Light>& lights,
+                             const Vector3D& P0, const Vector3D& P1, const Vector3D& P2,
+                             const Material& material) noexcept;
+
+/**
+ * @brief Classify one query, including the flags of its surface
+ *
+ * A light counts as coincident with the point when their distance is below
+ * 1e-9 * sqrt(1 + |position|^2), i.e. within rounding of the scene
+ * coordinates.
+ *
+ * @return QueryDefect flags, DefectNone for a valid query
+ */
+std::uint8_t classifyQuery(const std::vector<Light>& lights,
+                           const Vector3D& P0, const Vector3D& P1, const Vector3D& P2,
+                           const Material& material, const BrightnessQuery& query) noexcept;
+
+/**
+ * @brief Human-readable description of the first defect in a set of flags
+ * @param defects QueryDefect flags
+ * @return Description such as "degenerate triangle", or "valid"
+ */
+const char* describeDefect(std::uint8_t defects) noexcept;
+
+/**
+ * @brief Classify a batch of queries on one surface
+ * @param defects Output array receiving the QueryDefect flags per query
+ * @param report Accumulates the defect counts
+ * @return Number of valid queries
+ */
+std::size_t validateQueries(const std::vector<Light>& lights,
+                            const Vector3D& P0, const Vector3D& P1, const Vector3D& P2,
+                            const Material& material, const BrightnessQuery* queries, std::size_t count,
+                            std::uint8_t* defects, ValidationReport& report) noexcept;
+
+/**
+ * @brief Calculate brightness for a batch of queries, rejecting bad rows first
+ *
+ * Validates, compacts and evaluates the queries in blocks that stay in
+ * cache, so calculateBrightnessBatch only sees valid queries and the
+ * queries are read from memory once. Rejected queries receive black. An
+ * all-valid block is passed to the kernel as is, without copying.
+ *
+ * @param report Accumulates the defect counts
+ */
+void calculateBrightnessBatchValidated(const std::vector<Light>& lights,
+                                       const Vector3D& P0, const Vector3D& P1, const Vector3D& P2,
+                                       const Material& material,
+                                       const BrightnessQuery* queries, std::size_t count,
+                                       Color* brightness, ValidationReport& report);
+
+#endif // VALIDATION_H
@@ -1,11 +1,17 @@
 #ifndef VECTOR3D_H
 #define VECTOR3D_H
 
+#include <cmath>
+
 /**
  * @brief 3D vector class for geometric calculations
  * 
  * Provides basic vector operations including arithmetic operations,
  * dot product, cross product, normalization, and magnitude calculation.
+ *
+ * All operations are defined inline so they can be fused into the
+ * surrounding lighting code; everything except the square-root based
+ * norm() and normalized() is also usable in constant expressions.
  */
 class Vector3D {
 public:
@@ -17,54 +23,77 @@ public:
      * @param y_ Y-component (default: 0)
      * @param z_ Z-component (default: 0)
      */
-    Vector3D(double x_ = 0, double y_ = 0, double z_ = 0) noexcept;
+    constexpr Vector3D(double x_ = 0, double y_ = 0, double z_ = 0) noexcept
+        : x(x_), y(y_), z(z_) {}
 
     /**
      * @brief Vector addition
      * @param other Vector to add
      * @return Sum of the two vectors
      */
-    Vector3D operator+(const Vector3D& other) const noexcept;
+    constexpr Vector3D operator+(const Vector3D& other) const noexcept {
+        return {x + other.x, y + other.y, z + other.z};
+    }
 
     /**
      * @brief Vector subtraction
      * @param other Vector to subtract
      * @return Difference of the two vectors
      */
-    Vector3D operator-(const Vector3D& other) const noexcept;
+    constexpr Vector3D operator-(const Vector3D& other) const noexcept {
+        return {x - other.x, y - other.y, z - other.z};
+    }
 
     /**
      * @brief Scalar multiplication
      * @param scalar Scalar value to multiply by
      * @return Scaled vector
      */
-    Vector3D operator*(double scalar) const noexcept;
+    constexpr Vector3D operator*(double scalar) const noexcept {
+        return {x * scalar, y * scalar, z * scalar};
+    }
 
     /**
      * @brief Compute dot product with another vector
      * @param other Vector to compute dot product with
      * @return Dot product (scalar value)
      */
-    double dot(const Vector3D& other) const noexcept;
+    constexpr double dot(const Vector3D& other) const noexcept {
+        return x * other.x + y * other.y + z * other.z;
+    }
 
     /**
      * @brief Compute cross product with another vector
      * @param other Vector to compute cross product with
      * @return Cross product vector (perpendicular to both inputs)
      */
-    Vector3D cross(const Vector3D& other) const noexcept;
+    constexpr Vector3D cross(const Vector3D& other) const noexcept {
+        return {
+            y * other.z - z * other.y,
+            z * other.x - x * other.z,
+            x * other.y - y * other.x
+        };
+    }
     
     /**
      * @brief Calculate the magnitude (length) of the vector
+     *
+     * Uses hypot for numerical stability with very large or small components.
+     *
      * @return Euclidean norm of the vector
      */
-    double norm() const noexcept;
+    double norm() const noexcept {
+        return std::hypot(x, y, z);
+    }
 
     /**
      * @brief Get a normalized (unit length) version of the vector
      * @return Normalized vector with magnitude 1 (or original if zero length)
      */
-    Vector3D normalized() const noexcept;
+    Vector3D normalized() const noexcept {
+        const double n = norm();
+        return (n != 0.0) ? (*this) * (1.0 / n) : *this;
+    }
 };
 
 #endif // VECTOR3D_H
\ No newline at end of file
@@ -0,0 +1,294 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Lazily evaluated sequence produced by a C++20 coroutine
+ *
+ * The coroutine runs only when the consumer advances the iterator, so a
+ * chain of generators processes one element at a time and never holds the
+ * whole input in memory.
+ *
+ * @tparam T Element type yielded by the coroutine
+ */
+template <typename T>
+class Generator {
+public:
+    class promise_type {
+    public:
+        Generator get_return_object() noexcept {
+            return Generator{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        std::suspend_always yield_value(T value) noexcept(std::is_nothrow_move_constructible_v<T>) {
+            value_ = std::move(value);
+            return {};
+        }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { exception_ = std::current_exception(); }
+
+        T& value() noexcept { return *value_; }
+        void rethrow() const {
+            if (exception_) {
+                std::rethrow_exception(exception_);
+            }
+        }
+
+    private:
+        std::optional<T> value_;
+        std::exception_ptr exception_;
+    };
+
+    using Handle = std::coroutine_handle<promise_type>;
+
+    /**
+     * @brief Input iterator that resumes the coroutine on increment
+     */
+    class iterator {
+    public:
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() noexcept = default;
+        explicit iterator(const Handle handle) noexcept : handle_(handle) {}
+
+        T& operator*() const noexcept { return handle_.promise().value(); }
+        iterator& operator++() {
+            handle_.resume();
+            handle_.promise().rethrow();
+            return *this;
+        }
+        void operator++(int) { ++*this; }
+        bool operator==(std::default_sentinel_t) const noexcept { return !handle_ || handle_.done(); }
+
+    private:
+        Handle handle_{};
+    };
+
+    explicit Generator(const Handle handle) noexcept : handle_(handle) {}
+    Generator(Generator&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+    Generator& operator=(Generator&& other) noexcept {
+        if (this != &other) {
+            if (handle_) {
+                handle_.destroy();
+            }
+            handle_ = std::exchange(other.handle_, {});
+        }
+        return *this;
+    }
+    Generator(const Generator&) = delete;
+    Generator& operator=(const Generator&) = delete;
+    ~Generator() {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+
+    /**
+     * @brief Run the coroutine up to its first element
+     */
+    iterator begin() {
+        handle_.resume();
+        handle_.promise().rethrow();
+        return iterator{handle_};
+    }
+
+    std::default_sentinel_t end() const noexcept { return {}; }
+
+private:
+    Handle handle_;
+};
+
+/**
+ * @brief Fixed-capacity blocking queue connecting two pipeline stages
+ *
+ * push() blocks while the queue is full, which throttles a fast producer to
+ * the speed of its consumer and keeps memory use constant.
+ *
+ * @tparam T Element type
+ */
+template <typename T>
+class BoundedQueue {
+public:
+    /**
+     * @brief Create a queue
+     * @param capacity Maximum number of queued elements
+     */
+    explicit BoundedQueue(const std::size_t capacity) : capacity_(capacity > 0 ? capacity : 1) {}
+
+    /**
+     * @brief Append an element, waiting for free space
+     * @param value Element to append
+     * @return false if the queue was closed
+     */
+    bool push(T value) {
+        std::unique_lock lock(mutex_);
+        notFull_.wait(lock, [this] { return closed_ || items_.size() < capacity_; });
+        if (closed_) {
+            return false;
+        }
+        items_.push_back(std::move(value));
+        notEmpty_.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief Remove the oldest element, waiting until one is available
+     * @return The element, or nothing once the queue is closed and drained
+     */
+    std::optional<T> pop() {
+        std::unique_lock lock(mutex_);
+        notEmpty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+        if (items_.empty()) {
+            return std::nullopt;
+        }
+        T value = std::move(items_.front());
+        items_.pop_front();
+        notFull_.notify_one();
+        return value;
+    }
+
+    /**
+     * @brief Signal that no more elements will be pushed
+     */
+    void close() {
+        std::lock_guard lock(mutex_);
+        closed_ = true;
+        notEmpty_.notify_all();
+        notFull_.notify_all();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable notEmpty_, notFull_;
+    std::deque<T> items_;
+    std::size_t capacity_;
+    bool closed_ = false;
+};
+
+/**
+ * @brief Group consecutive elements of a generator into fixed-size batches
+ * @param items Source sequence
+ * @param size Elements per batch (the last batch may be shorter)
+ * @return Generator of batches
+ */
+template <typename T>
+Generator<std::vector<T>> batched(Generator<T> items, const std::size_t size) {
+    std::vector<T> batch;
+    batch.reserve(size);
+    for (T& item : items) {
+        batch.push_back(std::move(item));
+        if (batch.size() == size) {
+            co_yield std::move(batch);
+            batch = {};
+            batch.reserve(size);
+        }
+    }
+    if (!batch.empty()) {
+        co_yield std::move(batch);
+    }
+}
+
+/**
+ * @brief Run reader -> evaluator -> writer with bounded queues between them
+ *
+ * The batch generator (reading and batching) is driven on its own thread,
+ * evaluation runs on a second thread and results are written on the calling
+ * thread, so parsing the next batch overlaps computing the current one.
+ * Batches keep their input order. At most 'depth' batches wait in each queue.
+ *
+ * If a stage throws (the generator, evaluate or write), both queues are
+ * closed so the other stages stop, the threads are joined, and the first
+ * exception is rethrown to the caller.
+ *
+ * @param batches Generator of input batches
+ * @param evaluate Callable mapping an input batch to a result batch
+ * @param write Callable consuming result batches in order
+ * @param depth Capacity of each queue, in batches
+ */
+template <typename Batch, typename Evaluate, typename Write>
+void runPipeline(Generator<Batch> batches, Evaluate evaluate, Write write, const std::size_t depth = 4) {
+    using Result = std::invoke_result_t<Evaluate&, Batch&>;
+    BoundedQueue<Batch> pending(depth);
+    BoundedQueue<Result> done(depth);
+
+    std::mutex errorMutex;
+    std::exception_ptr error;
+    // Keep the first exception and stop every stage
+    auto fail = [&] {
+        {
+            std::lock_guard lock(errorMutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+        pending.close();
+        done.close();
+    };
+
+    {
+        std::jthread reader, evaluator;
+        // Declared after the threads, so both queues are closed before they are joined on every exit path
+        struct CloseQueues {
+            BoundedQueue<Batch>& pending;
+            BoundedQueue<Result>& done;
+            ~CloseQueues() {
+                pending.close();
+                done.close();
+            }
+        } closeQueues{pending, done};
+
+        reader = std::jthread([&] {
+            try {
+                for (Batch& batch : batches) {
+                    if (!pending.push(std::move(batch))) {
+                        break;
+                    }
+                }
+            } catch (...) {
+                fail();
+            }
+            pending.close();
+        });
+
+        evaluator = std::jthread([&] {
+            try {
+                while (std::optional<Batch> batch = pending.pop()) {
+                    if (!done.push(evaluate(*batch))) {
+                        break;
+                    }
+                }
+            } catch (...) {
+                fail();
+            }
+            done.close();
+        });
+
+        try {
+            while (std::optional<Result> result = done.pop()) {
+                write(*result);
+            }
+        } catch (...) {
+            fail();
+        }
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+#endif // PIPELINE_H
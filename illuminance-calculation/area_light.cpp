@@ -0,0 +1,385 @@
+#include "area_light.h"
+#include "time_series.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <random>
+#include <string>
+
+namespace {
+
+// Receivers processed per block; keeps the per-vertex scratch arrays in L1/L2
+constexpr std::size_t kBlock = 256;
+
+/**
+ * Contribution of one polygon edge to Lambert's edge integral.
+ * a and b are unit vectors from the receiver towards the edge end points.
+ * theta * (a x b) / |a x b| is evaluated as (theta / sin(theta)) * (a x b)
+ * so that the loop body stays free of branches.
+ */
+inline double edgeTerm(const double ax, const double ay, const double az,
+                       const double bx, const double by, const double bz,
+                       const double nx, const double ny, const double nz) noexcept {
+    const double cx = ay * bz - az * by;
+    const double cy = az * bx - ax * bz;
+    const double cz = ax * by - ay * bx;
+    const double sinTheta = std::sqrt(cx * cx + cy * cy + cz * cz);
+    const double cosTheta = ax * bx + ay * by + az * bz;
+    const double theta = std::atan2(sinTheta, cosTheta);
+    const double scale = sinTheta > 1e-12 ? theta / sinTheta : 1.0;
+    return scale * (cx * nx + cy * ny + cz * nz);
+}
+
+// Unit vector from the receiver to a vertex (zero if they coincide)
+Vector3D directionTo(const Vector3D& vertex, const Vector3D& point) noexcept {
+    const Vector3D d = vertex - point;
+    const double len = d.norm();
+    return len > 0.0 ? d * (1.0 / len) : Vector3D{0.0, 0.0, 0.0};
+}
+
+// Average of the polygon vertices, used to orient receiver normals
+Vector3D centroidOf(const std::vector<Vector3D>& vertices) noexcept {
+    Vector3D c{0.0, 0.0, 0.0};
+    for (const auto& v : vertices) {
+        c = c + v;
+    }
+    return c * (1.0 / static_cast<double>(vertices.size()));
+}
+
+// Polygon normal by Newell's method (not normalized), robust for any simple polygon
+Vector3D newellNormal(const std::vector<Vector3D>& vertices) noexcept {
+    Vector3D n{0.0, 0.0, 0.0};
+    for (std::size_t k = 0; k < vertices.size(); ++k) {
+        const Vector3D& a = vertices[k];
+        const Vector3D& b = vertices[(k + 1) % vertices.size()];
+        n.x += (a.y - b.y) * (a.z + b.z);
+        n.y += (a.z - b.z) * (a.x + b.x);
+        n.z += (a.x - b.x) * (a.y + b.y);
+    }
+    return n;
+}
+
+} // namespace
+
+/**
+ * Geometric factor for a single receiver.
+ * Tests the emitting side like the batch path, clips the polygon to the
+ * half-space above the receiver's tangent plane (Sutherland-Hodgman) and
+ * then sums the edge integral.
+ */
+double polygonIrradianceFactor(const PolygonLight& light, const Vector3D& point, const Vector3D& normal) {
+    const std::vector<Vector3D>& vertices = light.vertices;
+    if (vertices.size() < 3) {
+        return 0.0;
+    }
+    if (!(light.twoSided || (point - vertices[0]).dot(newellNormal(vertices)) > 0.0)) {
+        return 0.0;
+    }
+
+    // Use the side of the receiver that faces the emitter
+    Vector3D n = normal;
+    if ((centroidOf(vertices) - point).dot(n) < 0.0) {
+        n = n * -1.0;
+    }
+
+    // Clip against the plane (p - point) . n >= 0
+    std::vector<Vector3D> clipped;
+    clipped.reserve(vertices.size() + 1);
+    for (std::size_t k = 0; k < vertices.size(); ++k) {
+        const Vector3D& a = vertices[k];
+        const Vector3D& b = vertices[(k + 1) % vertices.size()];
+        const double da = (a - point).dot(n);
+        const double db = (b - point).dot(n);
+        if (da >= 0.0) {
+            clipped.push_back(a);
+        }
+        if ((da >= 0.0) != (db >= 0.0)) {
+            const double t = da / (da - db);
+            clipped.push_back(a + (b - a) * t);
+        }
+    }
+    if (clipped.size() < 3) {
+        return 0.0;
+    }
+
+    double sum = 0.0;
+    for (std::size_t k = 0; k < clipped.size(); ++k) {
+        const Vector3D a = directionTo(clipped[k], point);
+        const Vector3D b = directionTo(clipped[(k + 1) % clipped.size()], point);
+        sum += edgeTerm(a.x, a.y, a.z, b.x, b.y, b.z, n.x, n.y, n.z);
+    }
+
+    // The sign only reflects the winding as seen from the receiver
+    return 0.5 * std::abs(sum);
+}
+
+/**
+ * Batch irradiance from a polygonal light.
+ * Each block runs three passes: orient normals and classify the emitter
+ * against the receiver horizon, accumulate edge terms for all receivers,
+ * then resolve the few receivers that need clipping.
+ */
+std::vector<std::array<double, 3>> calculatePolygonIrradiance(const PolygonLight& light,
+                                                              const ReceiverSet& receivers) {
+    const std::size_t count = receivers.size();
+    std::vector<std::array<double, 3>> E(count, std::array<double, 3>{0.0, 0.0, 0.0});
+
+    const std::vector<Vector3D>& V = light.vertices;
+    const std::size_t m = V.size();
+    if (m < 3) {
+        return E;
+    }
+
+    const Vector3D centroid = centroidOf(V);
+    const Vector3D emitterNormal = newellNormal(V);
+
+    // Per-block scratch: unit directions to every vertex, oriented normals, flags
+    std::vector<double> ux(m * kBlock), uy(m * kBlock), uz(m * kBlock);
+    std::vector<double> bnx(kBlock), bny(kBlock), bnz(kBlock), sum(kBlock);
+    std::vector<unsigned char> front(kBlock), above(kBlock), below(kBlock);
+
+    for (std::size_t begin = 0; begin < count; begin += kBlock) {
+        const std::size_t n = std::min(kBlock, count - begin);
+        const double* px = receivers.px.data() + begin;
+        const double* py = receivers.py.data() + begin;
+        const double* pz = receivers.pz.data() + begin;
+        const double* nx = receivers.nx.data() + begin;
+        const double* ny = receivers.ny.data() + begin;
+        const double* nz = receivers.nz.data() + begin;
+
+        // Pass 1a: flip normals towards the emitter and test the emitting side
+        for (std::size_t i = 0; i < n; ++i) {
+            const double cx = centroid.x - px[i];
+            const double cy = centroid.y - py[i];
+            const double cz = centroid.z - pz[i];
+            const double flip = (cx * nx[i] + cy * ny[i] + cz * nz[i]) < 0.0 ? -1.0 : 1.0;
+            bnx[i] = nx[i] * flip;
+            bny[i] = ny[i] * flip;
+            bnz[i] = nz[i] * flip;
+
+            const double side = (px[i] - V[0].x) * emitterNormal.x
+                              + (py[i] - V[0].y) * emitterNormal.y
+                              + (pz[i] - V[0].z) * emitterNormal.z;
+            front[i] = static_cast<unsigned char>(light.twoSided || side > 0.0);
+            above[i] = 0;
+            below[i] = 0;
+            sum[i] = 0.0;
+        }
+
+        // Pass 1b: unit vectors to each vertex and horizon classification
+        for (std::size_t k = 0; k < m; ++k) {
+            double* kx = ux.data() + k * kBlock;
+            double* ky = uy.data() + k * kBlock;
+            double* kz = uz.data() + k * kBlock;
+            for (std::size_t i = 0; i < n; ++i) {
+                const double dx = V[k].x - px[i];
+                const double dy = V[k].y - py[i];
+                const double dz = V[k].z - pz[i];
+                const double len = std::sqrt(dx * dx + dy * dy + dz * dz);
+                const double inv = len > 0.0 ? 1.0 / len : 0.0;
+                kx[i] = dx * inv;
+                ky[i] = dy * inv;
+                kz[i] = dz * inv;
+                const double h = dx * bnx[i] + dy * bny[i] + dz * bnz[i];
+                above[i] |= static_cast<unsigned char>(h > 0.0);
+                below[i] |= static_cast<unsigned char>(h < 0.0);
+            }
+        }
+
+        // Pass 2: edge integral for every receiver in the block
+        for (std::size_t k = 0; k < m; ++k) {
+            const std::size_t k1 = (k + 1) % m;
+            const double* ax = ux.data() + k * kBlock;
+            const double* ay = uy.data() + k * kBlock;
+            const double* az = uz.data() + k * kBlock;
+            const double* bx = ux.data() + k1 * kBlock;
+            const double* by = uy.data() + k1 * kBlock;
+            const double* bz = uz.data() + k1 * kBlock;
+            for (std::size_t i = 0; i < n; ++i) {
+                sum[i] += edgeTerm(ax[i], ay[i], az[i], bx[i], by[i], bz[i], bnx[i], bny[i], bnz[i]);
+            }
+        }
+
+        // Pass 3: apply radiance; receivers with the emitter across the horizon are clipped
+        for (std::size_t i = 0; i < n; ++i) {
+            double factor = 0.0;
+            if (front[i] && above[i]) {
+                factor = below[i]
+                    ? polygonIrradianceFactor(light, Vector3D{px[i], py[i], pz[i]}, Vector3D{nx[i], ny[i], nz[i]})
+                    : 0.5 * std::abs(sum[i]);
+            }
+            E[begin + i] = {
+                light.radiance[0] * factor,
+                light.radiance[1] * factor,
+                light.radiance[2] * factor
+            };
+        }
+    }
+
+    return E;
+}
+
+bool readPolygonLight(std::istream& in, PolygonLight& light) {
+    int twoSided;
+    std::size_t count;
+    if (!(in >> light.radiance[0] >> light.radiance[1] >> light.radiance[2] >> twoSided >> count)
+        || (twoSided != 0 && twoSided != 1) || count < 3) {
+        return false;
+    }
+    light.twoSided = twoSided == 1;
+    light.vertices.clear();
+    for (std::size_t k = 0; k < count; ++k) {
+        Vector3D v{};
+        if (!(in >> v.x >> v.y >> v.z)) {
+            return false;
+        }
+        light.vertices.push_back(v);
+    }
+    std::string rest;
+    return !(in >> rest); // Nothing may follow the last vertex
+}
+
+namespace {
+
+constexpr std::size_t kReceiversPerPanel = 16;
+
+// Random parallelogram with edges of 0.5 to 2 and an angle of at least about 20 degrees
+PolygonLight randomPanel(std::mt19937_64& rng) {
+    std::uniform_real_distribution<double> coordinate(-1.0, 1.0);
+    std::uniform_real_distribution<double> length(0.5, 2.0);
+    std::uniform_real_distribution<double> radiance(1.0, 100.0);
+    std::bernoulli_distribution twoSided(0.5);
+    for (;;) {
+        const Vector3D C{coordinate(rng), coordinate(rng), coordinate(rng)};
+        const Vector3D U{coordinate(rng), coordinate(rng), coordinate(rng)};
+        const Vector3D V{coordinate(rng), coordinate(rng), coordinate(rng)};
+        if (U.norm() < 0.1 || V.norm() < 0.1 || U.normalized().cross(V.normalized()).norm() < 0.35) {
+            continue;
+        }
+        const Vector3D u = U.normalized() * length(rng);
+        const Vector3D v = V.normalized() * length(rng);
+        PolygonLight light;
+        light.radiance = {radiance(rng), radiance(rng), radiance(rng)};
+        light.vertices = {C, C + u, C + u + v, C + v};
+        light.twoSided = twoSided(rng);
+        return light;
+    }
+}
+
+// Random receiver within 3 of the panel and at least a tenth of its size from its plane
+void randomReceiver(std::mt19937_64& rng, const PolygonLight& light, Vector3D& point, Vector3D& normal) {
+    std::uniform_real_distribution<double> offset(-3.0, 3.0);
+    std::normal_distribution<double> gaussian;
+    const std::vector<Vector3D>& V = light.vertices;
+    const Vector3D n = newellNormal(V).normalized();
+    const double size = std::max((V[1] - V[0]).norm(), (V[3] - V[0]).norm());
+    do {
+        point = centroidOf(V) + Vector3D{offset(rng), offset(rng), offset(rng)};
+    } while (std::abs((point - V[0]).dot(n)) < 0.1 * size);
+    do {
+        normal = Vector3D{gaussian(rng), gaussian(rng), gaussian(rng)};
+    } while (normal.norm() < 1e-3);
+    normal = normal.normalized();
+}
+
+/**
+ * Factor of the panel at one receiver from a cloud of cells x cells point
+ * lights of unit intensity per unit area, evaluated by the point-light
+ * time series. Cells behind the emitter or below the horizon are left out.
+ */
+double pointCloudFactor(const PolygonLight& light, const int cells, const Vector3D& point, Vector3D normal) {
+    const std::vector<Vector3D>& V = light.vertices;
+    const Vector3D u = V[1] - V[0];
+    const Vector3D v = V[3] - V[0];
+    Vector3D axis = newellNormal(V).normalized();
+    if ((point - V[0]).dot(axis) < 0.0) {
+        if (!light.twoSided) {
+            return 0.0;
+        }
+        axis = axis * -1.0;
+    }
+    if ((centroidOf(V) - point).dot(normal) < 0.0) {
+        normal = normal * -1.0;
+    }
+
+    const double cellArea = u.cross(v).norm() / (static_cast<double>(cells) * cells);
+    std::vector<PointLightState> cloud;
+    cloud.reserve(static_cast<std::size_t>(cells) * cells);
+    for (int a = 0; a < cells; ++a) {
+        for (int b = 0; b < cells; ++b) {
+            PointLightState state;
+            state.I0 = {cellArea, cellArea, cellArea};
+            state.O = axis;
+            state.PL = V[0] + u * ((a + 0.5) / cells) + v * ((b + 0.5) / cells);
+            if ((state.PL - point).dot(normal) > 0.0) {
+                cloud.push_back(state);
+            }
+        }
+    }
+    if (cloud.empty()) {
+        return 0.0;
+    }
+
+    ReceiverSet receiver;
+    receiver.add(point, normal);
+    const IlluminanceTimeSeries series = calculateIlluminationTimeSeries(cloud, receiver);
+    double sum = 0.0;
+    for (std::size_t t = 0; t < series.steps; ++t) {
+        sum += series.data[t * 3];
+    }
+    return sum;
+}
+
+// Record |error| / bound for every channel of one receiver
+void accumulate(AreaLightCheck& check, const PolygonLight& light, const double reference,
+                const std::array<double, 3>& E) {
+    constexpr double kPi = 3.14159265358979323846;
+    for (int c = 0; c < 3; ++c) {
+        const double expected = light.radiance[c] * reference;
+        const double bound = 1e-4 * kPi * light.radiance[c] + 1e-3 * expected;
+        const double ratio = std::abs(E[c] - expected) / bound;
+        if (!(ratio <= 1.0)) {
+            ++check.violations;
+        }
+        check.worstRatio = std::max(check.worstRatio, std::isnan(ratio) ? INFINITY : ratio);
+    }
+}
+
+} // namespace
+
+// Both the batch and the scalar path are checked against the same cloud
+AreaLightCheck checkPolygonIrradiance(const std::size_t count, const std::uint64_t seed, const int subdivisions) {
+    std::mt19937_64 rng(seed);
+    AreaLightCheck check;
+    std::vector<Vector3D> points, normals;
+    for (std::size_t done = 0; done < count; done += kReceiversPerPanel) {
+        const std::size_t n = std::min(kReceiversPerPanel, count - done);
+        const PolygonLight light = randomPanel(rng);
+        points.resize(n);
+        normals.resize(n);
+        ReceiverSet receivers;
+        for (std::size_t i = 0; i < n; ++i) {
+            randomReceiver(rng, light, points[i], normals[i]);
+            receivers.add(points[i], normals[i]);
+        }
+        const std::vector<std::array<double, 3>> E = calculatePolygonIrradiance(light, receivers);
+
+        for (std::size_t i = 0; i < n; ++i) {
+            bool above = false, below = false;
+            for (const auto& vertex : light.vertices) {
+                const double h = (vertex - points[i]).dot(normals[i]);
+                above |= h > 0.0;
+                below |= h < 0.0;
+            }
+            check.clipped += above && below;
+            ++check.receivers;
+
+            const double reference = pointCloudFactor(light, subdivisions, points[i], normals[i]);
+            const double factor = polygonIrradianceFactor(light, points[i], normals[i]);
+            accumulate(check, light, reference, E[i]);
+            accumulate(check, light, reference,
+                       {light.radiance[0] * factor, light.radiance[1] * factor, light.radiance[2] * factor});
+        }
+    }
+    return check;
+}
@@ -0,0 +1,213 @@
+#include "batch_io.h"
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace {
+
+// Size of the read and write buffers
+constexpr std::size_t kBufferSize = 1 << 20;
+
+// Values per query and per result record
+constexpr std::size_t kQueryValues = 20;
+constexpr std::size_t kResultValues = 3;
+
+// Longest text line for one result: three shortest-form doubles plus separators
+constexpr std::size_t kMaxTextResult = 3 * 32 + 3;
+
+static_assert(std::is_standard_layout_v<IlluminationQuery> &&
+              sizeof(IlluminationQuery) == kQueryValues * sizeof(double),
+              "IlluminationQuery must be 20 packed doubles");
+
+inline bool isSpace(const char c) noexcept {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+}
+
+// Reinterpret 8 little-endian bytes as a double
+inline double loadLittleEndian(const char* bytes) noexcept {
+    std::uint64_t bits;
+    std::memcpy(&bits, bytes, sizeof(bits));
+    if constexpr (std::endian::native == std::endian::big) {
+        bits = __builtin_bswap64(bits);
+    }
+    return std::bit_cast<double>(bits);
+}
+
+// Store a double as 8 little-endian bytes
+inline void storeLittleEndian(char* bytes, const double value) noexcept {
+    std::uint64_t bits = std::bit_cast<std::uint64_t>(value);
+    if constexpr (std::endian::native == std::endian::big) {
+        bits = __builtin_bswap64(bits);
+    }
+    std::memcpy(bytes, &bits, sizeof(bits));
+}
+
+} // namespace
+
+// Allocate the input buffer
+QueryReader::QueryReader(std::FILE* stream, const BatchFormat format)
+    : stream_(stream), format_(format), buffer_(kBufferSize) {}
+
+// Move unread bytes to the front of the buffer and append the next block
+bool QueryReader::fill() {
+    if (eof_) {
+        return false;
+    }
+    if (begin_ > 0) {
+        std::memmove(buffer_.data(), buffer_.data() + begin_, end_ - begin_);
+        end_ -= begin_;
+        begin_ = 0;
+    }
+    if (end_ == buffer_.size()) {
+        return false; // A single token fills the whole buffer
+    }
+    const std::size_t n = std::fread(buffer_.data() + end_, 1, buffer_.size() - end_, stream_);
+    end_ += n;
+    if (n == 0) {
+        eof_ = true;
+    }
+    return n > 0;
+}
+
+// Parse the next whitespace-delimited number, refilling across block boundaries
+bool QueryReader::nextNumber(double& value) {
+    for (;;) {
+        while (begin_ < end_ && isSpace(buffer_[begin_])) {
+            ++begin_;
+        }
+        if (begin_ == end_) {
+            if (!fill()) {
+                return false;
+            }
+            continue;
+        }
+
+        std::size_t tokenEnd = begin_;
+        while (tokenEnd < end_ && !isSpace(buffer_[tokenEnd])) {
+            ++tokenEnd;
+        }
+        // The token may continue in the next block
+        if (tokenEnd == end_ && !eof_ && fill()) {
+            continue;
+        }
+
+        const char* first = buffer_.data() + begin_;
+        const char* last = buffer_.data() + tokenEnd;
+        const auto [ptr, ec] = std::from_chars(first, last, value);
+        if (ec != std::errc() || ptr != last) {
+            error_ = "Invalid number '" + std::string(first, last) + "' in query #" + std::to_string(queries_ + 1);
+            return false;
+        }
+        begin_ = tokenEnd;
+        return true;
+    }
+}
+
+// Decode fixed-size little-endian records
+std::size_t QueryReader::readBinary(IlluminationQuery* out, const std::size_t max) {
+    constexpr std::size_t recordSize = kQueryValues * sizeof(double);
+    std::size_t count = 0;
+    while (count < max) {
+        if (end_ - begin_ < recordSize && !fill() && end_ - begin_ < recordSize) {
+            if (end_ - begin_ > 0) {
+                error_ = "Truncated binary record after query #" + std::to_string(queries_);
+            }
+            break;
+        }
+        while (count < max && end_ - begin_ >= recordSize) {
+            double values[kQueryValues];
+            for (std::size_t v = 0; v < kQueryValues; ++v) {
+                values[v] = loadLittleEndian(buffer_.data() + begin_ + v * sizeof(double));
+            }
+            std::memcpy(&out[count], values, sizeof(values));
+            begin_ += recordSize;
+            ++count;
+            ++queries_;
+        }
+    }
+    return count;
+}
+
+// Read up to max queries in the configured format
+std::size_t QueryReader::read(IlluminationQuery* out, const std::size_t max) {
+    if (failed()) {
+        return 0;
+    }
+    if (format_ == BatchFormat::Binary) {
+        return readBinary(out, max);
+    }
+
+    std::size_t count = 0;
+    while (count < max) {
+        double values[kQueryValues];
+        std::size_t v = 0;
+        while (v < kQueryValues && nextNumber(values[v])) {
+            ++v;
+        }
+        if (v < kQueryValues) {
+            if (v > 0 && !failed()) {
+                error_ = "Incomplete query #" + std::to_string(queries_ + 1);
+            }
+            break;
+        }
+        std::memcpy(&out[count], values, sizeof(values));
+        ++count;
+        ++queries_;
+    }
+    return count;
+}
+
+// Refill a small block from the reader and hand out its queries one by one
+Generator<IlluminationQuery> readQueries(QueryReader& reader) {
+    constexpr std::size_t blockSize = 256;
+    std::vector<IlluminationQuery> block(blockSize);
+    while (const std::size_t n = reader.read(block.data(), blockSize)) {
+        for (std::size_t i = 0; i < n; ++i) {
+            co_yield block[i];
+        }
+    }
+}
+
+// Allocate the output buffer
+ResultWriter::ResultWriter(std::FILE* stream, const BatchFormat format)
+    : stream_(stream), format_(format), buffer_(kBufferSize) {}
+
+ResultWriter::~ResultWriter() {
+    flush();
+}
+
+// Format results into the buffer, flushing whenever it runs low on space
+void ResultWriter::write(const std::array<double, 3>* E, const std::size_t count) {
+    const std::size_t recordSize = format_ == BatchFormat::Binary ? kResultValues * sizeof(double) : kMaxTextResult;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (buffer_.size() - size_ < recordSize) {
+            flush();
+        }
+        char* out = buffer_.data() + size_;
+        if (format_ == BatchFormat::Binary) {
+            for (std::size_t c = 0; c < kResultValues; ++c) {
+                storeLittleEndian(out + c * sizeof(double), E[i][c]);
+            }
+            size_ += recordSize;
+        } else {
+            char* const last = buffer_.data() + buffer_.size();
+            for (std::size_t c = 0; c < kResultValues; ++c) {
+                out = std::to_chars(out, last, E[i][c]).ptr;
+                *out++ = c + 1 < kResultValues ? ' ' : '\n';
+            }
+            size_ = static_cast<std::size_t>(out - buffer_.data());
+        }
+    }
+}
+
+// Hand the buffered bytes to the stream
+bool ResultWriter::flush() {
+    bool ok = true;
+    if (size_ > 0) {
+        ok = std::fwrite(buffer_.data(), 1, size_, stream_) == size_;
+        size_ = 0;
+    }
+    return ok && std::fflush(stream_) == 0;
+}
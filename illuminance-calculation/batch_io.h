@@ -0,0 +1,125 @@
+#ifndef BATCH_IO_H
+#define BATCH_IO_H
+
+#include <array>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "illumination.h"
+#include "pipeline.h"
+
+/**
+ * @brief Encoding of batch query and result streams
+ *
+ * Text: whitespace-separated numbers, 20 per query in the order of the
+ * interactive prompts (I0, O, PL, P0, P1, P2, x, y); results are written as
+ * "R G B" lines. Binary: little-endian float64 records of 20 values per
+ * query and 3 values per result, with no header.
+ */
+enum class BatchFormat {
+    Text,
+    Binary
+};
+
+/**
+ * @brief Buffered reader of illumination queries from a C stream
+ *
+ * Reads the input in large blocks and parses numbers with std::from_chars,
+ * so no locale or iostream machinery is involved per value.
+ */
+class QueryReader {
+public:
+    /**
+     * @brief Create a reader
+     * @param stream Open input stream (not owned)
+     * @param format Input encoding
+     */
+    QueryReader(std::FILE* stream, BatchFormat format);
+
+    /**
+     * @brief Read up to max queries
+     * @param out Destination array with room for max queries
+     * @param max Maximum number of queries to read
+     * @return Number of queries read; 0 at end of input or on error
+     */
+    std::size_t read(IlluminationQuery* out, std::size_t max);
+
+    /**
+     * @brief Whether reading stopped because of malformed input
+     */
+    bool failed() const noexcept { return !error_.empty(); }
+
+    /**
+     * @brief Description of the input error, empty if none
+     */
+    const std::string& error() const noexcept { return error_; }
+
+private:
+    bool fill();
+    bool nextNumber(double& value);
+    std::size_t readBinary(IlluminationQuery* out, std::size_t max);
+
+    std::FILE* stream_;
+    BatchFormat format_;
+    std::vector<char> buffer_;
+    std::size_t begin_ = 0;
+    std::size_t end_ = 0;
+    bool eof_ = false;
+    std::size_t queries_ = 0;
+    std::string error_;
+};
+
+/**
+ * @brief Pipeline source stage: yield queries one at a time from a reader
+ *
+ * Parses in blocks internally; the coroutine suspends after every query,
+ * so memory use does not depend on the length of the input.
+ *
+ * @param reader Query reader (must outlive the generator)
+ * @return Generator of queries, ending at end of input or on error
+ */
+Generator<IlluminationQuery> readQueries(QueryReader& reader);
+
+/**
+ * @brief Buffered writer of illumination results to a C stream
+ *
+ * Formats into a private buffer with std::to_chars and hands it to the
+ * stream in large writes. Text output uses the shortest representation
+ * that round-trips to the same double.
+ */
+class ResultWriter {
+public:
+    /**
+     * @brief Create a writer
+     * @param stream Open output stream (not owned)
+     * @param format Output encoding
+     */
+    ResultWriter(std::FILE* stream, BatchFormat format);
+
+    /**
+     * @brief Flush remaining output
+     */
+    ~ResultWriter();
+
+    /**
+     * @brief Append results to the output
+     * @param E RGB results
+     * @param count Number of results
+     */
+    void write(const std::array<double, 3>* E, std::size_t count);
+
+    /**
+     * @brief Write buffered output to the stream
+     * @return false if the stream reported an error
+     */
+    bool flush();
+
+private:
+    std::FILE* stream_;
+    BatchFormat format_;
+    std::vector<char> buffer_;
+    std::size_t size_ = 0;
+};
+
+#endif // BATCH_IO_H
@@ -0,0 +1,161 @@
+/**
+ * @file benchmark.cpp
+ * @brief Micro-benchmarks for the illuminance calculation kernels
+ *
+ * Measures:
+ * - calculateIllumination called once per query from this translation unit;
+ *   without link-time optimisation every call is an opaque cross-TU call,
+ *   with the release-lto presets it can be inlined into the loop
+ * - calculateIlluminationBatch over the same queries
+ * - The float32 and Q16.16 fixed point batch kernels over the same queries,
+ *   converted up front
+ * - calculateIlluminationBatchValidated, i.e. the batch kernel plus the
+ *   validation, on all-valid queries
+ * - calculatePolygonIrradiance from a square panel over the same number of
+ *   receivers, some of which see the panel across their horizon
+ *
+ * Each measurement is repeated and the fastest run is reported. Comparing
+ * the output of a default build with a release-lto build shows the per-call
+ * overhead that LTO removes. The batch kernels are timed for every
+ * instruction set variant the CPU supports.
+ *
+ * Usage: illuminance-benchmark [query_count]
+ */
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "vector3d.h"
+#include "illumination.h"
+#include "cpu_dispatch.h"
+#include "reduced_precision.h"
+#include "validation.h"
+#include "area_light.h"
+#include "receivers.h"
+
+namespace {
+
+constexpr int kRepeats = 5;
+
+// Fastest of kRepeats runs of f, in nanoseconds per item
+template <typename F>
+double bestNsPerItem(const std::size_t items, F&& f) {
+    double best = 1e300;
+    for (int r = 0; r < kRepeats; ++r) {
+        const auto start = std::chrono::steady_clock::now();
+        f();
+        const auto stop = std::chrono::steady_clock::now();
+        const double ns = std::chrono::duration<double, std::nano>(stop - start).count();
+        best = std::min(best, ns / static_cast<double>(items));
+    }
+    return best;
+}
+
+// Random queries with the light above a triangle in the XY plane
+std::vector<IlluminationQuery> makeQueries(const std::size_t count) {
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::vector<IlluminationQuery> queries(count);
+    for (auto& q : queries) {
+        q.I0 = {100.0 * unit(rng), 100.0 * unit(rng), 100.0 * unit(rng)};
+        q.O = {unit(rng) - 0.5, unit(rng) - 0.5, -1.0};
+        q.PL = {4.0 * unit(rng) - 2.0, 4.0 * unit(rng) - 2.0, 5.0 + unit(rng)};
+        q.P0 = {-1.0, 0.0, 0.0};
+        q.P1 = {1.0, 0.0, 0.0};
+        q.P2 = {0.0, 2.0, 0.0};
+        q.x = unit(rng);
+        q.y = unit(rng) * (1.0 - q.x);
+    }
+    return queries;
+}
+
+// Receivers with random normals around a 2 x 2 panel emitting downwards from z = 3
+ReceiverSet makeReceivers(const std::size_t count) {
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    ReceiverSet receivers;
+    receivers.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        receivers.add({8.0 * unit(rng) - 4.0, 8.0 * unit(rng) - 4.0, 2.0 * unit(rng)},
+                      {unit(rng) - 0.5, unit(rng) - 0.5, 1.0});
+    }
+    return receivers;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const long long requested = argc > 1 ? std::atoll(argv[1]) : 1000000;
+    if (requested <= 0) {
+        std::cerr << "Error: Query count must be positive.\n";
+        return 1;
+    }
+    const std::size_t count = static_cast<std::size_t>(requested);
+    const std::vector<IlluminationQuery> queries = makeQueries(count);
+    std::vector<std::array<double, 3>> E(count);
+    std::vector<IlluminationQueryF32> queriesF32(count);
+    std::vector<IlluminationQueryQ16> queriesQ16(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        queriesF32[i] = toFloat32(queries[i]);
+        queriesQ16[i] = toFixed16(queries[i]);
+    }
+    std::vector<std::array<float, 3>> EF32(count);
+    std::vector<std::array<std::int32_t, 3>> EQ16(count);
+
+    double sink = 0.0;
+    const double perCallNs = bestNsPerItem(count, [&] {
+        for (std::size_t i = 0; i < count; ++i) {
+            const IlluminationQuery& q = queries[i];
+            E[i] = calculateIllumination(q.I0, q.O, q.PL, q.P0, q.P1, q.P2, q.x, q.y);
+        }
+        sink += E[count / 2][0];
+    });
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "calculateIllumination, one call per query: " << perCallNs << " ns/query\n";
+
+    const IsaLevel detected = detectIsa();
+    for (int level = 0; level <= static_cast<int>(detected); ++level) {
+        forceIsa(static_cast<IsaLevel>(level));
+        const double batchNs = bestNsPerItem(count, [&] {
+            calculateIlluminationBatch(queries.data(), count, E.data());
+            sink += E[count / 2][0];
+        });
+        const double f32Ns = bestNsPerItem(count, [&] {
+            calculateIlluminationBatchF32(queriesF32.data(), count, EF32.data());
+            sink += EF32[count / 2][0];
+        });
+        const double q16Ns = bestNsPerItem(count, [&] {
+            calculateIlluminationBatchQ16(queriesQ16.data(), count, EQ16.data());
+            sink += fromFixed16(EQ16[count / 2][0]);
+        });
+        const char* isa = isaName(activeIsa());
+        std::cout << "calculateIlluminationBatch [" << isa << "]: " << batchNs << " ns/query\n";
+        std::cout << "calculateIlluminationBatchF32 [" << isa << "]: " << f32Ns << " ns/query\n";
+        std::cout << "calculateIlluminationBatchQ16 [" << isa << "]: " << q16Ns << " ns/query\n";
+    }
+
+    ValidationReport report;
+    const double validatedNs = bestNsPerItem(count, [&] {
+        calculateIlluminationBatchValidated(queries.data(), count, E.data(), report);
+        sink += E[count / 2][0];
+    });
+    std::cout << "calculateIlluminationBatchValidated [" << isaName(activeIsa()) << "]: " << validatedNs
+              << " ns/query\n";
+    PolygonLight panel;
+    panel.radiance = {100.0, 100.0, 100.0};
+    panel.vertices = {{-1.0, -1.0, 3.0}, {-1.0, 1.0, 3.0}, {1.0, 1.0, 3.0}, {1.0, -1.0, 3.0}};
+    const ReceiverSet receivers = makeReceivers(count);
+    const double areaNs = bestNsPerItem(count, [&] {
+        sink += calculatePolygonIrradiance(panel, receivers)[count / 2][0];
+    });
+    std::cout << "calculatePolygonIrradiance (4 vertices): " << areaNs << " ns/receiver\n";
+    std::cout << "(checksum " << std::setprecision(6) << sink << ")\n";
+    return 0;
+}
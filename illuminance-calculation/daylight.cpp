@@ -0,0 +1,249 @@
+#include "daylight.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kDegToRad = kPi / 180.0;
+
+// Receivers (or distinct normals) integrated together per table sweep
+constexpr std::size_t kBlock = 256;
+
+// Gradation (a, b) and indicatrix (c, d, e) parameters of the CIE standard skies
+constexpr std::array<std::array<double, 5>, 15> kCieSkies = {{
+    {4.0, -0.70, 0.0, -1.0, 0.00},   // 1  CIE standard overcast sky
+    {4.0, -0.70, 2.0, -1.5, 0.15},   // 2  Overcast, slight brightening towards the sun
+    {1.1, -0.80, 0.0, -1.0, 0.00},   // 3  Overcast, moderately graded
+    {1.1, -0.80, 2.0, -1.5, 0.15},   // 4  Overcast, moderately graded, slight brightening
+    {0.0, -1.00, 0.0, -1.0, 0.00},   // 5  Sky of uniform luminance
+    {0.0, -1.00, 2.0, -1.5, 0.15},   // 6  Partly cloudy, slight brightening towards the sun
+    {0.0, -1.00, 5.0, -2.5, 0.30},   // 7  Partly cloudy, brighter circumsolar region
+    {0.0, -1.00, 10.0, -3.0, 0.45},  // 8  Partly cloudy, distinct solar corona
+    {-1.0, -0.55, 2.0, -1.5, 0.15},  // 9  Partly cloudy, obscured sun
+    {-1.0, -0.55, 5.0, -2.5, 0.30},  // 10 Partly cloudy, brighter circumsolar region
+    {-1.0, -0.55, 10.0, -3.0, 0.45}, // 11 White-blue sky, distinct solar corona
+    {-1.0, -0.32, 10.0, -3.0, 0.45}, // 12 CIE standard clear sky, low turbidity
+    {-1.0, -0.32, 16.0, -3.0, 0.30}, // 13 CIE standard clear sky, polluted atmosphere
+    {-1.0, -0.15, 16.0, -3.0, 0.30}, // 14 Cloudless turbid sky, broad solar corona
+    {-1.0, -0.15, 24.0, -2.8, 0.15}  // 15 White-blue turbid sky, broad solar corona
+}};
+
+// Gradation function phi(Z) expressed through cos(Z); phi = 1 at the horizon
+inline double gradation(const double a, const double b, const double cosZ) noexcept {
+    return cosZ > 0.0 ? 1.0 + a * std::exp(b / cosZ) : 1.0;
+}
+
+// Scattering indicatrix f(chi)
+inline double indicatrix(const double c, const double d, const double e, const double chi) noexcept {
+    const double cosChi = std::cos(chi);
+    return 1.0 + c * (std::exp(d * chi) - std::exp(d * kPi / 2.0)) + e * cosChi * cosChi;
+}
+
+// Exact bit pattern of a normal, used as a cache key
+struct NormalKey {
+    std::uint64_t x, y, z;
+    bool operator==(const NormalKey& other) const noexcept {
+        return x == other.x && y == other.y && z == other.z;
+    }
+};
+
+struct NormalKeyHash {
+    std::size_t operator()(const NormalKey& k) const noexcept {
+        std::uint64_t h = k.x * 0x9E3779B97F4A7C15ULL;
+        h ^= k.y + 0x9E3779B97F4A7C15ULL + (h << 6) + (h >> 2);
+        h ^= k.z + 0x9E3779B97F4A7C15ULL + (h << 6) + (h >> 2);
+        return static_cast<std::size_t>(h);
+    }
+};
+
+NormalKey keyOf(const double x, const double y, const double z) noexcept {
+    NormalKey k{};
+    std::memcpy(&k.x, &x, sizeof(double));
+    std::memcpy(&k.y, &y, sizeof(double));
+    std::memcpy(&k.z, &z, sizeof(double));
+    return k;
+}
+
+/**
+ * Sky illuminance for normals (nx, ny, nz)[0..count).
+ * The table is swept once per block: the inner loop accumulates one cell's
+ * cosine-weighted contribution into every normal of the block.
+ */
+void integrateSky(const SkyModel& sky, const double* nx, const double* ny, const double* nz,
+                  const std::size_t count, double* out) {
+    const std::size_t cells = sky.cellCount();
+    const double* cx = sky.cellX();
+    const double* cy = sky.cellY();
+    const double* cz = sky.cellZ();
+    const double* w = sky.cellWeight();
+
+    for (std::size_t begin = 0; begin < count; begin += kBlock) {
+        const std::size_t n = std::min(kBlock, count - begin);
+        double* acc = out + begin;
+        std::fill(acc, acc + n, 0.0);
+        for (std::size_t c = 0; c < cells; ++c) {
+            const double dx = cx[c], dy = cy[c], dz = cz[c], wc = w[c];
+            for (std::size_t i = 0; i < n; ++i) {
+                const double cosine = nx[begin + i] * dx + ny[begin + i] * dy + nz[begin + i] * dz;
+                acc[i] += wc * std::max(0.0, cosine);
+            }
+        }
+    }
+}
+
+} // namespace
+
+/**
+ * Solar position from the NOAA general solar position equations.
+ */
+SolarPosition calculateSolarPosition(const double latitude, const double longitude, const int dayOfYear,
+                                     const double hour, const double timezone) {
+    // Fractional year in radians
+    const double gamma = 2.0 * kPi / 365.0 * (dayOfYear - 1 + (hour - timezone - 12.0) / 24.0);
+
+    // Equation of time (minutes) and solar declination (radians)
+    const double eqTime = 229.18 * (0.000075 + 0.001868 * std::cos(gamma) - 0.032077 * std::sin(gamma)
+                                    - 0.014615 * std::cos(2 * gamma) - 0.040849 * std::sin(2 * gamma));
+    const double decl = 0.006918 - 0.399912 * std::cos(gamma) + 0.070257 * std::sin(gamma)
+                      - 0.006758 * std::cos(2 * gamma) + 0.000907 * std::sin(2 * gamma)
+                      - 0.002697 * std::cos(3 * gamma) + 0.00148 * std::sin(3 * gamma);
+
+    // True solar time (minutes) and hour angle (radians)
+    const double trueSolarTime = hour * 60.0 + eqTime + 4.0 * longitude - 60.0 * timezone;
+    const double hourAngle = (trueSolarTime / 4.0 - 180.0) * kDegToRad;
+
+    const double lat = latitude * kDegToRad;
+    const double sinAlt = std::sin(lat) * std::sin(decl) + std::cos(lat) * std::cos(decl) * std::cos(hourAngle);
+
+    SolarPosition sun;
+    sun.altitude = std::asin(std::clamp(sinAlt, -1.0, 1.0));
+    sun.azimuth = std::atan2(std::sin(hourAngle),
+                             std::cos(hourAngle) * std::sin(lat) - std::tan(decl) * std::cos(lat)) + kPi;
+
+    const double cosAlt = std::cos(sun.altitude);
+    sun.direction = {std::sin(sun.azimuth) * cosAlt, std::cos(sun.azimuth) * cosAlt, std::sin(sun.altitude)};
+    return sun;
+}
+
+// Select the CIE parameters and tabulate luminance x solid angle over the hemisphere
+SkyModel::SkyModel(const int cieType, const SolarPosition& sun, const double zenithLuminance,
+                   const int thetaSteps, const int phiSteps)
+    : sun_(sun), zenithLuminance_(zenithLuminance) {
+    const auto& p = kCieSkies[static_cast<std::size_t>(std::clamp(cieType, 1, 15) - 1)];
+    a_ = p[0];
+    b_ = p[1];
+    c_ = p[2];
+    d_ = p[3];
+    e_ = p[4];
+
+    const double sunZenith = kPi / 2.0 - sun_.altitude;
+    norm_ = 1.0 / (indicatrix(c_, d_, e_, sunZenith) * gradation(a_, b_, 1.0));
+
+    const int rings = std::max(1, thetaSteps);
+    const int sectors = std::max(1, phiSteps);
+    const double dTheta = (kPi / 2.0) / rings;
+    const double dPhi = (2.0 * kPi) / sectors;
+
+    const std::size_t cells = static_cast<std::size_t>(rings) * static_cast<std::size_t>(sectors);
+    dx_.reserve(cells);
+    dy_.reserve(cells);
+    dz_.reserve(cells);
+    weight_.reserve(cells);
+
+    for (int t = 0; t < rings; ++t) {
+        const double theta0 = t * dTheta;
+        const double theta1 = theta0 + dTheta;
+        const double theta = theta0 + 0.5 * dTheta;
+        const double solidAngle = (std::cos(theta0) - std::cos(theta1)) * dPhi;
+        for (int s = 0; s < sectors; ++s) {
+            const double phi = (s + 0.5) * dPhi;
+            const Vector3D dir{std::sin(theta) * std::sin(phi), std::sin(theta) * std::cos(phi), std::cos(theta)};
+            dx_.push_back(dir.x);
+            dy_.push_back(dir.y);
+            dz_.push_back(dir.z);
+            weight_.push_back(luminance(dir) * solidAngle);
+        }
+    }
+}
+
+// Analytic CIE luminance; angular distance to the sun from the dot product
+double SkyModel::luminance(const Vector3D& direction) const noexcept {
+    if (direction.z <= 0.0) {
+        return 0.0;
+    }
+    const double chi = std::acos(std::clamp(direction.dot(sun_.direction), -1.0, 1.0));
+    return zenithLuminance_ * norm_ * indicatrix(c_, d_, e_, chi) * gradation(a_, b_, direction.z);
+}
+
+// Single-normal integral over the table
+double SkyModel::irradiance(const Vector3D& normal) const noexcept {
+    double E = 0.0;
+    for (std::size_t c = 0; c < weight_.size(); ++c) {
+        E += weight_[c] * std::max(0.0, normal.x * dx_[c] + normal.y * dy_[c] + normal.z * dz_[c]);
+    }
+    return E;
+}
+
+// Scale zenith luminance and table so the horizontal integral hits the target
+void SkyModel::calibrate(const double diffuseHorizontal) noexcept {
+    const double current = irradiance(Vector3D{0.0, 0.0, 1.0});
+    if (current <= 0.0) {
+        return;
+    }
+    const double scale = diffuseHorizontal / current;
+    zenithLuminance_ *= scale;
+    for (double& w : weight_) {
+        w *= scale;
+    }
+}
+
+/**
+ * Daylight at many receivers.
+ * With caching, receivers are first mapped to their distinct normals, so the
+ * table sweep runs once per orientation rather than once per receiver.
+ */
+std::vector<double> calculateDaylightIlluminance(const SkyModel& sky, const double sunNormalIlluminance,
+                                                 const ReceiverSet& receivers, const bool cacheByNormal) {
+    const std::size_t count = receivers.size();
+    std::vector<double> E(count, 0.0);
+    if (count == 0 || sky.sun().altitude <= 0.0) {
+        return E; // Night: the model covers daylight only
+    }
+
+    if (cacheByNormal) {
+        std::unordered_map<NormalKey, std::size_t, NormalKeyHash> slots;
+        std::vector<std::size_t> slotOf(count);
+        std::vector<double> ux, uy, uz;
+        for (std::size_t i = 0; i < count; ++i) {
+            const auto [it, inserted] = slots.try_emplace(
+                keyOf(receivers.nx[i], receivers.ny[i], receivers.nz[i]), ux.size());
+            if (inserted) {
+                ux.push_back(receivers.nx[i]);
+                uy.push_back(receivers.ny[i]);
+                uz.push_back(receivers.nz[i]);
+            }
+            slotOf[i] = it->second;
+        }
+        std::vector<double> skyE(ux.size());
+        integrateSky(sky, ux.data(), uy.data(), uz.data(), ux.size(), skyE.data());
+        for (std::size_t i = 0; i < count; ++i) {
+            E[i] = skyE[slotOf[i]];
+        }
+    } else {
+        integrateSky(sky, receivers.nx.data(), receivers.ny.data(), receivers.nz.data(), count, E.data());
+    }
+
+    // Direct sun on top of the diffuse sky
+    const Vector3D& s = sky.sun().direction;
+    for (std::size_t i = 0; i < count; ++i) {
+        const double cosine = receivers.nx[i] * s.x + receivers.ny[i] * s.y + receivers.nz[i] * s.z;
+        E[i] += sunNormalIlluminance * std::max(0.0, cosine);
+    }
+
+    return E;
+}
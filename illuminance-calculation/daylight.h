@@ -0,0 +1,130 @@
+#ifndef DAYLIGHT_H
+#define DAYLIGHT_H
+
+#include <cstddef>
+#include <vector>
+#include "vector3d.h"
+#include "receivers.h"
+
+/**
+ * @brief Position of the sun in the sky
+ *
+ * Directions use a local frame with X pointing east, Y north and Z up.
+ */
+class SolarPosition {
+public:
+    double altitude = 0.0; ///< Elevation above the horizon in radians
+    double azimuth = 0.0;  ///< Azimuth in radians, clockwise from north
+    Vector3D direction{};  ///< Unit vector from the ground towards the sun
+};
+
+/**
+ * @brief Calculate the solar position for a place and time
+ *
+ * Uses the NOAA fractional-year approximation for declination and the
+ * equation of time, which is accurate to a fraction of a degree.
+ *
+ * @param latitude Latitude in degrees (north positive)
+ * @param longitude Longitude in degrees (east positive)
+ * @param dayOfYear Day of the year (1 = January 1st)
+ * @param hour Local clock time in hours (e.g. 13.5 for 13:30)
+ * @param timezone Offset of local clock time from UTC in hours
+ * @return Solar altitude, azimuth and direction
+ */
+SolarPosition calculateSolarPosition(double latitude, double longitude, int dayOfYear,
+                                     double hour, double timezone);
+
+/**
+ * @brief CIE standard general sky with a precomputed luminance table
+ *
+ * Implements the 15 sky types of ISO 15469 / CIE S 011, from overcast
+ * (type 1) to clear skies (types 12-15). The relative luminance of a sky
+ * element at zenith angle Z and angular distance chi from the sun is
+ *
+ *     L / Lz = f(chi) * phi(Z) / (f(Zs) * phi(0))
+ *
+ * with the gradation function phi(Z) = 1 + a * exp(b / cos Z) and the
+ * scattering indicatrix f(chi) = 1 + c * (exp(d * chi) - exp(d * pi / 2))
+ * + e * cos^2 chi.
+ *
+ * On construction the upper hemisphere is split into rings of equal zenith
+ * angle and equal azimuth sectors; each cell stores its centre direction and
+ * luminance times solid angle, so that irradiance integrals reduce to a dot
+ * product per cell.
+ */
+class SkyModel {
+public:
+    /**
+     * @brief Build the sky and tabulate its luminance
+     * @param cieType CIE standard sky type, 1-15 (out-of-range values are clamped)
+     * @param sun Position of the sun
+     * @param zenithLuminance Luminance at the zenith (cd/m^2)
+     * @param thetaSteps Number of zenith-angle rings in the table
+     * @param phiSteps Number of azimuth sectors in the table
+     */
+    SkyModel(int cieType, const SolarPosition& sun, double zenithLuminance,
+             int thetaSteps = 32, int phiSteps = 128);
+
+    /**
+     * @brief Evaluate the analytic sky luminance in a direction
+     * @param direction Unit direction towards the sky (Z up)
+     * @return Luminance in cd/m^2, zero below the horizon
+     */
+    double luminance(const Vector3D& direction) const noexcept;
+
+    /**
+     * @brief Integrate the tabulated sky over the hemisphere around a normal
+     * @param normal Unit surface normal
+     * @return Sky illuminance in lux (cosine-weighted, horizon-limited)
+     */
+    double irradiance(const Vector3D& normal) const noexcept;
+
+    /**
+     * @brief Rescale the sky so its horizontal illuminance matches a measurement
+     * @param diffuseHorizontal Measured diffuse horizontal illuminance in lux
+     */
+    void calibrate(double diffuseHorizontal) noexcept;
+
+    /**
+     * @brief Position of the sun the sky was built for
+     */
+    const SolarPosition& sun() const noexcept { return sun_; }
+
+    /**
+     * @brief Number of cells in the luminance table
+     */
+    std::size_t cellCount() const noexcept { return weight_.size(); }
+
+    /// Cell centre directions and luminance x solid angle, structure-of-arrays
+    const double* cellX() const noexcept { return dx_.data(); }
+    const double* cellY() const noexcept { return dy_.data(); }
+    const double* cellZ() const noexcept { return dz_.data(); }
+    const double* cellWeight() const noexcept { return weight_.data(); }
+
+private:
+    SolarPosition sun_;
+    double zenithLuminance_;
+    double a_, b_, c_, d_, e_;  ///< CIE gradation and indicatrix parameters
+    double norm_;               ///< 1 / (f(Zs) * phi(0))
+    std::vector<double> dx_, dy_, dz_, weight_;
+};
+
+/**
+ * @brief Calculate daylight illuminance (sky + sun) at many receivers
+ *
+ * The sky contribution integrates the luminance table over the part of the
+ * hemisphere above each receiver's tangent plane; the inner loop runs over
+ * a block of receivers per table cell and is vectorisable. The direct sun
+ * adds sunNormalIlluminance * max(0, N . S). Receiver normals are used as
+ * given (daylight is one-sided), and no occlusion is considered.
+ *
+ * @param sky Tabulated sky model
+ * @param sunNormalIlluminance Direct normal illuminance of the sun in lux
+ * @param receivers Receiver positions and normals
+ * @param cacheByNormal Integrate the sky once per distinct normal
+ * @return Illuminance in lux at each receiver
+ */
+std::vector<double> calculateDaylightIlluminance(const SkyModel& sky, double sunNormalIlluminance,
+                                                 const ReceiverSet& receivers, bool cacheByNormal = true);
+
+#endif // DAYLIGHT_H
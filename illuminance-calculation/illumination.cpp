@@ -1,5 +1,6 @@
 #include "illumination.h"
 #include "vector3d.h"
+#include "cpu_dispatch.h"
 #include <array>
 #include <cmath>
 
@@ -52,4 +53,86 @@ std::array<double, 3> calculateIllumination(
     };
 
     return E;
+}
+
+namespace {
+
+/**
+ * Batch illumination kernel body, compiled once per instruction set.
+ * Mirrors calculateIllumination step by step: the point on the triangle,
+ * the (normalized) triangle normal, and E = I0 * (s.O) * |s.N| / R^4, where
+ * both cosines contribute one 1/|s| factor each.
+ */
+KERNEL_INLINE void illuminationBatchBody(const IlluminationQuery* queries, const std::size_t count,
+                                         std::array<double, 3>* E) noexcept {
+    for (std::size_t i = 0; i < count; ++i) {
+        const IlluminationQuery& q = queries[i];
+
+        // Triangle edges and their lengths
+        const double e1x = q.P1.x - q.P0.x, e1y = q.P1.y - q.P0.y, e1z = q.P1.z - q.P0.z;
+        const double e2x = q.P2.x - q.P0.x, e2y = q.P2.y - q.P0.y, e2z = q.P2.z - q.P0.z;
+        const double inv1 = 1.0 / std::sqrt(e1x * e1x + e1y * e1y + e1z * e1z);
+        const double inv2 = 1.0 / std::sqrt(e2x * e2x + e2y * e2y + e2z * e2z);
+
+        // Global point from local coordinates
+        const double ptx = q.P0.x + e1x * inv1 * q.x + e2x * inv2 * q.y;
+        const double pty = q.P0.y + e1y * inv1 * q.x + e2y * inv2 * q.y;
+        const double ptz = q.P0.z + e1z * inv1 * q.x + e2z * inv2 * q.y;
+
+        // Unit normal (P2 - P0) x (P1 - P0)
+        const double cx = e2y * e1z - e2z * e1y;
+        const double cy = e2z * e1x - e2x * e1z;
+        const double cz = e2x * e1y - e2y * e1x;
+        const double invN = 1.0 / std::sqrt(cx * cx + cy * cy + cz * cz);
+
+        // Vector from the light to the point
+        const double sx = ptx - q.PL.x, sy = pty - q.PL.y, sz = ptz - q.PL.z;
+        const double R2 = sx * sx + sy * sy + sz * sz;
+
+        const double sN = std::abs(sx * cx + sy * cy + sz * cz) * invN;
+        const double sO = sx * q.O.x + sy * q.O.y + sz * q.O.z;
+        const double g = sO * sN / (R2 * R2);
+
+        E[i] = {q.I0[0] * g, q.I0[1] * g, q.I0[2] * g};
+    }
+}
+
+using IlluminationBatchFn = void (*)(const IlluminationQuery*, std::size_t, std::array<double, 3>*) noexcept;
+
+void illuminationBatchBaseline(const IlluminationQuery* queries, const std::size_t count,
+                               std::array<double, 3>* E) noexcept {
+    illuminationBatchBody(queries, count, E);
+}
+
+#if CPU_DISPATCH_X86
+TARGET_SSE4 void illuminationBatchSse4(const IlluminationQuery* queries, const std::size_t count,
+                                       std::array<double, 3>* E) noexcept {
+    illuminationBatchBody(queries, count, E);
+}
+
+TARGET_AVX2 void illuminationBatchAvx2(const IlluminationQuery* queries, const std::size_t count,
+                                       std::array<double, 3>* E) noexcept {
+    illuminationBatchBody(queries, count, E);
+}
+
+TARGET_AVX512 void illuminationBatchAvx512(const IlluminationQuery* queries, const std::size_t count,
+                                           std::array<double, 3>* E) noexcept {
+    illuminationBatchBody(queries, count, E);
+}
+
+constexpr DispatchTable<IlluminationBatchFn> kIlluminationBatch{
+    illuminationBatchBaseline, illuminationBatchSse4, illuminationBatchAvx2, illuminationBatchAvx512};
+#else
+constexpr DispatchTable<IlluminationBatchFn> kIlluminationBatch{
+    illuminationBatchBaseline, nullptr, nullptr, nullptr};
+#endif
+
+} // namespace
+
+/**
+ * Batch illumination, dispatched to the best kernel variant for this CPU.
+ */
+void calculateIlluminationBatch(const IlluminationQuery* queries, const std::size_t count,
+                                std::array<double, 3>* E) noexcept {
+    kIlluminationBatch.select()(queries, count, E);
 }
\ No newline at end of file
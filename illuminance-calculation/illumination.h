@@ -2,6 +2,7 @@
 #define ILLUMINATION_H
 
 #include <array>
+#include <cstddef>
 #include "vector3d.h"
 
 /**
@@ -34,4 +35,39 @@ std::array<double, 3> calculateIllumination(
     double y
 );
 
+/**
+ * @brief One illumination query: all inputs of calculateIllumination
+ *
+ * The members are laid out as 20 consecutive doubles in the same order as
+ * the interactive prompts, which is also the record layout of the batch
+ * input formats.
+ */
+class IlluminationQuery {
+public:
+    std::array<double, 3> I0{}; ///< Light source intensity as RGB array [R, G, B]
+    Vector3D O{};               ///< Direction vector of the light source axis
+    Vector3D PL{};              ///< Position of the light source in 3D space
+    Vector3D P0{};              ///< First vertex of the triangle
+    Vector3D P1{};              ///< Second vertex of the triangle
+    Vector3D P2{};              ///< Third vertex of the triangle
+    double x = 0.0;             ///< Local coordinate along edge P0->P1
+    double y = 0.0;             ///< Local coordinate along edge P0->P2
+};
+
+/**
+ * @brief Calculate illumination for a batch of queries
+ *
+ * Produces the same values as calling calculateIllumination for every
+ * query, but with the vector algebra written out inline and without
+ * repeated norms, so the loop body is straight-line code. The kernel is
+ * compiled for several instruction sets and the best one for the running
+ * CPU is selected at runtime (see cpu_dispatch.h).
+ *
+ * @param queries Array of queries
+ * @param count Number of queries
+ * @param E Output array receiving RGB illumination per query
+ */
+void calculateIlluminationBatch(const IlluminationQuery* queries, std::size_t count,
+                                std::array<double, 3>* E) noexcept;
+
 #endif // ILLUMINATION_H
\ No newline at end of file
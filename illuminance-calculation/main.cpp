@@ -11,14 +11,347 @@
  * - Light direction and position
  * - Triangle vertices
  * - Local coordinates on the triangle
+ *
+ * Additional non-interactive mode:
+ *   illuminance-calculation --time-series <trajectory.txt> <receivers.txt> <output.bin>
+ * evaluates a moving light over many timesteps and receivers and writes a
+ * binary time x point illuminance matrix (see time_series.h).
+ *
+ *   illuminance-calculation --daylight [--diffuse-horizontal <lux>] [--no-normal-cache]
+ *                           <sky.txt> <receivers.txt>
+ * evaluates sun + CIE standard sky illuminance at each receiver (see daylight.h),
+ * optionally calibrated to a measured diffuse horizontal illuminance.
+ *
+ *   illuminance-calculation --area-light <light.txt> <receivers.txt>
+ * evaluates the irradiance from a polygonal area light at each receiver
+ * (see area_light.h).
+ *
+ *   illuminance-calculation --batch [--binary-input] [--binary-output] [input]
+ * reads a stream of queries from a file (or stdin) and writes one result per
+ * query to stdout without any prompts (see batch_io.h). Degenerate queries
+ * are rejected by validation (see validation.h), produce 0 0 0
+ * and are summarised on stderr.
+ *
+ *   illuminance-calculation --self-test [count]
+ * checks the float32 and Q16.16 kernels against the double reference on
+ * random queries and fails if any result leaves the documented error
+ * envelope (see reduced_precision.h), and checks the polygonal area light
+ * against a dense cloud of point lights covering the same panel.
  */
 
 #include <iostream>
+#include <fstream>
 #include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <string>
+#include <vector>
 #include "vector3d.h"
 #include "illumination.h"
+#include "receivers.h"
+#include "time_series.h"
+#include "daylight.h"
+#include "area_light.h"
+#include "batch_io.h"
+#include "reduced_precision.h"
+#include "validation.h"
+#include "pipeline.h"
+
+/**
+ * @brief Evaluate a light trajectory over a set of receivers
+ * @return Process exit code
+ */
+int runTimeSeries(const std::string& trajectoryPath, const std::string& receiversPath,
+                  const std::string& outputPath) {
+    std::ifstream trajectoryFile(trajectoryPath);
+    if (!trajectoryFile) {
+        std::cerr << "Error: Failed to open '" << trajectoryPath << "'.\n";
+        return 1;
+    }
+    std::vector<PointLightState> trajectory;
+    if (!readTrajectory(trajectoryFile, trajectory)) {
+        std::cerr << "Error: Invalid light trajectory.\n";
+        return 1;
+    }
+
+    std::ifstream receiversFile(receiversPath);
+    if (!receiversFile) {
+        std::cerr << "Error: Failed to open '" << receiversPath << "'.\n";
+        return 1;
+    }
+    ReceiverSet receivers;
+    if (!readReceivers(receiversFile, receivers)) {
+        std::cerr << "Error: Invalid receiver data.\n";
+        return 1;
+    }
+
+    const IlluminanceTimeSeries series = calculateIlluminationTimeSeries(trajectory, receivers);
+    if (!writeTimeSeries(outputPath, series)) {
+        std::cerr << "Error: Failed to write '" << outputPath << "'.\n";
+        return 1;
+    }
+
+    std::cout << "Wrote " << series.steps << " x " << series.points << " illumination matrix to "
+              << outputPath << "\n";
+    return 0;
+}
+
+/**
+ * @brief Evaluate sun and sky illuminance over a set of receivers
+ *
+ * The sky file holds: latitude longitude dayOfYear hour timezone
+ * cieType zenithLuminance sunNormalIlluminance.
+ * Options: --diffuse-horizontal <lux> rescales the sky to a measured diffuse
+ * horizontal illuminance (SkyModel::calibrate); --no-normal-cache integrates
+ * the sky separately for every receiver.
+ *
+ * @return Process exit code
+ */
+int runDaylight(const std::vector<std::string>& args) {
+    double diffuseHorizontal = -1.0;
+    bool cacheByNormal = true;
+    std::vector<std::string> paths;
+    for (std::size_t i = 0; i < args.size(); ++i) {
+        if (args[i] == "--diffuse-horizontal" && i + 1 < args.size()) {
+            char* end = nullptr;
+            diffuseHorizontal = std::strtod(args[++i].c_str(), &end);
+            if (*end != '\0' || !(diffuseHorizontal >= 0.0)) {
+                std::cerr << "Error: Diffuse horizontal illuminance must be a non-negative number.\n";
+                return 1;
+            }
+        } else if (args[i] == "--no-normal-cache") {
+            cacheByNormal = false;
+        } else {
+            paths.push_back(args[i]);
+        }
+    }
+    if (paths.size() != 2) {
+        std::cerr << "Error: Daylight mode needs a sky file and a receiver file.\n";
+        return 1;
+    }
+    const std::string& skyPath = paths[0];
+    const std::string& receiversPath = paths[1];
+
+    std::ifstream skyFile(skyPath);
+    if (!skyFile) {
+        std::cerr << "Error: Failed to open '" << skyPath << "'.\n";
+        return 1;
+    }
+    double latitude, longitude, hour, timezone, zenithLuminance, sunNormalIlluminance;
+    int dayOfYear, cieType;
+    if (!(skyFile >> latitude >> longitude >> dayOfYear >> hour >> timezone
+                  >> cieType >> zenithLuminance >> sunNormalIlluminance)) {
+        std::cerr << "Error: Invalid sky parameters.\n";
+        return 1;
+    }
+    if (cieType < 1 || cieType > 15) {
+        std::cerr << "Error: CIE sky type must be between 1 and 15.\n";
+        return 1;
+    }
+
+    std::ifstream receiversFile(receiversPath);
+    if (!receiversFile) {
+        std::cerr << "Error: Failed to open '" << receiversPath << "'.\n";
+        return 1;
+    }
+    ReceiverSet receivers;
+    if (!readReceivers(receiversFile, receivers)) {
+        std::cerr << "Error: Invalid receiver data.\n";
+        return 1;
+    }
+
+    const SolarPosition sun = calculateSolarPosition(latitude, longitude, dayOfYear, hour, timezone);
+    SkyModel sky(cieType, sun, zenithLuminance);
+    if (diffuseHorizontal >= 0.0) {
+        sky.calibrate(diffuseHorizontal);
+    }
+    const std::vector<double> E = calculateDaylightIlluminance(sky, sunNormalIlluminance, receivers, cacheByNormal);
+
+    for (const double value : E) {
+        std::cout << value << "\n";
+    }
+    return 0;
+}
+
+/**
+ * @brief Evaluate a polygonal area light over a set of receivers
+ *
+ * The light file holds: R G B twoSided vertexCount, then x y z per vertex.
+ *
+ * @return Process exit code
+ */
+int runAreaLight(const std::string& lightPath, const std::string& receiversPath) {
+    std::ifstream lightFile(lightPath);
+    if (!lightFile) {
+        std::cerr << "Error: Failed to open '" << lightPath << "'.\n";
+        return 1;
+    }
+    PolygonLight light;
+    if (!readPolygonLight(lightFile, light)) {
+        std::cerr << "Error: Invalid area light.\n";
+        return 1;
+    }
+
+    std::ifstream receiversFile(receiversPath);
+    if (!receiversFile) {
+        std::cerr << "Error: Failed to open '" << receiversPath << "'.\n";
+        return 1;
+    }
+    ReceiverSet receivers;
+    if (!readReceivers(receiversFile, receivers)) {
+        std::cerr << "Error: Invalid receiver data.\n";
+        return 1;
+    }
+
+    for (const auto& E : calculatePolygonIrradiance(light, receivers)) {
+        std::cout << E[0] << " " << E[1] << " " << E[2] << "\n";
+    }
+    return 0;
+}
+
+/**
+ * @brief Evaluate a stream of queries in fixed-size chunks
+ * @param args Arguments following --batch
+ * @return Process exit code
+ */
+int runBatch(const std::vector<std::string>& args) {
+    BatchFormat inputFormat = BatchFormat::Text;
+    BatchFormat outputFormat = BatchFormat::Text;
+    std::string inputPath = "-";
+    for (const std::string& arg : args) {
+        if (arg == "--binary-input") {
+            inputFormat = BatchFormat::Binary;
+        } else if (arg == "--binary-output") {
+            outputFormat = BatchFormat::Binary;
+        } else {
+            inputPath = arg;
+        }
+    }
+
+    std::FILE* input = stdin;
+    if (inputPath != "-") {
+        input = std::fopen(inputPath.c_str(), "rb");
+        if (!input) {
+            std::cerr << "Error: Failed to open '" << inputPath << "'.\n";
+            return 1;
+        }
+    }
+
+    // reader -> batcher -> evaluator -> writer, overlapping parsing with evaluation
+    constexpr std::size_t chunkSize = 4096;
+    QueryReader reader(input, inputFormat);
+    ResultWriter writer(stdout, outputFormat);
+    ValidationReport report; // Only touched by the evaluator stage
+    std::string failure;
+    try {
+        runPipeline(
+            batched(readQueries(reader), chunkSize),
+            [&report](const std::vector<IlluminationQuery>& queries) {
+                std::vector<std::array<double, 3>> E(queries.size());
+                calculateIlluminationBatchValidated(queries.data(), queries.size(), E.data(), report);
+                return E;
+            },
+            [&writer](const std::vector<std::array<double, 3>>& E) {
+                writer.write(E.data(), E.size());
+            });
+    } catch (const std::exception& e) {
+        failure = e.what();
+    }
+    const bool written = writer.flush();
+
+    if (input != stdin) {
+        std::fclose(input);
+    }
+    if (!failure.empty()) {
+        std::cerr << "Error: " << failure << ".\n";
+        return 1;
+    }
+    if (reader.failed()) {
+        std::cerr << "Error: " << reader.error() << ".\n";
+        return 1;
+    }
+    if (!written) {
+        std::cerr << "Error: Failed to write results.\n";
+        return 1;
+    }
+    if (report.rejected != 0) {
+        std::cerr << "Warning: " << report.rejected << " of " << report.checked
+                  << " queries rejected and written as 0 0 0 (" << report.nonFinite << " non-finite, "
+                  << report.degenerateTriangles << " degenerate triangles, " << report.zeroDirections
+                  << " zero light directions, " << report.coincidentLights << " coincident lights).\n";
+    }
+    return 0;
+}
+
+/**
+ * @brief Verify the reduced-precision kernels against their error envelopes
+ * and the area light against a point-light cloud
+ * @param count Number of random queries
+ * @return Process exit code
+ */
+int runSelfTest(const std::size_t count) {
+    constexpr std::size_t kAreaLightReceivers = 512;
+    constexpr int kAreaLightCells = 200;
+
+    PrecisionCheck f32, q16;
+    checkPrecisionEnvelope(count, 42, f32, q16);
+
+    std::cout << "Checked " << count << " random queries against the double reference\n";
+    std::cout << "float32: " << f32.violations << " violations, worst error " << f32.worstRatio
+              << " of envelope\n";
+    std::cout << "Q16.16:  " << q16.violations << " violations, worst error " << q16.worstRatio
+              << " of envelope\n";
+
+    const AreaLightCheck area = checkPolygonIrradiance(kAreaLightReceivers, 42, kAreaLightCells);
+    std::cout << "Area light: " << area.receivers << " receivers (" << area.clipped
+              << " across the horizon) against " << kAreaLightCells << " x " << kAreaLightCells
+              << " point lights, " << area.violations << " violations, worst error " << area.worstRatio
+              << " of tolerance\n";
+
+    int status = 0;
+    if (f32.violations != 0 || q16.violations != 0) {
+        std::cerr << "Error: Reduced-precision results outside the error envelope.\n";
+        status = 1;
+    }
+    if (area.violations != 0) {
+        std::cerr << "Error: Area light disagrees with the point-light cloud.\n";
+        status = 1;
+    }
+    return status;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1) {
+        const std::string mode = argv[1];
+        if (mode == "--time-series" && argc == 5) {
+            return runTimeSeries(argv[2], argv[3], argv[4]);
+        }
+        if (mode == "--daylight") {
+            return runDaylight(std::vector<std::string>(argv + 2, argv + argc));
+        }
+        if (mode == "--area-light" && argc == 4) {
+            return runAreaLight(argv[2], argv[3]);
+        }
+        if (mode == "--batch") {
+            return runBatch(std::vector<std::string>(argv + 2, argv + argc));
+        }
+        if (mode == "--self-test" && argc <= 3) {
+            const long long count = argc == 3 ? std::atoll(argv[2]) : 1000000;
+            if (count <= 0) {
+                std::cerr << "Error: Query count must be positive.\n";
+                return 1;
+            }
+            return runSelfTest(static_cast<std::size_t>(count));
+        }
+        std::cerr << "Usage: " << argv[0] << " [--time-series <trajectory> <receivers> <output>]"
+                  << " [--daylight [--diffuse-horizontal <lux>] [--no-normal-cache] <sky> <receivers>]"
+                  << " [--area-light <light> <receivers>]"
+                  << " [--batch [--binary-input] [--binary-output] [input]]"
+                  << " [--self-test [count]]\n";
+        return 1;
+    }
 
-int main() {
     std::array<double, 3> I0{};  // Light source intensity (RGB)
     Vector3D O{};                // Direction of the light source axis
     Vector3D PL{};               // Coordinates of the light source
@@ -56,6 +389,13 @@ int main() {
     std::cout << "Enter the local coordinate y: ";
     std::cin >> y;
 
+    // Reject input the formula is undefined for
+    const std::uint8_t defects = classifyQuery({I0, O, PL, P0, P1, P2, x, y});
+    if (defects != DefectNone) {
+        std::cerr << "Error: Invalid input (" << describeDefect(defects) << ").\n";
+        return 1;
+    }
+
     // Calculate illumination at the specified point
     const std::array<double, 3> E = calculateIllumination(I0, O, PL, P0, P1, P2, x, y);
 
@@ -0,0 +1,59 @@
+#include "receivers.h"
+#include "validation.h"
+#include <sstream>
+#include <string>
+
+// Append a receiver with its normal brought to unit length
+void ReceiverSet::add(const Vector3D& point, const Vector3D& normal) {
+    const Vector3D n = normal.normalized();
+    px.push_back(point.x);
+    py.push_back(point.y);
+    pz.push_back(point.z);
+    nx.push_back(n.x);
+    ny.push_back(n.y);
+    nz.push_back(n.z);
+}
+
+// Convert local triangle coordinates to a receiver (mirrors calculateIllumination)
+void ReceiverSet::addTrianglePoint(const Vector3D& P0, const Vector3D& P1, const Vector3D& P2,
+                                   const double x, const double y) {
+    const Vector3D edge1 = (P1 - P0).normalized();
+    const Vector3D edge2 = (P2 - P0).normalized();
+    const Vector3D PT = P0 + edge1 * x + edge2 * y;
+    const Vector3D N = (P2 - P0).cross(P1 - P0);
+    add(PT, N);
+}
+
+// Reserve storage in every component array
+void ReceiverSet::reserve(const std::size_t n) {
+    px.reserve(n);
+    py.reserve(n);
+    pz.reserve(n);
+    nx.reserve(n);
+    ny.reserve(n);
+    nz.reserve(n);
+}
+
+// Parse one triangle point per line until the end of the stream
+bool readReceivers(std::istream& in, ReceiverSet& receivers) {
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.find_first_not_of(" \t\r") == std::string::npos) {
+            continue; // Skip blank lines
+        }
+        std::istringstream fields(line);
+        Vector3D P0{}, P1{}, P2{};
+        double x, y;
+        if (!(fields >> P0.x >> P0.y >> P0.z
+                     >> P1.x >> P1.y >> P1.z
+                     >> P2.x >> P2.y >> P2.z
+                     >> x >> y)) {
+            return false;
+        }
+        if (isDegenerateTriangle(P0, P1, P2)) {
+            return false; // No normal to orient the receiver
+        }
+        receivers.addTrianglePoint(P0, P1, P2, x, y);
+    }
+    return receivers.size() > 0;
+}
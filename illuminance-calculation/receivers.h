@@ -0,0 +1,69 @@
+#ifndef RECEIVERS_H
+#define RECEIVERS_H
+
+#include <cstddef>
+#include <istream>
+#include <vector>
+#include "vector3d.h"
+
+/**
+ * @brief Set of receiver points stored as structure-of-arrays
+ *
+ * Batch kernels iterate over receivers in their inner loop, so positions and
+ * normals are kept in separate contiguous arrays rather than as an array of
+ * Vector3D. This lets the compiler vectorise the per-receiver arithmetic.
+ */
+class ReceiverSet {
+public:
+    std::vector<double> px, py, pz; ///< Receiver positions
+    std::vector<double> nx, ny, nz; ///< Unit surface normals at the receivers
+
+    /**
+     * @brief Append a receiver
+     * @param point Position of the receiver
+     * @param normal Surface normal at the receiver (normalized on insertion)
+     */
+    void add(const Vector3D& point, const Vector3D& normal);
+
+    /**
+     * @brief Append the point at local coordinates (x, y) on a triangle
+     *
+     * Uses the same local-to-global conversion and normal orientation as
+     * calculateIllumination, so results stay comparable with the
+     * single-point calculator.
+     *
+     * @param P0 First vertex of the triangle
+     * @param P1 Second vertex of the triangle
+     * @param P2 Third vertex of the triangle
+     * @param x Local coordinate along edge P0->P1
+     * @param y Local coordinate along edge P0->P2
+     */
+    void addTrianglePoint(const Vector3D& P0, const Vector3D& P1, const Vector3D& P2, double x, double y);
+
+    /**
+     * @brief Reserve storage for a number of receivers
+     * @param n Expected receiver count
+     */
+    void reserve(std::size_t n);
+
+    /**
+     * @brief Number of receivers in the set
+     */
+    std::size_t size() const noexcept { return px.size(); }
+};
+
+/**
+ * @brief Read receivers from a text stream
+ *
+ * One receiver per line, given the same way as in the interactive
+ * calculator: triangle vertices P0, P1, P2 (x y z each) followed by the
+ * local coordinates x and y.
+ *
+ * @param in Input stream
+ * @param receivers Receives the parsed points
+ * @return false if a line is malformed or has a degenerate triangle, or
+ *         no receiver was read
+ */
+bool readReceivers(std::istream& in, ReceiverSet& receivers);
+
+#endif // RECEIVERS_H
@@ -0,0 +1,354 @@
+#include "reduced_precision.h"
+#include "cpu_dispatch.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+std::int32_t toFixed16(const double value) noexcept {
+    const double scaled = std::round(value * 65536.0);
+    if (!(scaled > std::numeric_limits<std::int32_t>::min())) {
+        return std::numeric_limits<std::int32_t>::min();
+    }
+    if (scaled >= std::numeric_limits<std::int32_t>::max()) {
+        return std::numeric_limits<std::int32_t>::max();
+    }
+    return static_cast<std::int32_t>(scaled);
+}
+
+namespace {
+
+std::array<float, 3> toFloat3(const double x, const double y, const double z) noexcept {
+    return {static_cast<float>(x), static_cast<float>(y), static_cast<float>(z)};
+}
+
+std::array<std::int32_t, 3> toFixed3(const double x, const double y, const double z) noexcept {
+    return {toFixed16(x), toFixed16(y), toFixed16(z)};
+}
+
+} // namespace
+
+IlluminationQueryF32 toFloat32(const IlluminationQuery& query) noexcept {
+    IlluminationQueryF32 q;
+    q.I0 = toFloat3(query.I0[0], query.I0[1], query.I0[2]);
+    q.O = toFloat3(query.O.x, query.O.y, query.O.z);
+    q.PL = toFloat3(query.PL.x, query.PL.y, query.PL.z);
+    q.P0 = toFloat3(query.P0.x, query.P0.y, query.P0.z);
+    q.P1 = toFloat3(query.P1.x, query.P1.y, query.P1.z);
+    q.P2 = toFloat3(query.P2.x, query.P2.y, query.P2.z);
+    q.x = static_cast<float>(query.x);
+    q.y = static_cast<float>(query.y);
+    return q;
+}
+
+IlluminationQueryQ16 toFixed16(const IlluminationQuery& query) noexcept {
+    IlluminationQueryQ16 q;
+    q.I0 = toFixed3(query.I0[0], query.I0[1], query.I0[2]);
+    q.O = toFixed3(query.O.x, query.O.y, query.O.z);
+    q.PL = toFixed3(query.PL.x, query.PL.y, query.PL.z);
+    q.P0 = toFixed3(query.P0.x, query.P0.y, query.P0.z);
+    q.P1 = toFixed3(query.P1.x, query.P1.y, query.P1.z);
+    q.P2 = toFixed3(query.P2.x, query.P2.y, query.P2.z);
+    q.x = toFixed16(query.x);
+    q.y = toFixed16(query.y);
+    return q;
+}
+
+namespace {
+
+/**
+ * Single precision kernel body, compiled once per instruction set.
+ * Same steps as the double batch kernel.
+ */
+KERNEL_INLINE void illuminationF32Body(const IlluminationQueryF32* queries, const std::size_t count,
+                                       std::array<float, 3>* E) noexcept {
+    for (std::size_t i = 0; i < count; ++i) {
+        const IlluminationQueryF32& q = queries[i];
+
+        // Triangle edges and their lengths
+        const float e1x = q.P1[0] - q.P0[0], e1y = q.P1[1] - q.P0[1], e1z = q.P1[2] - q.P0[2];
+        const float e2x = q.P2[0] - q.P0[0], e2y = q.P2[1] - q.P0[1], e2z = q.P2[2] - q.P0[2];
+        const float inv1 = 1.0f / std::sqrt(e1x * e1x + e1y * e1y + e1z * e1z);
+        const float inv2 = 1.0f / std::sqrt(e2x * e2x + e2y * e2y + e2z * e2z);
+
+        // Global point from local coordinates
+        const float ptx = q.P0[0] + e1x * inv1 * q.x + e2x * inv2 * q.y;
+        const float pty = q.P0[1] + e1y * inv1 * q.x + e2y * inv2 * q.y;
+        const float ptz = q.P0[2] + e1z * inv1 * q.x + e2z * inv2 * q.y;
+
+        // Unit normal (P2 - P0) x (P1 - P0)
+        const float cx = e2y * e1z - e2z * e1y;
+        const float cy = e2z * e1x - e2x * e1z;
+        const float cz = e2x * e1y - e2y * e1x;
+        const float invN = 1.0f / std::sqrt(cx * cx + cy * cy + cz * cz);
+
+        // Vector from the light to the point
+        const float sx = ptx - q.PL[0], sy = pty - q.PL[1], sz = ptz - q.PL[2];
+        const float R2 = sx * sx + sy * sy + sz * sz;
+
+        const float sN = std::abs(sx * cx + sy * cy + sz * cz) * invN;
+        const float sO = sx * q.O[0] + sy * q.O[1] + sz * q.O[2];
+        const float g = sO * sN / (R2 * R2);
+
+        E[i] = {q.I0[0] * g, q.I0[1] * g, q.I0[2] * g};
+    }
+}
+
+// Seeds of 1/sqrt(m) in Q2.30 for m in [1, 4), 64 intervals per unit of m,
+// evaluated at the interval midpoints; accurate to about 2^-8
+constexpr std::array<std::int32_t, 192> kRsqrtSeeds = [] {
+    std::array<std::int32_t, 192> seeds{};
+    for (std::size_t k = 0; k < seeds.size(); ++k) {
+        const double m = (static_cast<double>(k) + 64.5) / 64.0;
+        double y = 0.5;  // Newton iteration for 1/sqrt(m), exact to double precision
+        for (int step = 0; step < 8; ++step) {
+            y = y * (1.5 - 0.5 * m * y * y);
+        }
+        seeds[k] = static_cast<std::int32_t>(y * 1073741824.0 + 0.5);
+    }
+    return seeds;
+}();
+
+/**
+ * 1/sqrt(value) as mantissa * 2^-(30 + shift), mantissa close to 2^29..2^30.
+ * value is scaled by an even power of two into m in [1, 4), the table
+ * gives 1/sqrt(m) to about 2^-8 and two Newton steps bring it to about
+ * 2^-30, with no division and no loop over the bits. 0 is treated as 1.
+ */
+struct ReciprocalSqrt {
+    std::int64_t mantissa;
+    int shift;
+};
+
+KERNEL_INLINE ReciprocalSqrt rsqrt64(std::uint64_t value) noexcept {
+    value |= static_cast<std::uint64_t>(value == 0);
+    const int exponent = (63 - __builtin_clzll(value)) & ~1;
+    const std::int64_t m = static_cast<std::int64_t>((value << std::max(0, 30 - exponent)) >>
+                                                     std::max(0, exponent - 30));  // Q2.30 in [2^30, 2^32)
+    std::int64_t y = kRsqrtSeeds[static_cast<std::size_t>(m >> 24) - 64];
+    for (int step = 0; step < 2; ++step) {
+        const std::int64_t my2 = (m * ((y * y) >> 30)) >> 30;
+        y = (y * ((std::int64_t{3} << 30) - my2)) >> 31;
+    }
+    return {y, exponent / 2};
+}
+
+// Q16.16 * Q34.30 -> Q16.16 without overflowing 64 bits, saturated to int32
+KERNEL_INLINE std::int32_t scaleQ16(const std::int64_t a, const std::int64_t g) noexcept {
+    const std::int64_t high = g >> 30;
+    const std::int64_t low = g & ((std::int64_t{1} << 30) - 1);
+    const std::int64_t product = a * high + ((a * low + (std::int64_t{1} << 29)) >> 30);
+    return static_cast<std::int32_t>(std::clamp<std::int64_t>(product, std::numeric_limits<std::int32_t>::min(),
+                                                              std::numeric_limits<std::int32_t>::max()));
+}
+
+/**
+ * Fixed point kernel body, compiled once per instruction set.
+ * Inputs are Q16.16, unit vectors Q2.30; every product fits in 64 bits
+ * for the documented input domain. Every length is normalised with
+ * rsqrt64, so the body has no division and no bit-serial square root.
+ */
+KERNEL_INLINE void illuminationQ16Body(const IlluminationQueryQ16* queries, const std::size_t count,
+                                       std::array<std::int32_t, 3>* E) noexcept {
+    constexpr int kUnit = 30;
+    for (std::size_t i = 0; i < count; ++i) {
+        const IlluminationQueryQ16& q = queries[i];
+
+        // Triangle edges (Q16.16) and unit edges (Q2.30): e / |e| = e * rsqrt(e . e)
+        std::int64_t e1[3], e2[3];
+        for (int k = 0; k < 3; ++k) {
+            e1[k] = std::int64_t{q.P1[k]} - q.P0[k];
+            e2[k] = std::int64_t{q.P2[k]} - q.P0[k];
+        }
+        const ReciprocalSqrt inv1 = rsqrt64(static_cast<std::uint64_t>(e1[0] * e1[0] + e1[1] * e1[1] + e1[2] * e1[2]));
+        const ReciprocalSqrt inv2 = rsqrt64(static_cast<std::uint64_t>(e2[0] * e2[0] + e2[1] * e2[1] + e2[2] * e2[2]));
+        std::int64_t u1[3], u2[3];
+        for (int k = 0; k < 3; ++k) {
+            u1[k] = (e1[k] * inv1.mantissa) >> inv1.shift;
+            u2[k] = (e2[k] * inv2.mantissa) >> inv2.shift;
+        }
+
+        // Global point from local coordinates, and the vector from the light to it (Q16.16)
+        std::int64_t s[3];
+        for (int k = 0; k < 3; ++k) {
+            const std::int64_t offset = (u1[k] * q.x + u2[k] * q.y + (std::int64_t{1} << (kUnit - 1))) >> kUnit;
+            s[k] = q.P0[k] + offset - q.PL[k];
+        }
+
+        // Unit normal u2 x u1 (Q2.30)
+        std::int64_t n[3] = {
+            (u2[1] * u1[2] - u2[2] * u1[1]) >> kUnit,
+            (u2[2] * u1[0] - u2[0] * u1[2]) >> kUnit,
+            (u2[0] * u1[1] - u2[1] * u1[0]) >> kUnit
+        };
+        const ReciprocalSqrt invN = rsqrt64(static_cast<std::uint64_t>(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]));
+        for (auto& c : n) {
+            c = (c * invN.mantissa) >> invN.shift;
+        }
+
+        // Unit light-to-point direction (Q2.30); invS also gives 1 / R^2 below
+        const ReciprocalSqrt invS = rsqrt64(static_cast<std::uint64_t>(s[0] * s[0] + s[1] * s[1] + s[2] * s[2]));
+        std::int64_t sHat[3];
+        for (int k = 0; k < 3; ++k) {
+            sHat[k] = (s[k] * invS.mantissa) >> invS.shift;
+        }
+
+        // cos(theta) * |O| and |cos(alpha)|, both Q2.30
+        const std::int64_t cosTheta = (sHat[0] * q.O[0] + sHat[1] * q.O[1] + sHat[2] * q.O[2]) >> 16;
+        const std::int64_t cosAlphaRaw = (sHat[0] * n[0] + sHat[1] * n[1] + sHat[2] * n[2]) >> kUnit;
+        const std::int64_t cosAlpha = cosAlphaRaw < 0 ? -cosAlphaRaw : cosAlphaRaw;
+        const std::int64_t cosProduct = (cosTheta * cosAlpha) >> kUnit;
+
+        // Geometric factor cos(theta) * cos(alpha) / R^2 (Q34.30). R^2 = (s . s) / 2^32 and
+        // 1 / (s . s) = mantissa^2 * 2^-(60 + 2 * shift); distances below 2^-15 are out of range
+        const std::int64_t perLength = (cosProduct * invS.mantissa) >> kUnit;
+        const std::int64_t g = (perLength * invS.mantissa) >> std::max(0, 2 * invS.shift - 2);
+
+        E[i] = {scaleQ16(q.I0[0], g), scaleQ16(q.I0[1], g), scaleQ16(q.I0[2], g)};
+    }
+}
+
+using IlluminationF32Fn = void (*)(const IlluminationQueryF32*, std::size_t, std::array<float, 3>*) noexcept;
+using IlluminationQ16Fn = void (*)(const IlluminationQueryQ16*, std::size_t, std::array<std::int32_t, 3>*) noexcept;
+
+void illuminationF32Baseline(const IlluminationQueryF32* queries, const std::size_t count,
+                             std::array<float, 3>* E) noexcept {
+    illuminationF32Body(queries, count, E);
+}
+
+void illuminationQ16Baseline(const IlluminationQueryQ16* queries, const std::size_t count,
+                             std::array<std::int32_t, 3>* E) noexcept {
+    illuminationQ16Body(queries, count, E);
+}
+
+#if CPU_DISPATCH_X86
+TARGET_SSE4 void illuminationF32Sse4(const IlluminationQueryF32* queries, const std::size_t count,
+                                     std::array<float, 3>* E) noexcept {
+    illuminationF32Body(queries, count, E);
+}
+
+TARGET_AVX2 void illuminationF32Avx2(const IlluminationQueryF32* queries, const std::size_t count,
+                                     std::array<float, 3>* E) noexcept {
+    illuminationF32Body(queries, count, E);
+}
+
+TARGET_AVX512 void illuminationF32Avx512(const IlluminationQueryF32* queries, const std::size_t count,
+                                         std::array<float, 3>* E) noexcept {
+    illuminationF32Body(queries, count, E);
+}
+
+TARGET_SSE4 void illuminationQ16Sse4(const IlluminationQueryQ16* queries, const std::size_t count,
+                                     std::array<std::int32_t, 3>* E) noexcept {
+    illuminationQ16Body(queries, count, E);
+}
+
+TARGET_AVX2 void illuminationQ16Avx2(const IlluminationQueryQ16* queries, const std::size_t count,
+                                     std::array<std::int32_t, 3>* E) noexcept {
+    illuminationQ16Body(queries, count, E);
+}
+
+TARGET_AVX512 void illuminationQ16Avx512(const IlluminationQueryQ16* queries, const std::size_t count,
+                                         std::array<std::int32_t, 3>* E) noexcept {
+    illuminationQ16Body(queries, count, E);
+}
+
+constexpr DispatchTable<IlluminationF32Fn> kIlluminationF32{
+    illuminationF32Baseline, illuminationF32Sse4, illuminationF32Avx2, illuminationF32Avx512};
+constexpr DispatchTable<IlluminationQ16Fn> kIlluminationQ16{
+    illuminationQ16Baseline, illuminationQ16Sse4, illuminationQ16Avx2, illuminationQ16Avx512};
+#else
+constexpr DispatchTable<IlluminationF32Fn> kIlluminationF32{illuminationF32Baseline, nullptr, nullptr, nullptr};
+constexpr DispatchTable<IlluminationQ16Fn> kIlluminationQ16{illuminationQ16Baseline, nullptr, nullptr, nullptr};
+#endif
+
+} // namespace
+
+void calculateIlluminationBatchF32(const IlluminationQueryF32* queries, const std::size_t count,
+                                   std::array<float, 3>* E) noexcept {
+    kIlluminationF32.select()(queries, count, E);
+}
+
+void calculateIlluminationBatchQ16(const IlluminationQueryQ16* queries, const std::size_t count,
+                                   std::array<std::int32_t, 3>* E) noexcept {
+    kIlluminationQ16.select()(queries, count, E);
+}
+
+namespace {
+
+// Random query in the self-test domain (see checkPrecisionEnvelope)
+IlluminationQuery randomQuery(std::mt19937_64& rng) {
+    std::uniform_real_distribution<double> coordinate(-100.0, 100.0);
+    std::uniform_real_distribution<double> direction(-1.0, 1.0);
+    std::uniform_real_distribution<double> intensity(0.0, 1000.0);
+    std::uniform_real_distribution<double> local(0.0, 5.0);
+    for (;;) {
+        IlluminationQuery q;
+        q.I0 = {intensity(rng), intensity(rng), intensity(rng)};
+        q.O = {direction(rng), direction(rng), direction(rng)};
+        q.PL = {coordinate(rng), coordinate(rng), coordinate(rng)};
+        q.P0 = {coordinate(rng), coordinate(rng), coordinate(rng)};
+        q.P1 = {coordinate(rng), coordinate(rng), coordinate(rng)};
+        q.P2 = {coordinate(rng), coordinate(rng), coordinate(rng)};
+        q.x = local(rng);
+        q.y = local(rng);
+
+        const Vector3D u1 = (q.P1 - q.P0).normalized();
+        const Vector3D u2 = (q.P2 - q.P0).normalized();
+        const Vector3D PT = q.P0 + u1 * q.x + u2 * q.y;
+        if (u2.cross(u1).norm() >= 0.01 && (PT - q.PL).norm() >= 0.1) {
+            return q;
+        }
+    }
+}
+
+// Record |error| / bound for every channel of one result
+void accumulate(PrecisionCheck& check, const PrecisionEnvelope& envelope, const IlluminationQuery& q,
+                const std::array<double, 3>& reference, const std::array<double, 3>& E) {
+    const Vector3D PT = q.P0 + (q.P1 - q.P0).normalized() * q.x + (q.P2 - q.P0).normalized() * q.y;
+    const Vector3D s = PT - q.PL;
+    const double scale = q.O.norm() / s.dot(s);
+    for (int c = 0; c < 3; ++c) {
+        const double bound = envelope.relative * std::abs(q.I0[c]) * scale + envelope.absolute;
+        const double ratio = std::abs(E[c] - reference[c]) / bound;
+        if (!(ratio <= 1.0)) {
+            ++check.violations;
+        }
+        check.worstRatio = std::max(check.worstRatio, std::isnan(ratio) ? INFINITY : ratio);
+    }
+}
+
+} // namespace
+
+void checkPrecisionEnvelope(const std::size_t count, const std::uint64_t seed, PrecisionCheck& f32,
+                            PrecisionCheck& q16) {
+    constexpr std::size_t kChunk = 4096;
+    std::mt19937_64 rng(seed);
+    std::vector<IlluminationQuery> queries(kChunk);
+    std::vector<IlluminationQueryF32> queriesF32(kChunk);
+    std::vector<IlluminationQueryQ16> queriesQ16(kChunk);
+    std::vector<std::array<float, 3>> EF32(kChunk);
+    std::vector<std::array<std::int32_t, 3>> EQ16(kChunk);
+
+    f32 = PrecisionCheck{};
+    q16 = PrecisionCheck{};
+    for (std::size_t done = 0; done < count; done += kChunk) {
+        const std::size_t n = std::min(kChunk, count - done);
+        for (std::size_t i = 0; i < n; ++i) {
+            queries[i] = randomQuery(rng);
+            queriesF32[i] = toFloat32(queries[i]);
+            queriesQ16[i] = toFixed16(queries[i]);
+        }
+        calculateIlluminationBatchF32(queriesF32.data(), n, EF32.data());
+        calculateIlluminationBatchQ16(queriesQ16.data(), n, EQ16.data());
+
+        for (std::size_t i = 0; i < n; ++i) {
+            const IlluminationQuery& q = queries[i];
+            const std::array<double, 3> reference =
+                calculateIllumination(q.I0, q.O, q.PL, q.P0, q.P1, q.P2, q.x, q.y);
+            accumulate(f32, kFloat32Envelope, q, reference, {EF32[i][0], EF32[i][1], EF32[i][2]});
+            accumulate(q16, kFixed16Envelope, q, reference,
+                       {fromFixed16(EQ16[i][0]), fromFixed16(EQ16[i][1]), fromFixed16(EQ16[i][2])});
+        }
+    }
+}
@@ -0,0 +1,147 @@
+#ifndef REDUCED_PRECISION_H
+#define REDUCED_PRECISION_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "illumination.h"
+
+/**
+ * @brief Illumination query in single precision
+ *
+ * Same members and order as IlluminationQuery, as 20 consecutive floats.
+ */
+class IlluminationQueryF32 {
+public:
+    std::array<float, 3> I0{}; ///< Light source intensity [R, G, B]
+    std::array<float, 3> O{};  ///< Direction vector of the light source axis
+    std::array<float, 3> PL{}; ///< Position of the light source
+    std::array<float, 3> P0{}; ///< First vertex of the triangle
+    std::array<float, 3> P1{}; ///< Second vertex of the triangle
+    std::array<float, 3> P2{}; ///< Third vertex of the triangle
+    float x = 0.0f;            ///< Local coordinate along edge P0->P1
+    float y = 0.0f;            ///< Local coordinate along edge P0->P2
+};
+
+/**
+ * @brief Illumination query in Q16.16 fixed point
+ *
+ * Same members and order as IlluminationQuery; every value is a signed
+ * 32-bit integer holding value * 65536.
+ */
+class IlluminationQueryQ16 {
+public:
+    std::array<std::int32_t, 3> I0{}; ///< Light source intensity [R, G, B]
+    std::array<std::int32_t, 3> O{};  ///< Direction vector of the light source axis
+    std::array<std::int32_t, 3> PL{}; ///< Position of the light source
+    std::array<std::int32_t, 3> P0{}; ///< First vertex of the triangle
+    std::array<std::int32_t, 3> P1{}; ///< Second vertex of the triangle
+    std::array<std::int32_t, 3> P2{}; ///< Third vertex of the triangle
+    std::int32_t x = 0;               ///< Local coordinate along edge P0->P1
+    std::int32_t y = 0;               ///< Local coordinate along edge P0->P2
+};
+
+/**
+ * @brief Convert a value to Q16.16, rounding to nearest and saturating
+ */
+std::int32_t toFixed16(double value) noexcept;
+
+/**
+ * @brief Convert a Q16.16 value back to double
+ */
+constexpr double fromFixed16(const std::int32_t value) noexcept {
+    return static_cast<double>(value) / 65536.0;
+}
+
+/**
+ * @brief Convert a query to single precision
+ */
+IlluminationQueryF32 toFloat32(const IlluminationQuery& query) noexcept;
+
+/**
+ * @brief Convert a query to Q16.16 fixed point
+ */
+IlluminationQueryQ16 toFixed16(const IlluminationQuery& query) noexcept;
+
+/**
+ * @brief Calculate illumination for a batch of queries in single precision
+ *
+ * Same formula as calculateIlluminationBatch with all arithmetic in float.
+ * Runtime-dispatched like the double kernel (see cpu_dispatch.h).
+ *
+ * @param queries Array of queries
+ * @param count Number of queries
+ * @param E Output array receiving RGB illumination per query
+ */
+void calculateIlluminationBatchF32(const IlluminationQueryF32* queries, std::size_t count,
+                                   std::array<float, 3>* E) noexcept;
+
+/**
+ * @brief Calculate illumination for a batch of queries in Q16.16 fixed point
+ *
+ * Integer-only arithmetic with 64-bit intermediates: unit vectors are
+ * carried in Q2.30 and the geometric factor cos(theta) * cos(alpha) / R^2 in
+ * Q34.30, so no 128-bit products or floating point are needed. Lengths are
+ * normalised with a table-seeded reciprocal square root refined by two
+ * Newton steps, so the kernel has no divisions. Results are
+ * Q16.16 and saturate at the int32 range. Queries with zero-length edges,
+ * normal or light distance produce finite garbage instead of trapping.
+ *
+ * Valid input domain: coordinates within +-8192, |O| <= 2, light to point
+ * distance >= 0.05 and results below 32768.
+ *
+ * @param queries Array of queries
+ * @param count Number of queries
+ * @param E Output array receiving Q16.16 RGB illumination per query
+ */
+void calculateIlluminationBatchQ16(const IlluminationQueryQ16* queries, std::size_t count,
+                                   std::array<std::int32_t, 3>* E) noexcept;
+
+/**
+ * @brief Error envelope of a reduced-precision kernel
+ *
+ * Per channel c, for inputs in the self-test domain (see
+ * checkPrecisionEnvelope), the result stays within
+ *
+ *   |E_c - E_ref_c| <= relative * |I0_c| * |O| / R^2 + absolute
+ *
+ * of the double reference calculateIllumination on the original double
+ * inputs. |I0_c| * |O| / R^2 is the illuminance the light would give with
+ * both cosines equal to 1, so the bound scales with the attenuation but
+ * does not blow up where the cosines cancel to zero.
+ */
+struct PrecisionEnvelope {
+    double relative; ///< Bound relative to |I0_c| * |O| / R^2
+    double absolute; ///< Absolute bound, in lux
+};
+
+/// Envelope of calculateIlluminationBatchF32, including input rounding to float
+inline constexpr PrecisionEnvelope kFloat32Envelope{1.5e-5, 1e-7};
+
+/// Envelope of calculateIlluminationBatchQ16, including input rounding to Q16.16
+inline constexpr PrecisionEnvelope kFixed16Envelope{1e-4, 2.0 / 65536.0};
+
+/**
+ * @brief Result of checkPrecisionEnvelope for one kernel
+ */
+struct PrecisionCheck {
+    std::size_t violations = 0; ///< Channels outside the envelope
+    double worstRatio = 0.0;    ///< Largest |error| / bound seen (<= 1 when passing)
+};
+
+/**
+ * @brief Verify both reduced-precision kernels against the double reference
+ *
+ * Generates count random queries in the documented domain: vertices and
+ * light position in [-100, 100]^3, O components in [-1, 1], I0 in
+ * [0, 1000], local coordinates in [0, 5], triangle angles of at least about
+ * 0.5 degrees and light to point distances of at least 0.1.
+ *
+ * @param count Number of random queries
+ * @param seed Random seed
+ * @param f32 Receives the single precision result
+ * @param q16 Receives the fixed point result
+ */
+void checkPrecisionEnvelope(std::size_t count, std::uint64_t seed, PrecisionCheck& f32, PrecisionCheck& q16);
+
+#endif // REDUCED_PRECISION_H
@@ -0,0 +1,123 @@
+#include "time_series.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+// Receivers per block; the block's positions and normals stay in L1/L2 while
+// every timestep sweeps over them
+constexpr std::size_t kPointBlock = 512;
+
+// Append an unsigned integer in little-endian byte order
+template <typename T>
+void putLittleEndian(std::vector<char>& out, T value) {
+    for (std::size_t i = 0; i < sizeof(T); ++i) {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+} // namespace
+
+/**
+ * Sweep over receiver blocks, each visited by every timestep in turn.
+ * Per-step light parameters are hoisted out of the receiver loop, which
+ * then reduces to a handful of multiply-adds, one square root and one
+ * division per receiver.
+ */
+IlluminanceTimeSeries calculateIlluminationTimeSeries(const std::vector<PointLightState>& trajectory,
+                                                      const ReceiverSet& receivers) {
+    IlluminanceTimeSeries series;
+    series.steps = trajectory.size();
+    series.points = receivers.size();
+    series.data.assign(series.steps * series.points * 3, 0.0f);
+
+    const std::size_t points = series.points;
+    std::vector<double> g(kPointBlock);
+
+    for (std::size_t p0 = 0; p0 < points; p0 += kPointBlock) {
+        const std::size_t n = std::min(kPointBlock, points - p0);
+        const double* px = receivers.px.data() + p0;
+        const double* py = receivers.py.data() + p0;
+        const double* pz = receivers.pz.data() + p0;
+        const double* nx = receivers.nx.data() + p0;
+        const double* ny = receivers.ny.data() + p0;
+        const double* nz = receivers.nz.data() + p0;
+
+        for (std::size_t t = 0; t < series.steps; ++t) {
+            const PointLightState& light = trajectory[t];
+            const double lx = light.PL.x, ly = light.PL.y, lz = light.PL.z;
+            const double ox = light.O.x, oy = light.O.y, oz = light.O.z;
+
+            // Geometric factor cos(theta) * cos(alpha) / R^2 for the block
+            for (std::size_t i = 0; i < n; ++i) {
+                const double sx = px[i] - lx;
+                const double sy = py[i] - ly;
+                const double sz = pz[i] - lz;
+                const double R2 = sx * sx + sy * sy + sz * sz;
+                const double cos_alpha = std::abs(sx * nx[i] + sy * ny[i] + sz * nz[i]);
+                const double cos_theta = sx * ox + sy * oy + sz * oz;
+                // Both cosines carry a 1/|s| factor, so together they contribute 1/R^2
+                g[i] = cos_theta * cos_alpha / (R2 * R2);
+            }
+
+            float* row = series.data.data() + (t * points + p0) * 3;
+            for (std::size_t i = 0; i < n; ++i) {
+                row[3 * i + 0] = static_cast<float>(light.I0[0] * g[i]);
+                row[3 * i + 1] = static_cast<float>(light.I0[1] * g[i]);
+                row[3 * i + 2] = static_cast<float>(light.I0[2] * g[i]);
+            }
+        }
+    }
+
+    return series;
+}
+
+// Parse one light state per line until the end of the stream
+bool readTrajectory(std::istream& in, std::vector<PointLightState>& trajectory) {
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.find_first_not_of(" \t\r") == std::string::npos) {
+            continue; // Skip blank lines
+        }
+        std::istringstream fields(line);
+        PointLightState state;
+        if (!(fields >> state.I0[0] >> state.I0[1] >> state.I0[2]
+                     >> state.O.x >> state.O.y >> state.O.z
+                     >> state.PL.x >> state.PL.y >> state.PL.z)) {
+            return false;
+        }
+        trajectory.push_back(state);
+    }
+    return !trajectory.empty();
+}
+
+// Serialize header and matrix into one buffer and write it in a single call
+bool writeTimeSeries(const std::string& path, const IlluminanceTimeSeries& series) {
+    std::vector<char> buffer;
+    buffer.reserve(28 + series.data.size() * sizeof(float));
+    buffer.insert(buffer.end(), {'I', 'L', 'T', 'S'});
+    putLittleEndian<std::uint32_t>(buffer, 1);
+    putLittleEndian<std::uint64_t>(buffer, series.steps);
+    putLittleEndian<std::uint64_t>(buffer, series.points);
+    putLittleEndian<std::uint32_t>(buffer, 3);
+
+    if constexpr (std::endian::native == std::endian::little) {
+        const auto* bytes = reinterpret_cast<const char*>(series.data.data());
+        buffer.insert(buffer.end(), bytes, bytes + series.data.size() * sizeof(float));
+    } else {
+        for (const float value : series.data) {
+            std::uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            putLittleEndian<std::uint32_t>(buffer, bits);
+        }
+    }
+
+    std::ofstream out(path, std::ios::binary);
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,77 @@
+#ifndef TIME_SERIES_H
+#define TIME_SERIES_H
+
+#include <array>
+#include <cstddef>
+#include <istream>
+#include <string>
+#include <vector>
+#include "vector3d.h"
+#include "receivers.h"
+
+/**
+ * @brief State of the directional point light at one timestep
+ *
+ * Holds the same parameters that calculateIllumination takes for the light.
+ */
+class PointLightState {
+public:
+    std::array<double, 3> I0{}; ///< Light source intensity as RGB array [R, G, B]
+    Vector3D O{};               ///< Direction vector of the light source axis
+    Vector3D PL{};              ///< Position of the light source in 3D space
+};
+
+/**
+ * @brief Illuminance matrix of size timesteps x receivers
+ *
+ * Stored time-major in single precision: the RGB value for timestep t and
+ * receiver i starts at data[(t * points + i) * 3].
+ */
+class IlluminanceTimeSeries {
+public:
+    std::size_t steps = 0;   ///< Number of timesteps (rows)
+    std::size_t points = 0;  ///< Number of receivers (columns)
+    std::vector<float> data; ///< Interleaved RGB illuminance values
+};
+
+/**
+ * @brief Calculate illuminance at every receiver for every timestep
+ *
+ * Receiver geometry is computed once up front; the sweep then runs over
+ * blocks of receivers, and every timestep visits a block while its data is
+ * still in cache. The inner
+ * loop over receivers is branch-free and vectorisable. Each entry equals
+ * calculateIllumination for the same light state and receiver.
+ *
+ * @param trajectory Light state per timestep
+ * @param receivers Receiver positions and normals
+ * @return Illuminance matrix
+ */
+IlluminanceTimeSeries calculateIlluminationTimeSeries(const std::vector<PointLightState>& trajectory,
+                                                      const ReceiverSet& receivers);
+
+/**
+ * @brief Read a light trajectory from a text stream
+ *
+ * One timestep per line: I0 (R G B), O (x y z), PL (x y z).
+ *
+ * @param in Input stream
+ * @param trajectory Receives the parsed light states
+ * @return false if a line is malformed or no timestep was read
+ */
+bool readTrajectory(std::istream& in, std::vector<PointLightState>& trajectory);
+
+/**
+ * @brief Write an illuminance matrix as compact binary
+ *
+ * Layout (little-endian): magic "ILTS", uint32 version (1), uint64 steps,
+ * uint64 points, uint32 channels (3), followed by steps * points * 3
+ * float32 values in the order of IlluminanceTimeSeries::data.
+ *
+ * @param path Output file path
+ * @param series Matrix to write
+ * @return false if the file could not be written
+ */
+bool writeTimeSeries(const std::string& path, const IlluminanceTimeSeries& series);
+
+#endif // TIME_SERIES_H
@@ -0,0 +1,201 @@
+#include "validation.h"
+#include <algorithm>
+#include <cmath>
+#include "cpu_dispatch.h"
+#include <vector>
+
+namespace {
+
+// Relative tolerances of the degeneracy tests
+constexpr double kMinSine = 1e-9;
+constexpr double kCoincidence = 1e-9;
+
+// Queries validated and evaluated together; 40 KiB, so the block stays in cache
+constexpr std::size_t kBlock = 256;
+
+// x - x is 0 for every finite x and NaN for NaN and infinity
+KERNEL_INLINE double difference(const double x) noexcept {
+    return x - x;
+}
+
+KERNEL_INLINE double difference(const Vector3D& v) noexcept {
+    return (v.x - v.x) + (v.y - v.y) + (v.z - v.z);
+}
+
+/**
+ * Defect flags of one query, written without early exits so the
+ * classification loop compiles to straight-line code. All tests compare
+ * squared quantities; each input is tested for NaN and infinity on its own,
+ * so large finite inputs cannot overflow into a false alarm.
+ */
+KERNEL_INLINE std::uint8_t queryDefects(const IlluminationQuery& q) noexcept {
+    // A sum of zeros and NaNs: 0 unless some input is not finite, and it cannot overflow
+    const double zero = difference(q.I0[0]) + difference(q.I0[1]) + difference(q.I0[2]) + difference(q.O) +
+                        difference(q.PL) + difference(q.P0) + difference(q.P1) + difference(q.P2) +
+                        difference(q.x) + difference(q.y);
+    const bool nonFinite = !(zero == 0.0);
+
+    // Triangle: the sine of the angle at P0 must exceed kMinSine
+    const Vector3D e1 = q.P1 - q.P0;
+    const Vector3D e2 = q.P2 - q.P0;
+    const Vector3D c = e2.cross(e1);
+    const double l1 = e1.dot(e1);
+    const double l2 = e2.dot(e2);
+    const bool degenerate = !(l1 > 0.0) | !(l2 > 0.0) | !(c.dot(c) > kMinSine * kMinSine * l1 * l2);
+
+    const bool zeroDirection = !(q.O.dot(q.O) > 0.0);
+
+    // Point on the triangle, with unit edges as in calculateIllumination
+    const double inv1 = 1.0 / std::sqrt(l1);
+    const double inv2 = 1.0 / std::sqrt(l2);
+    const Vector3D s = q.P0 + e1 * (inv1 * q.x) + e2 * (inv2 * q.y) - q.PL;
+    const double tolerance2 = kCoincidence * kCoincidence * (1.0 + q.PL.dot(q.PL));
+    const bool coincident = !(s.dot(s) > tolerance2);
+
+    // A non-finite or degenerate query only reports that reason
+    const bool finite = !nonFinite;
+    return static_cast<std::uint8_t>(nonFinite * DefectNonFinite | (finite & degenerate) * DefectDegenerateTriangle |
+                                     (finite & zeroDirection) * DefectZeroDirection |
+                                     (finite & !degenerate & coincident) * DefectCoincidentLight);
+}
+
+/**
+ * Classify the queries and count their defects. The classification loop
+ * only stores flags, so nothing but the tests themselves runs per query;
+ * counting runs over the flags after it. Counts are kept in a local report
+ * so the byte stores to defects cannot force them back to memory.
+ */
+KERNEL_INLINE std::size_t classifyBody(const IlluminationQuery* queries, const std::size_t count,
+                                       std::uint8_t* defects, ValidationReport& report) noexcept {
+    std::size_t valid = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        const std::uint8_t d = queryDefects(queries[i]);
+        defects[i] = d;
+        valid += d == DefectNone;
+    }
+    ValidationReport local;
+    for (std::size_t i = 0; i < count; ++i) {
+        local.add(defects[i]);
+    }
+    report.add(local);
+    return valid;
+}
+
+using ClassifyFn = std::size_t (*)(const IlluminationQuery*, std::size_t, std::uint8_t*, ValidationReport&) noexcept;
+
+std::size_t classifyBaseline(const IlluminationQuery* queries, const std::size_t count, std::uint8_t* defects,
+                             ValidationReport& report) noexcept {
+    return classifyBody(queries, count, defects, report);
+}
+
+#if CPU_DISPATCH_X86
+TARGET_SSE4 std::size_t classifySse4(const IlluminationQuery* queries, const std::size_t count,
+                                     std::uint8_t* defects, ValidationReport& report) noexcept {
+    return classifyBody(queries, count, defects, report);
+}
+
+TARGET_AVX2 std::size_t classifyAvx2(const IlluminationQuery* queries, const std::size_t count,
+                                     std::uint8_t* defects, ValidationReport& report) noexcept {
+    return classifyBody(queries, count, defects, report);
+}
+
+TARGET_AVX512 std::size_t classifyAvx512(const IlluminationQuery* queries, const std::size_t count,
+                                         std::uint8_t* defects, ValidationReport& report) noexcept {
+    return classifyBody(queries, count, defects, report);
+}
+
+constexpr DispatchTable<ClassifyFn> kClassify{classifyBaseline, classifySse4, classifyAvx2, classifyAvx512};
+#else
+constexpr DispatchTable<ClassifyFn> kClassify{classifyBaseline, nullptr, nullptr, nullptr};
+#endif
+
+} // namespace
+
+void ValidationReport::add(const std::uint8_t defects) noexcept {
+    ++checked;
+    rejected += defects != DefectNone;
+    nonFinite += (defects & DefectNonFinite) != 0;
+    degenerateTriangles += (defects & DefectDegenerateTriangle) != 0;
+    zeroDirections += (defects & DefectZeroDirection) != 0;
+    coincidentLights += (defects & DefectCoincidentLight) != 0;
+}
+
+void ValidationReport::add(const ValidationReport& other) noexcept {
+    checked += other.checked;
+    rejected += other.rejected;
+    nonFinite += other.nonFinite;
+    degenerateTriangles += other.degenerateTriangles;
+    zeroDirections += other.zeroDirections;
+    coincidentLights += other.coincidentLights;
+}
+
+// Compare squared quantities so no square root or division is needed
+bool isDegenerateTriangle(const Vector3D& P0, const Vector3D& P1, const Vector3D& P2) noexcept {
+    const Vector3D e1 = P1 - P0;
+    const Vector3D e2 = P2 - P0;
+    const Vector3D c = e2.cross(e1);
+    const double l1 = e1.dot(e1);
+    const double l2 = e2.dot(e2);
+    return !(l1 > 0.0) || !(l2 > 0.0) || !(c.dot(c) > kMinSine * kMinSine * l1 * l2);
+}
+
+std::uint8_t classifyQuery(const IlluminationQuery& q) noexcept {
+    return queryDefects(q);
+}
+
+const char* describeDefect(const std::uint8_t defects) noexcept {
+    if (defects & DefectNonFinite) {
+        return "non-finite input";
+    }
+    if (defects & DefectDegenerateTriangle) {
+        return "degenerate triangle";
+    }
+    if (defects & DefectZeroDirection) {
+        return "zero light direction";
+    }
+    if (defects & DefectCoincidentLight) {
+        return "light coincides with the point";
+    }
+    return "valid";
+}
+
+std::size_t validateQueries(const IlluminationQuery* queries, const std::size_t count, std::uint8_t* defects,
+                            ValidationReport& report) noexcept {
+    return kClassify.select()(queries, count, defects, report);
+}
+
+/**
+ * One pass over memory: each block is classified, compacted and evaluated
+ * while it is in cache, instead of a validation sweep over the whole batch
+ * followed by the kernel's own sweep. An all-valid block goes to the kernel
+ * in place.
+ */
+void calculateIlluminationBatchValidated(const IlluminationQuery* queries, const std::size_t count,
+                                         std::array<double, 3>* E, ValidationReport& report) {
+    const ClassifyFn classify = kClassify.select();
+    std::array<std::uint8_t, kBlock> defects;
+    std::vector<IlluminationQuery> accepted(std::min(count, kBlock));
+    std::vector<std::array<double, 3>> results(accepted.size());
+    for (std::size_t begin = 0; begin < count; begin += kBlock) {
+        const std::size_t size = std::min(kBlock, count - begin);
+        const IlluminationQuery* block = queries + begin;
+        const std::size_t valid = classify(block, size, defects.data(), report);
+        if (valid == size) {
+            calculateIlluminationBatch(block, size, E + begin);
+            continue;
+        }
+
+        std::size_t next = 0;
+        for (std::size_t i = 0; i < size; ++i) {
+            if (defects[i] == DefectNone) {
+                accepted[next++] = block[i];
+            }
+        }
+        calculateIlluminationBatch(accepted.data(), valid, results.data());
+
+        next = 0;
+        for (std::size_t i = 0; i < size; ++i) {
+            E[begin + i] = defects[i] == DefectNone ? results[next++] : std::array<double, 3>{0.0, 0.0, 0.0};
+        }
+    }
+}
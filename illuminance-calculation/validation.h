@@ -0,0 +1,105 @@
+#ifndef VALIDATION_H
+#define VALIDATION_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "vector3d.h"
+#include "illumination.h"
+
+/**
+ * @brief Reasons a query is rejected by validation (bit flags)
+ *
+ * Each of these makes calculateIllumination divide by zero or return
+ * NaN/infinity, which then spreads through any reduction over the results.
+ */
+enum QueryDefect : std::uint8_t {
+    DefectNone = 0,
+    DefectNonFinite = 1 << 0,          ///< An input is NaN or infinite
+    DefectDegenerateTriangle = 1 << 1, ///< Zero-length edge or collinear vertices
+    DefectZeroDirection = 1 << 2,      ///< Light axis O is the zero vector
+    DefectCoincidentLight = 1 << 3     ///< The point on the triangle coincides with the light
+};
+
+/**
+ * @brief Counts of rejected queries by defect
+ *
+ * A query with several defects is counted once per defect but only once
+ * in rejected.
+ */
+class ValidationReport {
+public:
+    std::size_t checked = 0;             ///< Queries classified
+    std::size_t rejected = 0;            ///< Queries with at least one defect
+    std::size_t nonFinite = 0;           ///< Queries with DefectNonFinite
+    std::size_t degenerateTriangles = 0; ///< Queries with DefectDegenerateTriangle
+    std::size_t zeroDirections = 0;      ///< Queries with DefectZeroDirection
+    std::size_t coincidentLights = 0;    ///< Queries with DefectCoincidentLight
+
+    /**
+     * @brief Count one classified query
+     * @param defects QueryDefect flags of the query
+     */
+    void add(std::uint8_t defects) noexcept;
+
+    /**
+     * @brief Add the counts of another report
+     */
+    void add(const ValidationReport& other) noexcept;
+};
+
+/**
+ * @brief Check whether a triangle has a zero-length edge or collinear vertices
+ *
+ * The triangle is degenerate when the sine of the angle at P0 is below
+ * 1e-9, i.e. when its normal cannot be computed reliably.
+ */
+bool isDegenerateTriangle(const Vector3D& P0, const Vector3D& P1, const Vector3D& P2) noexcept;
+
+/**
+ * @brief Classify one query
+ *
+ * The light counts as coincident with the point when their distance is
+ * below 1e-9 * sqrt(1 + |PL|^2), i.e. within rounding of the scene
+ * coordinates. A non-finite query is only flagged DefectNonFinite, and a
+ * degenerate triangle is not checked for a coincident light.
+ *
+ * @return QueryDefect flags, DefectNone for a valid query
+ */
+std::uint8_t classifyQuery(const IlluminationQuery& query) noexcept;
+
+/**
+ * @brief Human-readable description of the first defect in a set of flags
+ * @param defects QueryDefect flags
+ * @return Description such as "degenerate triangle", or "valid"
+ */
+const char* describeDefect(std::uint8_t defects) noexcept;
+
+/**
+ * @brief Classify a batch of queries
+ * @param queries Array of queries
+ * @param count Number of queries
+ * @param defects Output array receiving the QueryDefect flags per query
+ * @param report Accumulates the defect counts
+ * @return Number of valid queries
+ */
+std::size_t validateQueries(const IlluminationQuery* queries, std::size_t count, std::uint8_t* defects,
+                            ValidationReport& report) noexcept;
+
+/**
+ * @brief Calculate illumination for a batch of queries, rejecting bad rows first
+ *
+ * Classifies, compacts and evaluates the queries in blocks that stay in
+ * cache, so calculateIlluminationBatch only sees valid queries and the
+ * queries are read from memory once. Rejected queries receive {0, 0, 0}.
+ * An all-valid block is passed to the kernel as is, without copying.
+ *
+ * @param queries Array of queries
+ * @param count Number of queries
+ * @param E Output array receiving RGB illumination per query
+ * @param report Accumulates the defect counts
+ */
+void calculateIlluminationBatchValidated(const IlluminationQuery* queries, std::size_t count,
+                                         std::array<double, 3>* E, ValidationReport& report);
+
+#endif // VALIDATION_H
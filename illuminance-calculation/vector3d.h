@@ -1,11 +1,17 @@
 #ifndef VECTOR3D_H
 #define VECTOR3D_H
 
+#include <cmath>
+
 /**
  * @brief 3D vector class for geometric calculations
  * 
  * Provides basic vector operations including arithmetic operations,
  * dot product, cross product, normalization, and magnitude calculation.
+ *
+ * All operations are defined inline so they can be fused into the
+ * surrounding illumination code; everything except the square-root based
+ * norm() and normalized() is also usable in constant expressions.
  */
 class Vector3D {
 public:
@@ -16,47 +22,67 @@ public:
      * @param other Vector to subtract
      * @return Difference of the two vectors
      */
-    Vector3D operator-(const Vector3D& other) const;
+    constexpr Vector3D operator-(const Vector3D& other) const {
+        return {x - other.x, y - other.y, z - other.z};
+    }
 
     /**
      * @brief Vector addition
      * @param other Vector to add
      * @return Sum of the two vectors
      */
-    Vector3D operator+(const Vector3D& other) const;
+    constexpr Vector3D operator+(const Vector3D& other) const {
+        return {x + other.x, y + other.y, z + other.z};
+    }
 
     /**
      * @brief Scalar multiplication
      * @param scalar Scalar value to multiply by
      * @return Scaled vector
      */
-    Vector3D operator*(double scalar) const;
+    constexpr Vector3D operator*(double scalar) const {
+        return {x * scalar, y * scalar, z * scalar};
+    }
 
     /**
      * @brief Compute dot product with another vector
      * @param other Vector to compute dot product with
      * @return Dot product (scalar value)
      */
-    double dot(const Vector3D& other) const;
+    constexpr double dot(const Vector3D& other) const {
+        return x * other.x + y * other.y + z * other.z;
+    }
 
     /**
      * @brief Compute cross product with another vector
      * @param other Vector to compute cross product with
      * @return Cross product vector (perpendicular to both inputs)
      */
-    Vector3D cross(const Vector3D& other) const;
+    constexpr Vector3D cross(const Vector3D& other) const {
+        return {
+            y * other.z - z * other.y,
+            z * other.x - x * other.z,
+            x * other.y - y * other.x
+        };
+    }
 
     /**
      * @brief Calculate the magnitude (length) of the vector
      * @return Euclidean norm of the vector
      */
-    double norm() const;
+    double norm() const {
+        return std::sqrt(x * x + y * y + z * z);
+    }
 
     /**
      * @brief Get a normalized (unit length) version of the vector
-     * @return Normalized vector with magnitude 1
+     * @return Normalized vector with magnitude 1, or the zero vector
+     *         unchanged (instead of NaN components)
      */
-    Vector3D normalized() const;
+    Vector3D normalized() const {
+        const double n = norm();
+        return n > 0.0 ? Vector3D{x / n, y / n, z / n} : *this;
+    }
 };
 
 #endif // VECTOR3D_H
\ No newline at end of file
@@ -0,0 +1,56 @@
+#include "camera.h"
+#include <cmath>
+
+Vector3D computeRayDirection(int i, int j, int width, int height, const Vector3D &eye, const Vector3D center,
+                             const Vector3D &up, double distance, double screen_width, double screen_height) {
+    Vector3D view = (center - eye).normalized();
+    Vector3D right = view.cross(up).normalized();
+    Vector3D actual_up = right.cross(view).normalized();
+    Vector3D screen_center = eye + view * distance;
+    double u = (i + 0.5) / width * screen_width - screen_width / 2;
+    double v = -(j + 0.5) / height * screen_height + screen_height / 2;
+    Vector3D screen_point = screen_center + right * u + actual_up * v;
+    Vector3D rayDir = (screen_point - eye).normalized();
+    return rayDir;
+}
+
+/**
+ * Same screen construction as computeRayDirection, at a continuous image
+ * position, followed by the thin-lens refocusing.
+ */
+void generateCameraRay(const Camera &camera, double x, double y, int width, int height, double lensU, double lensV,
+                       Vector3D &origin, Vector3D &direction) {
+    Vector3D view = (camera.center - camera.eye).normalized();
+    Vector3D right = view.cross(camera.up).normalized();
+    Vector3D actual_up = right.cross(view).normalized();
+    Vector3D screen_center = camera.eye + view * camera.distance;
+    double u = x / width * camera.screen_width - camera.screen_width / 2;
+    double v = -y / height * camera.screen_height + camera.screen_height / 2;
+    Vector3D pinhole = ((screen_center + right * u + actual_up * v) - camera.eye).normalized();
+    if (camera.aperture <= 0.0) {
+        origin = camera.eye;
+        direction = pinhole;
+        return;
+    }
+
+    // Concentric mapping of the square to the unit disk (Shirley & Chiu 1997)
+    const double a = 2.0 * lensU - 1.0;
+    const double b = 2.0 * lensV - 1.0;
+    double radius = 0.0, phi = 0.0;
+    if (a != 0.0 || b != 0.0) {
+        constexpr double quarterPi = 0.78539816339744830962;
+        if (std::abs(a) > std::abs(b)) {
+            radius = a;
+            phi = quarterPi * (b / a);
+        } else {
+            radius = b;
+            phi = 2.0 * quarterPi - quarterPi * (a / b);
+        }
+    }
+    radius *= camera.aperture;
+
+    const double focus = camera.focus_distance > 0.0 ? camera.focus_distance : (camera.center - camera.eye).norm();
+    const Vector3D focusPoint = camera.eye + pinhole * (focus / pinhole.dot(view));
+    origin = camera.eye + right * (radius * std::cos(phi)) + actual_up * (radius * std::sin(phi));
+    direction = (focusPoint - origin).normalized();
+}
@@ -0,0 +1,74 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include "vector3d.h"
+
+/**
+ * @brief Camera looking through a virtual screen
+ *
+ * A pinhole camera by default; with an aperture it is a thin lens of that
+ * radius centered at the eye, focused on the plane at focus_distance along
+ * the view direction.
+ */
+struct Camera {
+    Vector3D eye;          ///< Camera position
+    Vector3D center;       ///< Point the camera is looking at
+    Vector3D up;           ///< Up direction vector
+    double distance;       ///< Distance from camera to the screen
+    double screen_width;   ///< Width of the virtual screen
+    double screen_height;  ///< Height of the virtual screen
+    double aperture = 0.0;        ///< Lens radius, 0 = pinhole
+    double focus_distance = 0.0;  ///< Distance of the plane in focus, 0 = distance to center
+};
+
+/**
+ * @brief Compute the ray direction through a pixel
+ * 
+ * Calculates the direction of a ray from the camera eye through a specific
+ * pixel (i, j) on the virtual screen.
+ * 
+ * @param i Pixel column index
+ * @param j Pixel row index
+ * @param width Image width in pixels
+ * @param height Image height in pixels
+ * @param eye Camera position
+ * @param center Point the camera is looking at
+ * @param up Up direction vector
+ * @param distance Distance from camera to the screen
+ * @param screen_width Width of the virtual screen
+ * @param screen_height Height of the virtual screen
+ * @return Normalized ray direction vector
+ */
+Vector3D computeRayDirection(int i, int j, int width, int height, const Vector3D &eye, const Vector3D center,
+                             const Vector3D &up, double distance, double screen_width, double screen_height);
+
+/**
+ * @brief Compute the ray direction through a pixel of a camera
+ */
+inline Vector3D computeRayDirection(int i, int j, int width, int height, const Camera &camera) {
+    return computeRayDirection(i, j, width, height, camera.eye, camera.center, camera.up, camera.distance,
+                               camera.screen_width, camera.screen_height);
+}
+
+/**
+ * @brief Generate a camera ray through a point of the image
+ *
+ * For a pinhole camera the ray starts at the eye. With an aperture, the
+ * lens sample is mapped to a point on the lens disk (concentric mapping),
+ * and the ray goes from there through the point where the pinhole ray meets
+ * the focus plane, so everything on that plane stays sharp.
+ *
+ * @param camera Camera
+ * @param x Horizontal image position in pixels (pixel i spans [i, i + 1))
+ * @param y Vertical image position in pixels
+ * @param width Image width in pixels
+ * @param height Image height in pixels
+ * @param lensU First lens sample coordinate in [0, 1)
+ * @param lensV Second lens sample coordinate in [0, 1)
+ * @param origin Receives the ray origin
+ * @param direction Receives the normalized ray direction
+ */
+void generateCameraRay(const Camera &camera, double x, double y, int width, int height, double lensU, double lensV,
+                       Vector3D &origin, Vector3D &direction);
+
+#endif // CAMERA_H
@@ -0,0 +1,225 @@
+#include "checkpoint.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr char kMagic[8] = {'R', 'T', 'C', 'K', 'P', 'T', '0', '1'};
+
+struct Header {
+    char magic[8];
+    std::uint64_t settings;
+    std::uint32_t width, height, tileSize, tileCount;
+};
+
+} // namespace
+
+Checkpoint::~Checkpoint() {
+    close();
+}
+
+void Checkpoint::tileBounds(int tile, int &x0, int &y0, int &x1, int &y1) const {
+    x0 = (tile % tilesX_) * tileSize_;
+    y0 = (tile / tilesX_) * tileSize_;
+    x1 = std::min(x0 + tileSize_, width_);
+    y1 = std::min(y0 + tileSize_, height_);
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+
+bool Checkpoint::open(const std::string &path, int width, int height, int tileSize, std::uint64_t settings,
+                      std::string &error) {
+    path_ = path;
+    width_ = width;
+    height_ = height;
+    tileSize_ = tileSize;
+    tilesX_ = (width + tileSize - 1) / tileSize;
+    tileCount_ = tilesX_ * ((height + tileSize - 1) / tileSize);
+    const std::size_t tableBytes = sizeof(Header) + static_cast<std::size_t>(tileCount_) * sizeof(std::uint64_t);
+    mapSize_ = tableBytes + static_cast<std::size_t>(width) * height * sizeof(Color);
+
+    bool created = false;
+    fd_ = ::open(path.c_str(), O_RDWR);
+    if (fd_ < 0 && errno == ENOENT) {
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+        created = fd_ >= 0 && ftruncate(fd_, static_cast<off_t>(mapSize_)) == 0;
+        if (fd_ >= 0 && !created) {
+            error = path + ": " + std::strerror(errno);
+            return false;
+        }
+    }
+    if (fd_ < 0) {
+        error = path + ": " + std::strerror(errno);
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd_, &info) != 0 || static_cast<std::size_t>(info.st_size) != mapSize_) {
+        error = "файл другого размера: он записан для другого изображения";
+        return false;
+    }
+    map_ = mmap(nullptr, mapSize_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (map_ == MAP_FAILED) {
+        map_ = nullptr;
+        error = std::string("mmap: ") + std::strerror(errno);
+        return false;
+    }
+    auto *header = static_cast<Header *>(map_);
+    tileSamples_ = reinterpret_cast<std::uint64_t *>(static_cast<char *>(map_) + sizeof(Header));
+    pixels_ = reinterpret_cast<Color *>(static_cast<char *>(map_) + tableBytes);
+
+    if (created) {
+        // The new file is all zeros: no tile is done yet
+        header->settings = settings;
+        header->width = static_cast<std::uint32_t>(width);
+        header->height = static_cast<std::uint32_t>(height);
+        header->tileSize = static_cast<std::uint32_t>(tileSize);
+        header->tileCount = static_cast<std::uint32_t>(tileCount_);
+        std::memcpy(header->magic, kMagic, sizeof(kMagic));
+        msync(map_, mapSize_, MS_SYNC);
+    } else if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 || header->settings != settings ||
+               header->width != static_cast<std::uint32_t>(width) ||
+               header->height != static_cast<std::uint32_t>(height) ||
+               header->tileSize != static_cast<std::uint32_t>(tileSize)) {
+        error = "файл записан с другими настройками рендеринга";
+        return false;
+    }
+
+    done_ = std::make_unique<std::atomic<std::uint64_t>[]>(tileCount_);
+    resumedTiles_ = 0;
+    for (int t = 0; t < tileCount_; ++t) {
+        done_[t].store(tileSamples_[t], std::memory_order_relaxed);
+        resumedTiles_ += tileSamples_[t] != 0;
+    }
+    return true;
+}
+
+int Checkpoint::flush() {
+    std::vector<int> finished;
+    int recorded = 0;
+    for (int t = 0; t < tileCount_; ++t) {
+        if (tileSamples_[t] != 0) {
+            ++recorded;
+        } else if (done_[t].load(std::memory_order_acquire) != 0) {
+            finished.push_back(t);
+        }
+    }
+    if (finished.empty()) {
+        return recorded;
+    }
+    // Pixels first: the table must never list a tile whose pixels are not on disk
+    msync(map_, mapSize_, MS_SYNC);
+    for (const int t: finished) {
+        tileSamples_[t] = done_[t].load(std::memory_order_relaxed);
+    }
+    const std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    const std::size_t tableEnd = sizeof(Header) + static_cast<std::size_t>(tileCount_) * sizeof(std::uint64_t);
+    msync(map_, std::min(mapSize_, (tableEnd + page - 1) / page * page), MS_SYNC);
+    return recorded + static_cast<int>(finished.size());
+}
+
+void Checkpoint::close() {
+    if (map_) {
+        munmap(map_, mapSize_);
+        map_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+void Checkpoint::remove() {
+    close();
+    unlink(path_.c_str());
+}
+
+#else
+
+bool Checkpoint::open(const std::string &, int, int, int, std::uint64_t, std::string &error) {
+    error = "контрольные точки через mmap поддерживаются только в POSIX-системах";
+    return false;
+}
+
+int Checkpoint::flush() {
+    return 0;
+}
+
+void Checkpoint::close() {
+}
+
+void Checkpoint::remove() {
+}
+
+#endif
+
+std::uint64_t renderWithCheckpoint(const Camera &camera, const RenderContext &context,
+                                   const SamplingSettings &sampling, int width, int height, unsigned threads,
+                                   Checkpoint &checkpoint, double interval, std::vector<Color> &image) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    std::vector<int> tiles;
+    for (int t = 0; t < checkpoint.tileCount(); ++t) {
+        if (!checkpoint.tileDone(t)) {
+            tiles.push_back(t);
+        }
+    }
+
+    // Checkpoints on their own thread, so workers never wait for the disk
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool finished = false;
+    std::thread saver([&] {
+        std::unique_lock lock(mutex);
+        const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(interval));
+        while (!wake.wait_for(lock, period, [&] { return finished; })) {
+            lock.unlock();
+            const int recorded = checkpoint.flush();
+            std::cout << "Контрольная точка: готово тайлов " << recorded << " из " << checkpoint.tileCount()
+                      << std::endl;
+            lock.lock();
+        }
+    });
+
+    std::atomic<std::size_t> next{0};
+    std::atomic<std::uint64_t> rays{0};
+    {
+        std::vector<std::jthread> pool;
+        for (unsigned t = 0; t < threads; ++t) {
+            pool.emplace_back([&] {
+                for (std::size_t k = next.fetch_add(1); k < tiles.size(); k = next.fetch_add(1)) {
+                    int x0, y0, x1, y1;
+                    checkpoint.tileBounds(tiles[k], x0, y0, x1, y1);
+                    const std::uint64_t samples = renderTile(camera, context, sampling, width, height, x0, y0, x1,
+                                                             y1, checkpoint.pixels());
+                    checkpoint.markDone(tiles[k], samples);
+                    rays.fetch_add(samples, std::memory_order_relaxed);
+                }
+            });
+        }
+    }
+    {
+        std::lock_guard lock(mutex);
+        finished = true;
+    }
+    wake.notify_all();
+    saver.join();
+    checkpoint.flush();
+
+    image.assign(checkpoint.pixels(), checkpoint.pixels() + static_cast<std::size_t>(width) * height);
+    return rays.load();
+}
@@ -0,0 +1,109 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "camera.h"
+#include "color.h"
+#include "renderer.h"
+
+/**
+ * @brief Render progress kept in a memory-mapped file
+ *
+ * The file holds a header, the sample count of every tile (0 = not done)
+ * and the image. Workers write finished pixels straight into the mapping
+ * and mark their tile done in memory, without locks or system calls. A
+ * checkpoint, taken by flush() on another thread, first syncs the mapping
+ * to disk and only then records the tiles done so far in the file's tile
+ * table. A tile listed in the file therefore always has its pixels on disk,
+ * whenever the process or the machine dies.
+ *
+ * Pixels are seeded from their index, so no random number state has to be
+ * saved: a tile rendered again after a resume comes out bit for bit as it
+ * would have the first time.
+ *
+ * The file stores Color as it is laid out in memory; it is only read back
+ * by the same build on the same machine.
+ */
+class Checkpoint {
+public:
+    Checkpoint() = default;
+
+    ~Checkpoint();
+
+    Checkpoint(const Checkpoint &) = delete;
+
+    Checkpoint &operator=(const Checkpoint &) = delete;
+
+    /**
+     * @brief Open a checkpoint file, or create it if it does not exist
+     *
+     * An existing file is resumed if it was written for the same image size,
+     * tile size and settings; otherwise it is an error, so that no progress
+     * is overwritten by accident.
+     *
+     * @param settings Fingerprint of everything that affects the image
+     * @param error Receives the reason if the file cannot be used
+     */
+    bool open(const std::string &path, int width, int height, int tileSize, std::uint64_t settings,
+              std::string &error);
+
+    int tileCount() const { return tileCount_; }
+
+    /// Tiles restored from the file when it was opened
+    int resumedTiles() const { return resumedTiles_; }
+
+    /// Whether a tile is done, in this run or a previous one
+    bool tileDone(int tile) const { return done_[tile].load(std::memory_order_acquire) != 0; }
+
+    /// Pixel rectangle of a tile
+    void tileBounds(int tile, int &x0, int &y0, int &x1, int &y1) const;
+
+    /// width * height pixels in the mapping
+    Color *pixels() const { return pixels_; }
+
+    /// Record a tile as done after its pixels are written; lock-free
+    void markDone(int tile, std::uint64_t samples) { done_[tile].store(samples, std::memory_order_release); }
+
+    /**
+     * @brief Take a checkpoint: sync the pixels, then record the finished tiles
+     * @return Tiles recorded in the file
+     */
+    int flush();
+
+    /// Close the mapping and delete the file
+    void remove();
+
+private:
+    void close();
+
+    std::string path_;
+    int width_ = 0, height_ = 0, tileSize_ = 0, tilesX_ = 0, tileCount_ = 0, resumedTiles_ = 0;
+    int fd_ = -1;
+    void *map_ = nullptr;
+    std::size_t mapSize_ = 0;
+    std::uint64_t *tileSamples_ = nullptr;   ///< Tile table in the file
+    Color *pixels_ = nullptr;
+    std::unique_ptr<std::atomic<std::uint64_t>[]> done_;  ///< Samples of finished tiles, 0 = not done
+};
+
+/**
+ * @brief Render an image tile by tile into a checkpoint, skipping tiles already done
+ *
+ * Workers take tiles from a shared counter. A separate thread takes a
+ * checkpoint every interval seconds while they run, and once more at the
+ * end; workers never wait for it.
+ *
+ * @param interval Seconds between checkpoints
+ * @param image Receives the finished image
+ * @return Camera rays traced in this run
+ */
+std::uint64_t renderWithCheckpoint(const Camera &camera, const RenderContext &context,
+                                   const SamplingSettings &sampling, int width, int height, unsigned threads,
+                                   Checkpoint &checkpoint, double interval, std::vector<Color> &image);
+
+#endif // CHECKPOINT_H
@@ -0,0 +1,20 @@
+#ifndef COLOR_H
+#define COLOR_H
+
+/**
+ * @brief RGB Color class for color representation
+ * Supports color arithmetic operations for lighting calculations
+ */
+class Color {
+public:
+    double r, g, b;
+
+    Color(double r_ = 0, double g_ = 0, double b_ = 0) : r(r_), g(g_), b(b_) {
+    }
+
+    Color operator*(double scalar) const { return Color(r * scalar, g * scalar, b * scalar); }
+    Color operator+(const Color &other) const { return Color(r + other.r, g + other.g, b + other.b); }
+    Color operator*(const Color &other) const { return Color(r * other.r, g * other.g, b * other.b); }
+};
+
+#endif // COLOR_H
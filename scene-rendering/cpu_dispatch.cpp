@@ -0,0 +1,72 @@
+#include "cpu_dispatch.h"
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+// Active level; -1 until the first call to activeIsa()
+std::atomic<int> g_activeIsa{-1};
+
+} // namespace
+
+// Query CPUID through the compiler builtins
+IsaLevel detectIsa() noexcept {
+#if CPU_DISPATCH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl") &&
+        __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512bw")) {
+        return IsaLevel::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return IsaLevel::AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt")) {
+        return IsaLevel::SSE4;
+    }
+#endif
+    return IsaLevel::Baseline;
+}
+
+// Detect (or read FORCE_ISA) once, then serve the cached level
+IsaLevel activeIsa() noexcept {
+    int level = g_activeIsa.load(std::memory_order_relaxed);
+    if (level < 0) {
+        IsaLevel selected = detectIsa();
+        IsaLevel forced;
+        const char* env = std::getenv("FORCE_ISA");
+        if (env && parseIsa(env, forced) && forced < selected) {
+            selected = forced;
+        }
+        level = static_cast<int>(selected);
+        g_activeIsa.store(level, std::memory_order_relaxed);
+    }
+    return static_cast<IsaLevel>(level);
+}
+
+// Override the level, clamped to what the CPU supports
+bool forceIsa(const IsaLevel level) noexcept {
+    const IsaLevel supported = detectIsa();
+    const IsaLevel selected = level < supported ? level : supported;
+    g_activeIsa.store(static_cast<int>(selected), std::memory_order_relaxed);
+    return selected == level;
+}
+
+const char* isaName(const IsaLevel level) noexcept {
+    switch (level) {
+        case IsaLevel::SSE4: return "sse4";
+        case IsaLevel::AVX2: return "avx2";
+        case IsaLevel::AVX512: return "avx512";
+        default: return "baseline";
+    }
+}
+
+bool parseIsa(const char* name, IsaLevel& level) noexcept {
+    for (const IsaLevel candidate : {IsaLevel::Baseline, IsaLevel::SSE4, IsaLevel::AVX2, IsaLevel::AVX512}) {
+        if (std::strcmp(name, isaName(candidate)) == 0) {
+            level = candidate;
+            return true;
+        }
+    }
+    return false;
+}
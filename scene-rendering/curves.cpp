@@ -0,0 +1,165 @@
+#include "curves.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <numbers>
+#include <sstream>
+#include "sampling.h"
+
+namespace {
+
+// Position, radius and unnormalized tangent of a segment at u in [0, 1]
+void evaluateSegment(const CurveSet &curves, unsigned segment, double u, Vector3D &position, double &radius,
+                     Vector3D &tangent) {
+    const float *p = curves.vertices.data() + 4 * static_cast<std::size_t>(curves.segments[segment]);
+    auto point = [p](int k) { return Vector3D(p[4 * k], p[4 * k + 1], p[4 * k + 2]); };
+    if (curves.basis == CurveBasis::FlatLinear) {
+        position = point(0) * (1 - u) + point(1) * u;
+        radius = p[3] * (1 - u) + p[7] * u;
+        tangent = point(1) - point(0);
+        return;
+    }
+    const double s = 1 - u;
+    const double w[4] = {s * s * s, 3 * s * s * u, 3 * s * u * u, u * u * u};
+    position = point(0) * w[0] + point(1) * w[1] + point(2) * w[2] + point(3) * w[3];
+    radius = p[3] * w[0] + p[7] * w[1] + p[11] * w[2] + p[15] * w[3];
+    tangent = (point(1) - point(0)) * (3 * s * s) + (point(2) - point(1)) * (6 * s * u) +
+              (point(3) - point(2)) * (3 * u * u);
+}
+
+} // namespace
+
+bool CurveSet::addStrand(const std::vector<float> &points) {
+    const std::size_t count = points.size() / 4;
+    const bool bezier = basis == CurveBasis::RoundBezier;
+    if (points.size() % 4 != 0 || count < (bezier ? 4u : 2u) || (bezier && (count - 1) % 3 != 0)) {
+        return false;
+    }
+    const unsigned first = static_cast<unsigned>(controlPointCount());
+    const std::size_t step = bezier ? 3 : 1;
+    for (std::size_t k = 0; k + 1 < count; k += step) {
+        segments.push_back(first + static_cast<unsigned>(k));
+    }
+    vertices.insert(vertices.end(), points.begin(), points.end());
+    return true;
+}
+
+bool loadCurves(const std::string &path, CurveSet &bezier, CurveSet &linear, std::string &error) {
+    std::ifstream file(path);
+    if (!file) {
+        error = "не удалось открыть " + path;
+        return false;
+    }
+    std::stringstream tokens;
+    std::string line;
+    while (std::getline(file, line)) {
+        tokens << line.substr(0, line.find('#')) << '\n';
+    }
+
+    bezier.basis = CurveBasis::RoundBezier;
+    linear.basis = CurveBasis::FlatLinear;
+    std::string keyword;
+    int strand = 0;
+    while (tokens >> keyword) {
+        ++strand;
+        CurveSet *target = keyword == "bezier" ? &bezier : keyword == "linear" ? &linear : nullptr;
+        long long count = 0;
+        if (!target || !(tokens >> count) || count <= 0 || count > (1 << 24)) {
+            error = "кривая " + std::to_string(strand) + ": ожидается \"bezier <n>\" или \"linear <n>\"";
+            return false;
+        }
+        std::vector<float> points(static_cast<std::size_t>(count) * 4);
+        for (float &value: points) {
+            if (!(tokens >> value) || !std::isfinite(value)) {
+                error = "кривая " + std::to_string(strand) + ": ожидается " + std::to_string(count) +
+                        " точек по четыре числа";
+                return false;
+            }
+        }
+        for (std::size_t k = 3; k < points.size(); k += 4) {
+            if (points[k] <= 0.0f) {
+                error = "кривая " + std::to_string(strand) + ": радиус должен быть положительным";
+                return false;
+            }
+        }
+        if (!target->addStrand(points)) {
+            error = "кривая " + std::to_string(strand) + ": у кривой Безье 3k + 1 точек, у ломаной не меньше 2";
+            return false;
+        }
+    }
+    return true;
+}
+
+CurveSet makeFibreTuft(const Vector3D &root, double spread, int strands, std::uint64_t seed) {
+    constexpr int kSegments = 8;
+    CurveSet tuft;
+    tuft.basis = CurveBasis::FlatLinear;
+    Random random(seed);
+    for (int s = 0; s < strands; ++s) {
+        // Uniform point on the disc, random length, droop direction and amount
+        const double r = spread * std::sqrt(random.nextDouble());
+        const double phi = 2.0 * std::numbers::pi * random.nextDouble();
+        const Vector3D base = root + Vector3D(r * std::cos(phi), 0.0, r * std::sin(phi));
+        const double length = 0.5 + 0.4 * random.nextDouble();
+        const double lean = 2.0 * std::numbers::pi * random.nextDouble();
+        const double droop = 0.2 + 0.4 * random.nextDouble();
+        const Vector3D side(std::cos(lean), 0.0, std::sin(lean));
+        std::vector<float> points;
+        for (int k = 0; k <= kSegments; ++k) {
+            const double t = static_cast<double>(k) / kSegments;
+            const Vector3D p = base + Vector3D(0.0, length * t * (1.0 - 0.5 * droop * t), 0.0) +
+                               side * (length * droop * t * t);
+            points.insert(points.end(), {static_cast<float>(p.x), static_cast<float>(p.y), static_cast<float>(p.z),
+                                         static_cast<float>(0.012 * (1.0 - 0.7 * t))});
+        }
+        tuft.addStrand(points);
+    }
+    return tuft;
+}
+
+TriangleMesh tubeMesh(const CurveSet &curves, int sides, int ringsPerSegment) {
+    const int rings = curves.basis == CurveBasis::RoundBezier ? ringsPerSegment + 1 : 2;
+    TriangleMesh mesh;
+    mesh.vertices.reserve(curves.segmentCount() * rings * sides * 3);
+    mesh.indices.reserve(curves.segmentCount() * (rings - 1) * sides * 6);
+    for (unsigned segment = 0; segment < curves.segmentCount(); ++segment) {
+        const unsigned first = static_cast<unsigned>(mesh.vertexCount());
+        for (int ring = 0; ring < rings; ++ring) {
+            Vector3D position, tangent;
+            double radius;
+            evaluateSegment(curves, segment, static_cast<double>(ring) / (rings - 1), position, radius, tangent);
+            tangent = tangent.normalized();
+            const Vector3D reference = std::abs(tangent.y) < 0.9 ? Vector3D(0, 1, 0) : Vector3D(1, 0, 0);
+            const Vector3D a = tangent.cross(reference).normalized();
+            const Vector3D b = tangent.cross(a);
+            for (int k = 0; k < sides; ++k) {
+                const double angle = 2.0 * std::numbers::pi * k / sides;
+                const Vector3D p = position + (a * std::cos(angle) + b * std::sin(angle)) * radius;
+                mesh.vertices.insert(mesh.vertices.end(), {static_cast<float>(p.x), static_cast<float>(p.y),
+                                                           static_cast<float>(p.z)});
+            }
+        }
+        for (int ring = 0; ring + 1 < rings; ++ring) {
+            for (int k = 0; k < sides; ++k) {
+                const unsigned v00 = first + ring * sides + k, v01 = first + ring * sides + (k + 1) % sides;
+                const unsigned v10 = v00 + sides, v11 = v01 + sides;
+                mesh.indices.insert(mesh.indices.end(), {v00, v01, v11, v00, v11, v10});
+            }
+        }
+    }
+    return mesh;
+}
+
+RTCGeometry createCurveGeometry(RTCDevice device, const CurveSet &curves) {
+    RTCGeometry geometry = rtcNewGeometry(device, curves.basis == CurveBasis::RoundBezier
+                                                      ? RTC_GEOMETRY_TYPE_ROUND_BEZIER_CURVE
+                                                      : RTC_GEOMETRY_TYPE_FLAT_LINEAR_CURVE);
+    auto *vertices = static_cast<float *>(rtcSetNewGeometryBuffer(
+        geometry, RTC_BUFFER_TYPE_VERTEX, 0, RTC_FORMAT_FLOAT4, 4 * sizeof(float), curves.controlPointCount()));
+    auto *segments = static_cast<unsigned *>(rtcSetNewGeometryBuffer(
+        geometry, RTC_BUFFER_TYPE_INDEX, 0, RTC_FORMAT_UINT, sizeof(unsigned), curves.segmentCount()));
+    std::copy(curves.vertices.begin(), curves.vertices.end(), vertices);
+    std::copy(curves.segments.begin(), curves.segments.end(), segments);
+    rtcCommitGeometry(geometry);
+    return geometry;
+}
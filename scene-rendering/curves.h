@@ -0,0 +1,94 @@
+#ifndef CURVES_H
+#define CURVES_H
+
+#include <embree4/rtcore.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "vector3d.h"
+#include "mesh.h"
+
+/**
+ * @brief Curve type of a CurveSet, one Embree geometry type each
+ */
+enum class CurveBasis {
+    RoundBezier, ///< Cubic Bezier segments swept by a circle: cables (RTC_GEOMETRY_TYPE_ROUND_BEZIER_CURVE)
+    FlatLinear   ///< Straight segments as ribbons facing the ray: hair and fibres (RTC_GEOMETRY_TYPE_FLAT_LINEAR_CURVE)
+};
+
+/**
+ * @brief Strands of one curve type in the layout of Embree's curve buffers
+ *
+ * A strand is a run of control points. A Bezier segment uses four
+ * consecutive points and shares its end point with the next segment, so a
+ * strand of k segments has 3k + 1 points; a linear strand of n points has
+ * n - 1 segments.
+ */
+struct CurveSet {
+    CurveBasis basis = CurveBasis::RoundBezier;
+    std::vector<float> vertices;     ///< x, y, z, radius per control point (RTC_FORMAT_FLOAT4)
+    std::vector<unsigned> segments;  ///< First control point of each segment (RTC_FORMAT_UINT)
+
+    std::size_t controlPointCount() const { return vertices.size() / 4; }
+
+    std::size_t segmentCount() const { return segments.size(); }
+
+    /// Bytes of the vertex and index buffers
+    std::size_t bufferBytes() const { return vertices.size() * sizeof(float) + segments.size() * sizeof(unsigned); }
+
+    /**
+     * @brief Append a strand
+     * @param points x, y, z, radius per control point
+     * @return false if the point count does not fit the basis
+     */
+    bool addStrand(const std::vector<float> &points);
+};
+
+/**
+ * @brief Load strands from a text file
+ *
+ * Each strand starts with "bezier <n>" (round cable) or "linear <n>" (flat
+ * fibre), followed by n control points of four numbers: x y z radius.
+ * Line breaks are free and '#' starts a comment that runs to the end of the
+ * line.
+ *
+ * @param path File to read
+ * @param bezier Receives the Bezier strands (appended)
+ * @param linear Receives the linear strands (appended)
+ * @param error Receives a description of the first problem
+ * @return false if the file cannot be read or is malformed
+ */
+bool loadCurves(const std::string &path, CurveSet &bezier, CurveSet &linear, std::string &error);
+
+/**
+ * @brief Tuft of fibres growing up from a disc on the floor
+ *
+ * Each fibre is a flat linear strand of eight segments that droops to one
+ * side and thins towards its tip.
+ *
+ * @param root Center of the disc
+ * @param spread Disc radius
+ * @param strands Number of fibres
+ * @param seed Random seed of the layout
+ */
+CurveSet makeFibreTuft(const Vector3D &root, double spread, int strands, std::uint64_t seed);
+
+/**
+ * @brief The same strands as tubes of triangles
+ *
+ * The mesh a renderer without curve primitives would need: every segment
+ * becomes rings of `sides` vertices, ringsPerSegment + 1 rings along a
+ * Bezier segment and 2 along a linear one.
+ */
+TriangleMesh tubeMesh(const CurveSet &curves, int sides = 8, int ringsPerSegment = 8);
+
+/**
+ * @brief Create an Embree curve geometry
+ *
+ * Copies the strands into Embree buffers and commits the geometry; the
+ * caller attaches it and sets its user data.
+ */
+RTCGeometry createCurveGeometry(RTCDevice device, const CurveSet &curves);
+
+#endif // CURVES_H
@@ -0,0 +1,180 @@
+#include "deadline.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Share of the time left that a pass may be predicted to take
+constexpr double kSafety = 0.9;
+
+// Resolution divisors from best to worst; the last is the probe
+constexpr int kDivisors[] = {1, 2, 4, 8, 16};
+
+/**
+ * Cost of a camera sample measured in the last pass
+ */
+struct Throughput {
+    double secondsPerSample = 0.0;  // Wall time on all workers
+    double raysPerSample = 1.0;     // Camera and secondary rays
+    double cutsPerSample = 0.0;     // Paths stopped by the depth limit
+    int maxDepth = 1;
+};
+
+// 1, 2, 4, ... below limit, then limit
+std::vector<int> doublings(int limit) {
+    std::vector<int> ladder;
+    for (int value = 1; value < limit; value *= 2) {
+        ladder.push_back(value);
+    }
+    ladder.push_back(limit);
+    return ladder;
+}
+
+double predictSeconds(const Throughput &throughput, const DeadlineLevel &level) {
+    // Every cut path may go one bounce further per added bounce
+    const int deeper = std::max(0, level.maxDepth - throughput.maxDepth);
+    const double rays = throughput.raysPerSample + throughput.cutsPerSample * deeper;
+    return throughput.secondsPerSample * rays / throughput.raysPerSample * level.width * level.height *
+           level.samples;
+}
+
+// Render the tiles of a pass until all are done or the deadline passes
+void renderLevel(const Camera &camera, RenderContext context, const SamplingSettings &sampling,
+                 DeadlineLevel &level, unsigned threads, int tileSize, Clock::time_point deadline,
+                 std::vector<Color> &pixels, std::vector<std::uint8_t> &done, Throughput &throughput) {
+    RenderStats local;
+    RenderStats &stats = context.stats ? *context.stats : local;
+    context.stats = &stats;
+    context.maxDepth = level.maxDepth;
+    context.missFootprint = camera.screen_width / level.width / camera.distance;
+    SamplingSettings levelSampling = sampling;
+    levelSampling.maxSamples = level.samples;
+    levelSampling.minSamples = std::min(sampling.minSamples, level.samples);
+
+    const int tilesX = (level.width + tileSize - 1) / tileSize;
+    level.tiles = tilesX * ((level.height + tileSize - 1) / tileSize);
+    pixels.assign(static_cast<std::size_t>(level.width) * level.height, Color(0, 0, 0));
+    done.assign(level.tiles, 0);
+
+    const std::uint64_t primary = stats.primaryRays.load();
+    const std::uint64_t secondary = stats.secondaryRays.load();
+    const std::uint64_t cuts = stats.depthLimitHits.load();
+    std::atomic<int> next{0}, finished{0};
+    std::atomic<std::uint64_t> samples{0};
+    const auto start = Clock::now();
+    {
+        std::vector<std::jthread> pool;
+        for (unsigned t = 0; t < threads; ++t) {
+            pool.emplace_back([&] {
+                for (int tile = next.fetch_add(1); tile < level.tiles && Clock::now() < deadline;
+                     tile = next.fetch_add(1)) {
+                    const int x0 = (tile % tilesX) * tileSize;
+                    const int y0 = (tile / tilesX) * tileSize;
+                    samples.fetch_add(renderTile(camera, context, levelSampling, level.width, level.height, x0, y0,
+                                                 std::min(x0 + tileSize, level.width),
+                                                 std::min(y0 + tileSize, level.height), pixels.data()),
+                                      std::memory_order_relaxed);
+                    done[tile] = 1;
+                    finished.fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+        }
+    }
+    level.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    level.tilesDone = finished.load();
+
+    const double cameraRays = static_cast<double>(stats.primaryRays.load() - primary);
+    if (samples.load() > 0 && cameraRays > 0.0) {
+        throughput.secondsPerSample = level.seconds / static_cast<double>(samples.load());
+        throughput.raysPerSample = 1.0 + static_cast<double>(stats.secondaryRays.load() - secondary) / cameraRays;
+        throughput.cutsPerSample = static_cast<double>(stats.depthLimitHits.load() - cuts) / cameraRays;
+        throughput.maxDepth = level.maxDepth;
+    }
+}
+
+// Upscale the finished tiles of a pass into the image, nearest neighbour
+void composite(const DeadlineLevel &level, const std::vector<Color> &pixels, const std::vector<std::uint8_t> &done,
+               int tileSize, int width, int height, std::vector<Color> &image) {
+    const int tilesX = (level.width + tileSize - 1) / tileSize;
+    for (int y = 0; y < height; ++y) {
+        const int sy = static_cast<int>(static_cast<long long>(y) * level.height / height);
+        for (int x = 0; x < width; ++x) {
+            const int sx = static_cast<int>(static_cast<long long>(x) * level.width / width);
+            if (done[(sy / tileSize) * tilesX + sx / tileSize]) {
+                image[static_cast<std::size_t>(y) * width + x] =
+                    pixels[static_cast<std::size_t>(sy) * level.width + sx];
+            }
+        }
+    }
+}
+
+} // namespace
+
+std::vector<DeadlineLevel> renderWithDeadline(const Camera &camera, const RenderContext &context,
+                                              const SamplingSettings &sampling, int width, int height,
+                                              unsigned threads, int tileSize, double budget,
+                                              std::vector<Color> &image) {
+    const auto deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                                             std::chrono::duration<double>(budget));
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // Every pass that may be rendered, best first
+    std::vector<DeadlineLevel> candidates;
+    for (const int divisor: kDivisors) {
+        const std::vector<int> depths = doublings(context.maxDepth);
+        const std::vector<int> spps = doublings(sampling.maxSamples);
+        for (auto depth = depths.rbegin(); depth != depths.rend(); ++depth) {
+            for (auto spp = spps.rbegin(); spp != spps.rend(); ++spp) {
+                DeadlineLevel level;
+                level.width = std::max(1, (width + divisor - 1) / divisor);
+                level.height = std::max(1, (height + divisor - 1) / divisor);
+                level.samples = *spp;
+                level.maxDepth = *depth;
+                candidates.push_back(level);
+            }
+        }
+    }
+    // The probe: coarsest resolution, one sample, two bounces
+    std::size_t current = candidates.size() - 1;
+    while (current > 0 && candidates[current].maxDepth < std::min(2, context.maxDepth)) {
+        --current;
+    }
+
+    image.assign(static_cast<std::size_t>(width) * height, Color(0, 0, 0));
+    std::vector<DeadlineLevel> levels;
+    std::vector<Color> pixels;
+    std::vector<std::uint8_t> done;
+    Throughput throughput;
+    DeadlineLevel level = candidates[current];
+    while (true) {
+        renderLevel(camera, context, sampling, level, threads, tileSize, deadline, pixels, done, throughput);
+        composite(level, pixels, done, tileSize, width, height, image);
+        levels.push_back(level);
+        if (level.tilesDone < level.tiles) {
+            break;
+        }
+        const double left = std::chrono::duration<double>(deadline - Clock::now()).count();
+        std::size_t pick = current;
+        for (std::size_t k = 0; k < current; ++k) {
+            const double predicted = predictSeconds(throughput, candidates[k]);
+            if (predicted <= kSafety * left) {
+                pick = k;
+                candidates[k].predicted = predicted;
+                break;
+            }
+        }
+        if (pick == current) {
+            break;
+        }
+        current = pick;
+        level = candidates[current];
+    }
+    return levels;
+}
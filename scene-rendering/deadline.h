@@ -0,0 +1,54 @@
+#ifndef DEADLINE_H
+#define DEADLINE_H
+
+#include <vector>
+#include "camera.h"
+#include "color.h"
+#include "renderer.h"
+
+/**
+ * @brief One pass of a deadline render and how it went
+ */
+struct DeadlineLevel {
+    int width = 0;             ///< Resolution of the pass, upscaled to the image
+    int height = 0;
+    int samples = 1;           ///< Maximum samples per pixel
+    int maxDepth = 1;          ///< Reflection and refraction bounces
+    double predicted = 0.0;    ///< Seconds the pass was expected to take, 0 for the probe
+    double seconds = 0.0;      ///< Seconds it took
+    int tiles = 0;
+    int tilesDone = 0;         ///< Fewer than tiles if the deadline cut the pass short
+};
+
+/**
+ * @brief Render the best image the time budget allows
+ *
+ * The image is rendered in passes, each a complete image on its own. The
+ * first pass is a probe at 1/16 resolution with one sample per pixel and two
+ * bounces. After every pass the throughput is measured and the next pass
+ * picked from a ladder of resolutions (1/16 to 1), bounce limits (1, 2,
+ * 4, ... up to context.maxDepth) and samples (1, 2, 4, ... up to
+ * sampling.maxSamples): the best one, ranked by resolution, then bounces,
+ * then samples, whose predicted time fits in the time left. Rendering stops
+ * when no better pass fits.
+ *
+ * The cost of more bounces is predicted from the paths the depth limit cut
+ * off in the measured pass: each may continue for every added bounce.
+ *
+ * Passes are rendered in tiles; no tile is started after the deadline. The
+ * image holds the last pass upscaled, with the tiles finished by a pass the
+ * deadline interrupted laid over it. Pixels the probe did not reach in time
+ * stay black.
+ *
+ * @param sampling Most samples per pixel, minimum samples and noise threshold
+ * @param tileSize Tile side in pixels
+ * @param budget Seconds from the call to the deadline
+ * @param image Receives width * height colors
+ * @return The passes in the order they were rendered
+ */
+std::vector<DeadlineLevel> renderWithDeadline(const Camera &camera, const RenderContext &context,
+                                              const SamplingSettings &sampling, int width, int height,
+                                              unsigned threads, int tileSize, double budget,
+                                              std::vector<Color> &image);
+
+#endif // DEADLINE_H
@@ -0,0 +1,195 @@
+#include "environment.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <numbers>
+#include <utility>
+
+namespace {
+
+double luminance(const Color &c) {
+    return 0.2126 * c.r + 0.7152 * c.g + 0.0722 * c.b;
+}
+
+} // namespace
+
+EnvironmentMap::EnvironmentMap(std::vector<Color> pixels, int width, int height, double scale)
+    : pixels_(std::move(pixels)), width_(width), height_(height) {
+    for (Color &c: pixels_) {
+        c = c * scale;
+    }
+
+    // Summed-area table with a zero first row and column
+    const std::size_t stride = static_cast<std::size_t>(width_) + 1;
+    summed_.assign(stride * (height_ + 1), Color(0, 0, 0));
+    for (int y = 0; y < height_; ++y) {
+        Color row(0, 0, 0);
+        for (int x = 0; x < width_; ++x) {
+            row = row + pixels_[static_cast<std::size_t>(y) * width_ + x];
+            summed_[(y + 1) * stride + x + 1] = summed_[y * stride + x + 1] + row;
+        }
+    }
+
+    // Sampling CDFs: luminance times the solid angle of the texel's row
+    conditional_.assign(stride * height_, 0.0);
+    rowWeight_.assign(height_, 0.0);
+    marginal_.assign(height_ + 1, 0.0);
+    for (int y = 0; y < height_; ++y) {
+        const double sinTheta = std::sin(std::numbers::pi * (y + 0.5) / height_);
+        double *cdf = conditional_.data() + y * stride;
+        for (int x = 0; x < width_; ++x) {
+            cdf[x + 1] = cdf[x] + std::max(0.0, luminance(pixels_[static_cast<std::size_t>(y) * width_ + x])) *
+                                  sinTheta;
+        }
+        rowWeight_[y] = cdf[width_];
+        for (int x = 1; x <= width_; ++x) {
+            cdf[x] = rowWeight_[y] > 0.0 ? cdf[x] / rowWeight_[y] : static_cast<double>(x) / width_;
+        }
+        marginal_[y + 1] = marginal_[y] + rowWeight_[y];
+    }
+    totalWeight_ = marginal_[height_];
+    for (int y = 1; y <= height_; ++y) {
+        marginal_[y] = totalWeight_ > 0.0 ? marginal_[y] / totalWeight_ : static_cast<double>(y) / height_;
+    }
+}
+
+void EnvironmentMap::coordinates(const Vector3D &direction, double &u, double &v) const {
+    const double theta = std::acos(std::clamp(direction.y, -1.0, 1.0));
+    const double phi = std::atan2(-direction.x, direction.z);
+    u = phi / (2.0 * std::numbers::pi);
+    if (u < 0.0) {
+        u += 1.0;
+    }
+    v = theta / std::numbers::pi;
+}
+
+Color EnvironmentMap::radiance(const Vector3D &direction) const {
+    double u, v;
+    coordinates(direction, u, v);
+    const int x = std::min(static_cast<int>(u * width_), width_ - 1);
+    const int y = std::min(static_cast<int>(v * height_), height_ - 1);
+    return pixels_[static_cast<std::size_t>(y) * width_ + x];
+}
+
+Color EnvironmentMap::rectangleSum(int x0, int x1, int y0, int y1) const {
+    const std::size_t stride = static_cast<std::size_t>(width_) + 1;
+    // Color has no subtraction: add the negated corners
+    return summed_[y1 * stride + x1] + summed_[y0 * stride + x0] +
+           (summed_[y0 * stride + x1] + summed_[y1 * stride + x0]) * -1.0;
+}
+
+Color EnvironmentMap::filtered(const Vector3D &direction, double angle) const {
+    double u, v;
+    coordinates(direction, u, v);
+    // Texels per radian: height / pi along theta, width / (2 pi sin(theta)) along phi
+    const double sinTheta = std::sqrt(std::max(0.0, 1.0 - direction.y * direction.y));
+    const double halfRows = 0.5 * angle * height_ / std::numbers::pi;
+    const double halfColumns = 0.5 * angle * width_ / (2.0 * std::numbers::pi * std::max(sinTheta, 1e-6));
+    if (halfRows < 0.5 && halfColumns < 0.5) {
+        return radiance(direction);
+    }
+
+    const int y0 = std::clamp(static_cast<int>(std::floor(v * height_ - halfRows)), 0, height_ - 1);
+    const int y1 = std::clamp(static_cast<int>(std::floor(v * height_ + halfRows)), 0, height_ - 1) + 1;
+    int x0 = 0, count = width_;
+    if (2.0 * halfColumns + 1.0 < width_) {
+        x0 = static_cast<int>(std::floor(u * width_ - halfColumns));
+        count = static_cast<int>(std::floor(u * width_ + halfColumns)) + 1 - x0;
+        x0 = (x0 % width_ + width_) % width_;
+    }
+    // Columns wrap around at u = 0
+    Color sum = rectangleSum(x0, std::min(x0 + count, width_), y0, y1);
+    if (x0 + count > width_) {
+        sum = sum + rectangleSum(0, x0 + count - width_, y0, y1);
+    }
+    return sum * (1.0 / (static_cast<double>(count) * (y1 - y0)));
+}
+
+int EnvironmentMap::findInterval(const double *cdf, int count, double value) {
+    const int index = static_cast<int>(std::upper_bound(cdf, cdf + count + 1, value) - cdf) - 1;
+    return std::clamp(index, 0, count - 1);
+}
+
+Vector3D EnvironmentMap::sample(double u1, double u2, Color &radiance, double &pdf) const {
+    pdf = 0.0;
+    radiance = Color(0, 0, 0);
+    if (totalWeight_ <= 0.0) {
+        return Vector3D(0, 1, 0);
+    }
+    const int y = findInterval(marginal_.data(), height_, u1);
+    const double rowWidth = marginal_[y + 1] - marginal_[y];
+    const double v = (y + (rowWidth > 0.0 ? (u1 - marginal_[y]) / rowWidth : 0.5)) / height_;
+    const double *cdf = conditional_.data() + y * (static_cast<std::size_t>(width_) + 1);
+    const int x = findInterval(cdf, width_, u2);
+    const double cellWidth = cdf[x + 1] - cdf[x];
+    const double u = (x + (cellWidth > 0.0 ? (u2 - cdf[x]) / cellWidth : 0.5)) / width_;
+
+    const double theta = std::numbers::pi * v;
+    const double phi = 2.0 * std::numbers::pi * u;
+    const double sinTheta = std::sin(theta);
+    if (sinTheta <= 0.0) {
+        return Vector3D(0, std::cos(theta), 0);
+    }
+    // Density over the unit square is P(texel) * width * height; the map
+    // covers 2 pi^2 sin(theta) steradians per unit area
+    const double probability = cellWidth * rowWeight_[y] / totalWeight_;
+    pdf = probability * width_ * height_ / (2.0 * std::numbers::pi * std::numbers::pi * sinTheta);
+    radiance = pixels_[static_cast<std::size_t>(y) * width_ + x];
+    return Vector3D(-sinTheta * std::sin(phi), std::cos(theta), sinTheta * std::cos(phi));
+}
+
+std::size_t EnvironmentMap::memoryBytes() const {
+    return (pixels_.size() + summed_.size()) * sizeof(Color) +
+           (marginal_.size() + conditional_.size() + rowWeight_.size()) * sizeof(double);
+}
+
+bool loadPfm(const std::string &path, std::vector<Color> &pixels, int &width, int &height, std::string &error) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        error = "не удалось открыть " + path;
+        return false;
+    }
+    std::string magic;
+    double scale = 0.0;
+    if (!(file >> magic >> width >> height >> scale) || (magic != "PF" && magic != "Pf") || width <= 0 ||
+        height <= 0 || width > (1 << 15) || height > (1 << 15) || scale == 0.0) {
+        error = "неверный заголовок PFM";
+        return false;
+    }
+    file.get(); // Single whitespace character before the data
+
+    const int channels = magic == "PF" ? 3 : 1;
+    std::vector<float> data(static_cast<std::size_t>(width) * height * channels);
+    if (!file.read(reinterpret_cast<char *>(data.data()), static_cast<std::streamsize>(data.size() * sizeof(float)))) {
+        error = "файл PFM короче, чем указано в заголовке";
+        return false;
+    }
+    // A negative scale marks little-endian data
+    const bool littleEndian = scale < 0.0;
+    if (littleEndian != (std::endian::native == std::endian::little)) {
+        for (float &value: data) {
+            std::uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            bits = (bits >> 24) | ((bits >> 8) & 0xff00u) | ((bits << 8) & 0xff0000u) | (bits << 24);
+            std::memcpy(&value, &bits, sizeof(bits));
+        }
+    }
+
+    pixels.resize(static_cast<std::size_t>(width) * height);
+    for (int y = 0; y < height; ++y) {
+        const float *row = data.data() + static_cast<std::size_t>(height - 1 - y) * width * channels;
+        for (int x = 0; x < width; ++x) {
+            const float *texel = row + static_cast<std::size_t>(x) * channels;
+            Color &c = pixels[static_cast<std::size_t>(y) * width + x];
+            c = channels == 3 ? Color(texel[0], texel[1], texel[2]) : Color(texel[0], texel[0], texel[0]);
+            if (!std::isfinite(c.r) || !std::isfinite(c.g) || !std::isfinite(c.b)) {
+                error = "в файле PFM есть NaN или бесконечность";
+                return false;
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,99 @@
+#ifndef ENVIRONMENT_H
+#define ENVIRONMENT_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "vector3d.h"
+#include "color.h"
+
+/**
+ * @brief HDR latitude-longitude environment map, lighting the scene from infinity
+ *
+ * Row 0 of the map looks straight up (+y), the last row straight down.
+ * Columns go once around the vertical axis: u = 0 looks along +z, u = 0.25
+ * along -x, u = 0.5 along -z (the camera's view direction) and u = 0.75
+ * along +x.
+ *
+ * Two tables are built once:
+ * - A summed-area table of the radiance. The average over any rectangle of
+ *   texels costs four lookups, which filters miss lookups over the
+ *   footprint of a pixel at any size.
+ * - A marginal CDF over the rows and a conditional CDF over the texels of
+ *   each row, weighted by luminance times sin(theta) (the solid angle of a
+ *   texel). Directions are sampled in proportion to the light they bring,
+ *   so samples concentrate on the sun and bright sky.
+ */
+class EnvironmentMap {
+public:
+    /**
+     * @param pixels width * height radiances, row by row from the top
+     * @param width Texels per row
+     * @param height Rows
+     * @param scale Factor applied to every radiance
+     */
+    EnvironmentMap(std::vector<Color> pixels, int width, int height, double scale);
+
+    int width() const { return width_; }
+
+    int height() const { return height_; }
+
+    /// Radiance of the texel a direction falls into
+    Color radiance(const Vector3D &direction) const;
+
+    /**
+     * @brief Average radiance over a square cone of directions
+     * @param direction Center direction (unit length)
+     * @param angle Full width of the cone in radians; below one texel the texel itself is returned
+     */
+    Color filtered(const Vector3D &direction, double angle) const;
+
+    /**
+     * @brief Sample a direction in proportion to the radiance it brings
+     * @param u1 Uniform number in [0, 1), picks the row
+     * @param u2 Uniform number in [0, 1), picks the texel in the row
+     * @param radiance Receives the radiance from the direction
+     * @param pdf Receives the probability density per solid angle
+     * @return Unit direction; pdf is 0 if the map is black
+     */
+    Vector3D sample(double u1, double u2, Color &radiance, double &pdf) const;
+
+    /// Memory of the texels and the tables in bytes
+    std::size_t memoryBytes() const;
+
+private:
+    // Map coordinates in [0, 1)^2 of a direction
+    void coordinates(const Vector3D &direction, double &u, double &v) const;
+
+    // Sum of the texels in rows [y0, y1) and columns [x0, x1), 0 <= x0 <= x1 <= width
+    Color rectangleSum(int x0, int x1, int y0, int y1) const;
+
+    // Index of the CDF interval containing value, cdf[0] = 0, cdf[count] = 1
+    static int findInterval(const double *cdf, int count, double value);
+
+    std::vector<Color> pixels_;
+    int width_, height_;
+    std::vector<Color> summed_;          ///< (width + 1) x (height + 1) summed-area table
+    std::vector<double> marginal_;       ///< height + 1 entries
+    std::vector<double> conditional_;    ///< height rows of width + 1 entries
+    std::vector<double> rowWeight_;      ///< Weight of each row, for the marginal pdf
+    double totalWeight_ = 0.0;
+};
+
+/**
+ * @brief Read a Portable Float Map
+ *
+ * Color ("PF") and grayscale ("Pf") maps in either byte order are
+ * accepted. PFM stores rows from the bottom up; they are returned from
+ * the top down.
+ *
+ * @param path File to read
+ * @param pixels Receives width * height colors
+ * @param width Receives the width
+ * @param height Receives the height
+ * @param error Receives a description of the problem
+ * @return false if the file cannot be read or is not a PFM
+ */
+bool loadPfm(const std::string &path, std::vector<Color> &pixels, int &width, int &height, std::string &error);
+
+#endif // ENVIRONMENT_H
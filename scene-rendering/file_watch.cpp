@@ -0,0 +1,79 @@
+#include "file_watch.h"
+#include <cerrno>
+#include <cstring>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Events closer together than this belong to one save
+constexpr int kQuietMs = 50;
+
+} // namespace
+
+FileWatcher::~FileWatcher() {
+#ifdef __linux__
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+#endif
+}
+
+bool FileWatcher::open(const std::string &path, std::string &error) {
+#ifdef __linux__
+    const std::size_t slash = path.rfind('/');
+    const std::string directory = slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+    name_ = slash == std::string::npos ? path : path.substr(slash + 1);
+    fd_ = inotify_init1(IN_CLOEXEC);
+    if (fd_ < 0) {
+        error = std::string("inotify_init1: ") + std::strerror(errno);
+        return false;
+    }
+    if (inotify_add_watch(fd_, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        error = directory + ": " + std::strerror(errno);
+        return false;
+    }
+    return true;
+#else
+    error = "слежение за файлами поддерживается только в Linux";
+    return false;
+#endif
+}
+
+bool FileWatcher::wait() {
+#ifdef __linux__
+    alignas(inotify_event) char buffer[4096];
+    bool changed = false;
+    while (true) {
+        // Block until the first matching event, then drain until things go quiet
+        pollfd descriptor{fd_, POLLIN, 0};
+        const int ready = poll(&descriptor, 1, changed ? kQuietMs : -1);
+        if (ready < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ready < 0) {
+            return false;
+        }
+        if (ready == 0) {
+            return true;
+        }
+        const ssize_t length = read(fd_, buffer, sizeof(buffer));
+        if (length <= 0) {
+            return false;
+        }
+        for (ssize_t offset = 0; offset < length;) {
+            const auto *event = reinterpret_cast<const inotify_event *>(buffer + offset);
+            if (event->len > 0 && name_ == event->name) {
+                changed = true;
+            }
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+        }
+    }
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,43 @@
+#ifndef FILE_WATCH_H
+#define FILE_WATCH_H
+
+#include <string>
+
+/**
+ * @brief Waits for a file to change, through inotify (Linux only)
+ *
+ * The directory of the file is watched rather than the file itself:
+ * editors often save by writing a new file and renaming it over the old
+ * one, which would silently end a watch on the old inode. A write that
+ * closes the file or a rename onto its name counts as a change; further
+ * events within a short quiet period are merged into the same change.
+ */
+class FileWatcher {
+public:
+    FileWatcher() = default;
+
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher &) = delete;
+
+    FileWatcher &operator=(const FileWatcher &) = delete;
+
+    /**
+     * @brief Start watching a file
+     * @param path File to watch; its directory must exist
+     * @param error Receives the reason if watching is not possible
+     */
+    bool open(const std::string &path, std::string &error);
+
+    /**
+     * @brief Block until the file changes
+     * @return false if the watch failed
+     */
+    bool wait();
+
+private:
+    int fd_ = -1;
+    std::string name_;  ///< File name within the watched directory
+};
+
+#endif // FILE_WATCH_H
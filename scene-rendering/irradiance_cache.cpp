@@ -0,0 +1,161 @@
+#include "irradiance_cache.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr int kMaxDepth = 24;
+
+// Child octant of point inside a node centered at center
+int octant(const Vector3D &center, const Vector3D &p) {
+    return (p.x >= center.x ? 1 : 0) | (p.y >= center.y ? 2 : 0) | (p.z >= center.z ? 4 : 0);
+}
+
+Vector3D octantCenter(const Vector3D &center, double halfSize, int index) {
+    const double q = halfSize * 0.5;
+    return Vector3D(center.x + ((index & 1) ? q : -q),
+                    center.y + ((index & 2) ? q : -q),
+                    center.z + ((index & 4) ? q : -q));
+}
+
+// Point inside the node box grown by margin
+bool inside(const Vector3D &center, double extent, const Vector3D &p) {
+    return std::abs(p.x - center.x) <= extent && std::abs(p.y - center.y) <= extent &&
+           std::abs(p.z - center.z) <= extent;
+}
+
+double channel(const Color &c, int k) {
+    return k == 0 ? c.r : (k == 1 ? c.g : c.b);
+}
+
+} // namespace
+
+IrradianceCache::Node::Node(const Vector3D &c, double h) : center(c), halfSize(h), entries(nullptr) {
+    for (auto &child: children) {
+        child.store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * The root is the cube around the bounds; insert keeps records outside it in
+ * the root's own list, which every lookup scans.
+ */
+IrradianceCache::IrradianceCache(const Vector3D &boundsMin, const Vector3D &boundsMax, double accuracy)
+    : errorBound(accuracy) {
+    const Vector3D center = (boundsMin + boundsMax) * 0.5;
+    const Vector3D extent = boundsMax - boundsMin;
+    const double halfSize = 0.5 * std::max({extent.x, extent.y, extent.z, 1e-3}) * 1.01;
+    root = new Node(center, halfSize);
+}
+
+IrradianceCache::~IrradianceCache() {
+    destroy(root);
+}
+
+void IrradianceCache::destroy(Node *node) {
+    if (!node) {
+        return;
+    }
+    for (auto &child: node->children) {
+        destroy(child.load(std::memory_order_relaxed));
+    }
+    for (Entry *e = node->entries.load(std::memory_order_relaxed); e;) {
+        Entry *next = e->next;
+        delete e;
+        e = next;
+    }
+    delete node;
+}
+
+/**
+ * Descend to the deepest node whose half size still covers the validity
+ * radius, creating missing children with compare-and-swap (the loser of a
+ * race deletes its node and follows the winner), then push the record onto
+ * the node's list. A record outside the root cube stays at the root: no child
+ * box holds it, so lookups near it would never visit the child it fell into.
+ */
+void IrradianceCache::insert(const IrradianceRecord &record) {
+    Entry *entry = new Entry{record, errorBound * record.radius, nullptr};
+
+    Node *node = root;
+    const int maxDepth = inside(root->center, root->halfSize, record.position) ? kMaxDepth : 0;
+    for (int depth = 0; depth < maxDepth && node->halfSize * 0.5 >= entry->validRadius; ++depth) {
+        const int index = octant(node->center, record.position);
+        Node *child = node->children[index].load(std::memory_order_acquire);
+        if (!child) {
+            Node *fresh = new Node(octantCenter(node->center, node->halfSize, index), node->halfSize * 0.5);
+            if (node->children[index].compare_exchange_strong(child, fresh, std::memory_order_acq_rel,
+                                                              std::memory_order_acquire)) {
+                child = fresh;
+                nodeCount.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                delete fresh;
+            }
+        }
+        node = child;
+    }
+
+    Entry *head = node->entries.load(std::memory_order_relaxed);
+    do {
+        entry->next = head;
+    } while (!node->entries.compare_exchange_weak(head, entry, std::memory_order_release,
+                                                  std::memory_order_relaxed));
+    recordCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void IrradianceCache::lookupNode(const Node *node, const Vector3D &point, const Vector3D &normal,
+                                 double &weightSum, double (&sum)[3]) const {
+    for (const Entry *e = node->entries.load(std::memory_order_acquire); e; e = e->next) {
+        const IrradianceRecord &r = e->record;
+        const Vector3D d = point - r.position;
+        const double distance = d.norm();
+        if (distance >= e->validRadius) {
+            continue;
+        }
+        // Skip records in front of the point (they see a different hemisphere)
+        if (d.dot(normal + r.normal) * 0.5 < -0.05 * r.radius) {
+            continue;
+        }
+        const double error = distance / r.radius + std::sqrt(std::max(0.0, 1.0 - normal.dot(r.normal)));
+        if (error >= errorBound) {
+            continue;
+        }
+        const double w = 1.0 / std::max(error, 1e-6);
+        const Vector3D rotation = r.normal.cross(normal);
+        for (int k = 0; k < 3; ++k) {
+            const double E = channel(r.irradiance, k) + rotation.dot(r.rotationalGradient[k]) +
+                             d.dot(r.translationalGradient[k]);
+            sum[k] += w * std::max(E, 0.0);
+        }
+        weightSum += w;
+    }
+    for (const auto &slot: node->children) {
+        const Node *child = slot.load(std::memory_order_acquire);
+        // Records in a child have validity radius <= child->halfSize
+        if (child && inside(child->center, 2.0 * child->halfSize, point)) {
+            lookupNode(child, point, normal, weightSum, sum);
+        }
+    }
+}
+
+bool IrradianceCache::lookup(const Vector3D &point, const Vector3D &normal, Color &irradiance) const {
+    lookupCount.fetch_add(1, std::memory_order_relaxed);
+    double weightSum = 0.0;
+    double sum[3] = {0.0, 0.0, 0.0};
+    lookupNode(root, point, normal, weightSum, sum);
+    if (weightSum <= 0.0) {
+        return false;
+    }
+    hitCount.fetch_add(1, std::memory_order_relaxed);
+    irradiance = Color(sum[0] / weightSum, sum[1] / weightSum, sum[2] / weightSum);
+    return true;
+}
+
+IrradianceCacheStats IrradianceCache::stats() const {
+    IrradianceCacheStats s;
+    s.lookups = lookupCount.load(std::memory_order_relaxed);
+    s.hits = hitCount.load(std::memory_order_relaxed);
+    s.records = recordCount.load(std::memory_order_relaxed);
+    s.nodes = nodeCount.load(std::memory_order_relaxed);
+    return s;
+}
@@ -0,0 +1,115 @@
+#ifndef IRRADIANCE_CACHE_H
+#define IRRADIANCE_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include "vector3d.h"
+#include "color.h"
+
+/**
+ * @brief One cached irradiance sample (Ward, Rubinstein & Clear 1988)
+ *
+ * Gradients are per color channel, in world space, as in Ward & Heckbert
+ * 1992: the rotational gradient gives the change of irradiance when the
+ * normal rotates, the translational one when the point moves.
+ */
+struct IrradianceRecord {
+    Vector3D position;                  ///< Shading point
+    Vector3D normal;                    ///< Unit surface normal
+    Color irradiance;                   ///< Indirect irradiance E
+    double radius = 0.0;                ///< Harmonic mean distance to the visible surfaces, clamped
+    Vector3D rotationalGradient[3];     ///< dE/d(normal rotation) for r, g, b
+    Vector3D translationalGradient[3];  ///< dE/d(position) for r, g, b
+};
+
+/**
+ * @brief Counters of an IrradianceCache
+ */
+struct IrradianceCacheStats {
+    std::uint64_t lookups = 0; ///< Interpolation attempts
+    std::uint64_t hits = 0;    ///< Lookups answered from cached records
+    std::uint64_t records = 0; ///< Records inserted (one per miss)
+    std::uint64_t nodes = 0;   ///< Octree nodes allocated
+};
+
+/**
+ * @brief Octree of irradiance records, safe for concurrent lookup and insert
+ *
+ * Records are stored in the octree node whose half size matches their
+ * validity radius a * R, so a lookup only visits nodes whose box, grown by
+ * that half size, contains the point. Nodes and record lists are singly
+ * linked through atomics and only ever grow: insert publishes with a
+ * compare-and-swap and lookups never block, so render threads share one
+ * cache without locks. Memory is released in the destructor.
+ */
+class IrradianceCache {
+public:
+    /**
+     * @param boundsMin Lower corner of the region to index (usually the scene bounds)
+     * @param boundsMax Upper corner; records outside the bounds are kept unsorted at the root
+     * @param accuracy Error bound a of Ward's weight; a record is used when
+     *                 |p - p_i| / R_i + sqrt(1 - n . n_i) < a
+     */
+    IrradianceCache(const Vector3D &boundsMin, const Vector3D &boundsMax, double accuracy);
+
+    ~IrradianceCache();
+
+    IrradianceCache(const IrradianceCache &) = delete;
+
+    IrradianceCache &operator=(const IrradianceCache &) = delete;
+
+    /**
+     * @brief Interpolate irradiance from nearby records
+     *
+     * Weighted by w_i = 1 / (|p - p_i| / R_i + sqrt(1 - n . n_i)) and
+     * extrapolated along the gradients; records in front of the point are
+     * skipped.
+     *
+     * @param point Shading point
+     * @param normal Unit surface normal
+     * @param irradiance Receives the interpolated irradiance on success
+     * @return false if no record is valid here (a miss)
+     */
+    bool lookup(const Vector3D &point, const Vector3D &normal, Color &irradiance) const;
+
+    /**
+     * @brief Add a record; safe to call concurrently with lookup and insert
+     */
+    void insert(const IrradianceRecord &record);
+
+    /// Error bound a
+    double accuracy() const { return errorBound; }
+
+    /// Snapshot of the counters
+    IrradianceCacheStats stats() const;
+
+private:
+    struct Entry {
+        IrradianceRecord record;
+        double validRadius; ///< accuracy * record.radius
+        Entry *next;
+    };
+
+    struct Node {
+        Vector3D center;
+        double halfSize;
+        std::atomic<Node *> children[8];
+        std::atomic<Entry *> entries;
+
+        Node(const Vector3D &c, double h);
+    };
+
+    void lookupNode(const Node *node, const Vector3D &point, const Vector3D &normal, double &weightSum,
+                    double (&sum)[3]) const;
+
+    static void destroy(Node *node);
+
+    Node *root;
+    double errorBound;
+    mutable std::atomic<std::uint64_t> lookupCount{0};
+    mutable std::atomic<std::uint64_t> hitCount{0};
+    std::atomic<std::uint64_t> recordCount{0};
+    std::atomic<std::uint64_t> nodeCount{1};
+};
+
+#endif // IRRADIANCE_CACHE_H
@@ -0,0 +1,176 @@
+#include "job_scheduler.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+const char *jobClassName(JobClass jobClass) {
+    return jobClass == JobClass::Preview ? "preview" : "final";
+}
+
+bool loadJobs(const std::string &path, std::vector<RenderJob> &jobs, std::string &error) {
+    std::ifstream file(path);
+    if (!file) {
+        error = "не удалось открыть " + path;
+        return false;
+    }
+    std::string line;
+    int number = 0;
+    while (std::getline(file, line)) {
+        ++number;
+        std::istringstream tokens(line.substr(0, line.find('#')));
+        std::string name;
+        if (!(tokens >> name)) {
+            continue;
+        }
+        const std::string where = "строка " + std::to_string(number) + ": ";
+        RenderJob job;
+        std::string size;
+        long long samples = 0, quota = -1;
+        char separator = 0;
+        if ((name != "preview" && name != "final") || !(tokens >> size >> samples >> quota >> job.arrival) ||
+            !(tokens >> job.output) || !(std::istringstream(size) >> job.width >> separator >> job.height) ||
+            separator != 'x') {
+            error = where + "ожидается <preview|final> <ширина>x<высота> <spp> <потоки> <время> <файл>";
+            return false;
+        }
+        if (job.width <= 0 || job.height <= 0 || job.width > 16384 || job.height > 16384 || samples <= 0 ||
+            samples > 65536 || quota < 0 || quota > 4096 || !std::isfinite(job.arrival) || job.arrival < 0.0) {
+            error = where + "недопустимый размер, число сэмплов, квота потоков или время";
+            return false;
+        }
+        if (!(tokens >> std::ws).eof()) {
+            error = where + "лишние символы в конце строки";
+            return false;
+        }
+        job.jobClass = name == "preview" ? JobClass::Preview : JobClass::Final;
+        job.sampling.maxSamples = static_cast<int>(samples);
+        job.threadQuota = static_cast<unsigned>(quota);
+        jobs.push_back(job);
+    }
+    return true;
+}
+
+JobScheduler::JobScheduler(const Camera &camera, const RenderContext &context, unsigned threads, int tileSize,
+                           Completion completion)
+    : camera_(camera), context_(context), tileSize_(tileSize), completion_(std::move(completion)) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned t = 0; t < threads; ++t) {
+        workers_.emplace_back([this] { work(); });
+    }
+}
+
+JobScheduler::~JobScheduler() {
+    finish();
+}
+
+void JobScheduler::submit(const RenderJob &spec) {
+    auto job = std::make_unique<Job>();
+    job->spec = spec;
+    job->context = context_;
+    job->context.missFootprint = camera_.screen_width / spec.width / camera_.distance;
+    job->image.assign(static_cast<std::size_t>(spec.width) * spec.height, Color(0, 0, 0));
+    job->tilesX = (spec.width + tileSize_ - 1) / tileSize_;
+    job->tileCount = job->tilesX * ((spec.height + tileSize_ - 1) / tileSize_);
+    job->submitted = Clock::now();
+    {
+        std::lock_guard lock(mutex_);
+        jobs_.push_back(std::move(job));
+    }
+    tileReady_.notify_all();
+}
+
+void JobScheduler::finish() {
+    {
+        std::unique_lock lock(mutex_);
+        jobDone_.wait(lock, [this] { return jobs_.empty(); });
+        stopping_ = true;
+    }
+    tileReady_.notify_all();
+    for (std::thread &worker: workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+bool JobScheduler::pickTile(Job *&job, int &tile) {
+    job = nullptr;
+    for (const auto &candidate: jobs_) {
+        Job &c = *candidate;
+        const bool atQuota = c.spec.threadQuota > 0 && c.running >= static_cast<int>(c.spec.threadQuota);
+        if (c.nextTile == c.tileCount || atQuota) {
+            continue;
+        }
+        // Higher class first, then fewer tiles in progress; jobs_ is oldest first
+        if (!job || c.spec.jobClass < job->spec.jobClass ||
+            (c.spec.jobClass == job->spec.jobClass && c.running < job->running)) {
+            job = &c;
+        }
+    }
+    if (!job) {
+        return false;
+    }
+    tile = job->nextTile++;
+    return true;
+}
+
+void JobScheduler::work() {
+    std::unique_lock lock(mutex_);
+    while (true) {
+        Job *job = nullptr;
+        int tile = 0;
+        tileReady_.wait(lock, [&] { return stopping_ || pickTile(job, tile); });
+        if (!job) {
+            return;
+        }
+        if (job->nextTile == 1) {
+            job->started = Clock::now();
+        }
+        ++job->running;
+        lock.unlock();
+
+        const int x0 = (tile % job->tilesX) * tileSize_;
+        const int y0 = (tile / job->tilesX) * tileSize_;
+        renderTile(camera_, job->context, job->spec.sampling, job->spec.width, job->spec.height, x0, y0,
+                   std::min(x0 + tileSize_, job->spec.width), std::min(y0 + tileSize_, job->spec.height),
+                   job->image.data());
+
+        lock.lock();
+        --job->running;
+        if (++job->done == job->tileCount) {
+            const double wait = std::chrono::duration<double>(job->started - job->submitted).count();
+            const double latency = std::chrono::duration<double>(Clock::now() - job->submitted).count();
+            lock.unlock();
+            // No worker touches the job any more: its last tile is done
+            completion_(job->spec, job->image, wait, latency);
+            lock.lock();
+            JobClassMetrics &total = totals_[job->spec.jobClass];
+            ++total.jobs;
+            total.tiles += static_cast<std::size_t>(job->tileCount);
+            total.meanWait += wait;
+            total.maxWait = std::max(total.maxWait, wait);
+            total.meanLatency += latency;
+            total.maxLatency = std::max(total.maxLatency, latency);
+            jobs_.erase(std::find_if(jobs_.begin(), jobs_.end(),
+                                     [job](const std::unique_ptr<Job> &candidate) { return candidate.get() == job; }));
+            jobDone_.notify_all();
+        }
+        // A quota slot is free again
+        tileReady_.notify_all();
+    }
+}
+
+JobClassMetrics JobScheduler::metrics(JobClass jobClass) const {
+    std::lock_guard lock(mutex_);
+    const auto total = totals_.find(jobClass);
+    if (total == totals_.end()) {
+        return JobClassMetrics();
+    }
+    JobClassMetrics result = total->second;
+    result.meanWait /= static_cast<double>(result.jobs);
+    result.meanLatency /= static_cast<double>(result.jobs);
+    return result;
+}
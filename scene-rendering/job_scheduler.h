@@ -0,0 +1,149 @@
+#ifndef JOB_SCHEDULER_H
+#define JOB_SCHEDULER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "camera.h"
+#include "color.h"
+#include "renderer.h"
+
+/**
+ * @brief Priority class of a render job; a lower value is served first
+ */
+enum class JobClass {
+    Preview,  ///< Interactive preview: small, wanted now
+    Final     ///< Final frame: large, yields tiles to previews
+};
+
+/// Name of a job class as written in a jobs file
+const char *jobClassName(JobClass jobClass);
+
+/**
+ * @brief A frame to render of the resident scene
+ */
+struct RenderJob {
+    JobClass jobClass = JobClass::Final;
+    int width = 800;
+    int height = 800;
+    SamplingSettings sampling;
+    unsigned threadQuota = 0;   ///< Most tiles of this job rendered at once, 0 = no limit
+    double arrival = 0.0;       ///< Seconds after the start of the run at which the job is submitted
+    std::string output;         ///< Image file
+};
+
+/**
+ * @brief Read a jobs file
+ *
+ * One job per line, '#' starts a comment:
+ *
+ *     <preview|final> <width>x<height> <spp> <threads> <arrival> <output>
+ *
+ * threads is the job's thread quota (0 = no limit), arrival the time in
+ * seconds after the start at which the job is submitted.
+ *
+ * @param path File to read
+ * @param jobs Receives the jobs in file order
+ * @param error Receives the line and description of the problem
+ * @return false if the file cannot be read or has an error
+ */
+bool loadJobs(const std::string &path, std::vector<RenderJob> &jobs, std::string &error);
+
+/**
+ * @brief Queue wait and completion latency of the jobs of one class
+ */
+struct JobClassMetrics {
+    std::size_t jobs = 0;       ///< Completed jobs
+    std::size_t tiles = 0;      ///< Tiles rendered for them
+    double meanWait = 0.0;      ///< Seconds from submission to the first tile starting
+    double maxWait = 0.0;
+    double meanLatency = 0.0;   ///< Seconds from submission to the last tile done
+    double maxLatency = 0.0;
+};
+
+/**
+ * @brief Renders jobs on a pool of worker threads, tile by tile
+ *
+ * Every job is split into square tiles. Whenever a worker finishes a tile
+ * it picks the next one afresh:
+ * - from the highest-priority class that has a tile available, so a final
+ *   render yields to a preview at the next tile boundary (preemption at
+ *   tile granularity; a tile in progress is never interrupted);
+ * - within the class, from the job with the fewest tiles in progress
+ *   (oldest first on a tie), so jobs of a class share the workers evenly;
+ * - never from a job that already has threadQuota tiles in progress.
+ *
+ * A job whose last tile is done is handed to the completion callback on
+ * the worker that finished it, then dropped with its image; only its queue
+ * wait and latency stay, in the totals of its class.
+ */
+class JobScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Completion = std::function<void(const RenderJob &job, const std::vector<Color> &image, double wait,
+                                          double latency)>;
+
+    /**
+     * @param camera Camera of every job
+     * @param context Scene and lights; the miss footprint is set per job from its width
+     * @param threads Worker threads, 0 = hardware concurrency
+     * @param tileSize Tile side in pixels
+     * @param completion Called with the finished image, queue wait and latency in seconds
+     */
+    JobScheduler(const Camera &camera, const RenderContext &context, unsigned threads, int tileSize,
+                 Completion completion);
+
+    ~JobScheduler();
+
+    JobScheduler(const JobScheduler &) = delete;
+
+    JobScheduler &operator=(const JobScheduler &) = delete;
+
+    /// Queue a job; it competes for workers from now on
+    void submit(const RenderJob &job);
+
+    /// Wait until every submitted job is done, then stop the workers
+    void finish();
+
+    /// Metrics of the completed jobs of a class
+    JobClassMetrics metrics(JobClass jobClass) const;
+
+private:
+    struct Job {
+        RenderJob spec;
+        RenderContext context;
+        std::vector<Color> image;
+        int tilesX = 0, tileCount = 0;
+        int nextTile = 0;               ///< Next tile to hand out
+        int running = 0;                ///< Tiles in progress
+        int done = 0;
+        Clock::time_point submitted, started;
+    };
+
+    void work();
+
+    // Pick the next tile by class, fair share and quota; call with the lock held
+    bool pickTile(Job *&job, int &tile);
+
+    Camera camera_;
+    RenderContext context_;
+    int tileSize_;
+    Completion completion_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable tileReady_;   ///< A tile may have become available
+    std::condition_variable jobDone_;
+    std::vector<std::unique_ptr<Job>> jobs_;  ///< Jobs not yet completed, in submission order
+    std::map<JobClass, JobClassMetrics> totals_;  ///< Sums of the completed jobs; metrics() divides
+
+    bool stopping_ = false;
+    std::vector<std::thread> workers_;
+};
+
+#endif // JOB_SCHEDULER_H
@@ -0,0 +1,118 @@
+#ifndef LIGHT_H
+#define LIGHT_H
+
+#include <embree4/rtcore.h>
+#include <limits>
+#include "vector3d.h"
+#include "color.h"
+
+/**
+ * @brief Abstract base class for light sources
+ * Defines the interface for different types of light sources
+ */
+class Light {
+public:
+    Color intensity;
+
+    virtual bool isOccluded(const Vector3D &point, RTCScene scene, float time) const = 0;
+
+    virtual Vector3D getDirection(const Vector3D &point) const = 0;
+
+    virtual double getAttenuation(const Vector3D &point) const = 0;
+
+    /// Distance from the point to the light, infinite for lights at infinity
+    virtual double getDistance(const Vector3D &point) const = 0;
+
+    virtual ~Light() {
+    }
+};
+
+/**
+ * @brief Point light source class
+ * Emits light uniformly in all directions from a single point
+ */
+class PointLight : public Light {
+public:
+    Vector3D position;
+
+    PointLight(Vector3D pos, Color intens) {
+        position = pos;
+        intensity = intens;
+    }
+
+    bool isOccluded(const Vector3D &point, RTCScene scene, float time) const override {
+        RTCRay ray;
+        ray.org_x = point.x;
+        ray.org_y = point.y;
+        ray.org_z = point.z;
+        Vector3D dir = (position - point).normalized();
+        ray.dir_x = dir.x;
+        ray.dir_y = dir.y;
+        ray.dir_z = dir.z;
+        ray.tnear = 0.001f;
+        ray.tfar = (position - point).norm() - 0.001f;
+        ray.time = time;
+        ray.mask = ~0u;
+        ray.flags = 0;
+        rtcOccluded1(scene, &ray);
+        return ray.tfar < 0;
+    }
+
+    Vector3D getDirection(const Vector3D &point) const override {
+        return (position - point).normalized();
+    }
+
+    double getAttenuation(const Vector3D &point) const override {
+        return 1.0;
+    }
+
+    double getDistance(const Vector3D &point) const override {
+        return (position - point).norm();
+    }
+};
+
+/**
+ * @brief Directional light source class
+ * Emits parallel light rays in a specific direction (like sunlight)
+ */
+class DirectionalLight : public Light {
+public:
+    Vector3D direction;
+
+    DirectionalLight(Vector3D dir, Color intens) {
+        direction = dir.normalized();
+        intensity = intens;
+    }
+
+    bool isOccluded(const Vector3D &point, RTCScene scene, float time) const override {
+        RTCRay ray;
+        ray.org_x = point.x;
+        ray.org_y = point.y;
+        ray.org_z = point.z;
+        Vector3D dir = -direction.normalized();
+        ray.dir_x = dir.x;
+        ray.dir_y = dir.y;
+        ray.dir_z = dir.z;
+        ray.tnear = 0.001f;
+        ray.tfar = std::numeric_limits<float>::infinity();
+        ray.time = time;
+        ray.mask = ~0u;
+        ray.flags = 0;
+        rtcOccluded1(scene, &ray);
+        return ray.tfar < 0;
+    }
+
+    Vector3D getDirection(const Vector3D &point) const override {
+        return -direction.normalized();
+    }
+
+    double getAttenuation(const Vector3D &point) const override {
+        return 1.0;
+    }
+
+    double getDistance(const Vector3D &point) const override {
+        return std::numeric_limits<double>::infinity();
+    }
+};
+
+#endif // LIGHT_H
@@ -0,0 +1,34 @@
+#include "lod.h"
+#include <algorithm>
+#include <utility>
+
+LodChain buildLodChain(const TriangleMesh &mesh, std::size_t minTriangles) {
+    LodChain chain;
+    chain.levels.push_back(mesh);
+    chain.errors.push_back(0.0);
+    while (chain.levels.back().triangleCount() / 4 >= minTriangles) {
+        double error = 0.0;
+        TriangleMesh coarser = simplifyMesh(chain.levels.back(), chain.levels.back().triangleCount() / 4, error);
+        if (coarser.triangleCount() >= chain.levels.back().triangleCount()) {
+            break; // No collapse left that keeps the mesh valid
+        }
+        // Errors of successive simplifications add up at worst
+        chain.errors.push_back(chain.errors.back() + error);
+        chain.levels.push_back(std::move(coarser));
+    }
+    return chain;
+}
+
+std::size_t selectLod(const LodChain &chain, const Camera &camera, int imageWidth, const Vector3D &center,
+                      double radius, double scale, double maxPixelError) {
+    if (maxPixelError <= 0.0) {
+        return 0;
+    }
+    const double nearest = std::max((center - camera.eye).norm() - radius, 1e-3);
+    const double pixelsPerUnit = camera.distance / nearest * imageWidth / camera.screen_width;
+    std::size_t level = 0;
+    while (level + 1 < chain.levels.size() && chain.errors[level + 1] * scale * pixelsPerUnit <= maxPixelError) {
+        ++level;
+    }
+    return level;
+}
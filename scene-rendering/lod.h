@@ -0,0 +1,47 @@
+#ifndef LOD_H
+#define LOD_H
+
+#include <cstddef>
+#include <vector>
+#include "mesh.h"
+#include "camera.h"
+
+/**
+ * @brief Detail levels of one mesh, from full resolution down
+ *
+ * Level k + 1 has about a quarter of the triangles of level k and is made
+ * from it by simplifyMesh(). Each level stores how far it may deviate from
+ * the full mesh, in the mesh's own units.
+ */
+struct LodChain {
+    std::vector<TriangleMesh> levels;  ///< levels[0] is the input mesh
+    std::vector<double> errors;        ///< Geometric error of each level, errors[0] = 0
+};
+
+/**
+ * @brief Build the detail levels of a mesh
+ * @param mesh Full-resolution, closed mesh
+ * @param minTriangles No level is simplified below this triangle count
+ */
+LodChain buildLodChain(const TriangleMesh &mesh, std::size_t minTriangles = 80);
+
+/**
+ * @brief Pick the coarsest level whose error stays below a pixel budget on screen
+ *
+ * The error of a level is projected at the point of the instance's bounding
+ * sphere closest to the camera, where it is largest: an error e at distance
+ * d covers e * (distance / d) * (imageWidth / screen_width) pixels.
+ *
+ * @param chain Detail levels
+ * @param camera Camera the image is rendered from
+ * @param imageWidth Image width in pixels
+ * @param center Center of the instance's bounding sphere
+ * @param radius Radius of the bounding sphere
+ * @param scale Scale of the instance relative to the chain's mesh
+ * @param maxPixelError Largest allowed error in pixels, 0 = full detail
+ * @return Index into chain.levels
+ */
+std::size_t selectLod(const LodChain &chain, const Camera &camera, int imageWidth, const Vector3D &center,
+                      double radius, double scale, double maxPixelError);
+
+#endif // LOD_H
@@ -8,7 +8,58 @@
  * - Point and directional light sources
  * - Phong shading with diffuse and specular components
  * - Recursive ray tracing for reflections
+ * - Dielectric (glass) materials with Fresnel-weighted, budgeted ray splitting
  * - Shadow calculation
+ * - Shading and tonemap kernels dispatched at runtime to the best
+ *   instruction set of the CPU (FORCE_ISA overrides, see cpu_dispatch.h)
+ * - One bounce of indirect diffuse light from an irradiance cache
+ *   (--gi cache) or brute-force hemisphere sampling (--gi brute)
+ * - Caustics from a photon map traced from the point lights (--caustics)
+ * - Thin-lens depth of field and adaptive supersampling with packets of
+ *   primary rays (--aperture, --spp)
+ * - Motion blur from time-stepped vertex buffers and per-ray shutter times
+ *   (--motion, --spin)
+ * - Procedural geometry through Embree user geometry callbacks: a heightfield
+ *   terrain with a min/max mip pyramid and a sphere-traced SDF (--terrain, --sdf)
+ * - Level of detail: quadric-decimated mesh levels picked per object by
+ *   projected size (--spheres, --lod-error)
+ * - Catmull-Clark subdivision surfaces tessellated by Embree with edge levels
+ *   from screen-space size, within a tessellation cache budget (--subdiv, --tess-cache)
+ * - Curves: round Bezier cables and flat linear fibres loaded from a file or
+ *   generated, with Kajiya-Kay strand shading (--curves, --hair)
+ * - HDR environment map lighting from a lat-long PFM, importance-sampled
+ *   through marginal/conditional CDFs, with summed-area-table filtered
+ *   background lookups (--env, --env-scale, --env-samples)
+ * - Participating media: uniform haze and a heterogeneous ground fog bank,
+ *   delta and ratio tracking over a majorant block grid, single scattering
+ *   with packet-traced shadow rays (--fog, --fog-bank, --fog-steps)
+ * - Scene file with materials, offsets and lights, reloaded through inotify
+ *   on every save; changed objects are recommitted and the pixels they cover
+ *   re-rendered first, found from a G-buffer of geometry IDs (--scene, --watch)
+ * - Server mode: a tile scheduler with preview and final priority classes,
+ *   tile-granular preemption, per-job thread quotas, fair sharing and queue
+ *   metrics per class (--jobs, --tile)
+ * - Checkpoint and resume: finished tiles and their pixels kept in a
+ *   memory-mapped file, synced on a background thread (--checkpoint)
+ * - Deadline mode: progressive passes whose resolution, samples and bounce
+ *   limit are picked from the measured throughput to fit a time budget
+ *   (--deadline, --max-depth)
+ * - Rows rendered in parallel on all hardware threads
+ * 
+ * Usage:
+ *   image_rendering [--size <width>x<height>] [--threads <n>] [--gi off|cache|brute]
+ *                   [--gi-accuracy <a>] [--gi-rows <n>] [--caustics <photons>]
+ *                   [--caustic-k <n>] [--caustic-radius <r>] [--split-throughput <t>]
+ *                   [--spp <n>] [--min-spp <n>] [--noise <t>] [--aperture <radius>]
+ *                   [--focus <distance>] [--motion <dx>,<dy>,<dz>] [--spin <degrees>]
+ *                   [--time-steps <n>] [--terrain <cells>] [--sdf on|off] [--spheres <n>]
+ *                   [--lod-error <pixels>] [--subdiv <pixels>] [--tess-cache <MB>]
+ *                   [--curves <file>] [--hair <n>] [--env <file.pfm>] [--env-scale <s>]
+ *                   [--env-samples <n>] [--fog <sigma>] [--fog-bank <sigma>] [--fog-grid <n>]
+ *                   [--fog-albedo <a>] [--fog-g <g>] [--fog-steps <n>] [--scene <file>]
+ *                   [--watch on|off] [--jobs <file>] [--tile <px>] [--checkpoint <file>]
+ *                   [--checkpoint-interval <s>] [--max-depth <n>] [--deadline <ms>]
+ *                   [--output <file.ppm>]
  * 
  * Output: PPM image file (output.ppm)
  */
@@ -17,284 +68,140 @@
 #include <vector>
 #include <iostream>
 #include <fstream>
+#include <chrono>
 #include <cmath>
 #include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <atomic>
+#include <string>
+#include <utility>
+#include <map>
+#include <mutex>
+#include <thread>
+#include "vector3d.h"
+#include "color.h"
+#include "material.h"
+#include "light.h"
+#include "camera.h"
+#include "shading.h"
+#include "renderer.h"
+#include "irradiance_cache.h"
+#include "photon_map.h"
+#include "render_options.h"
+#include "motion.h"
+#include "procedural.h"
+#include "mesh.h"
+#include "lod.h"
+#include "subdivision.h"
+#include "curves.h"
+#include "environment.h"
+#include "medium.h"
+#include "scene_file.h"
+#include "file_watch.h"
+#include "job_scheduler.h"
+#include "checkpoint.h"
+#include "deadline.h"
+#include "cpu_dispatch.h"
 
 /**
- * @brief 3D Vector class for geometric operations
- * Provides basic vector arithmetic and operations for 3D graphics
+ * @brief Embree error handler
+ * Called when Embree encounters an error during ray tracing operations
  */
-class Vector3D {
-public:
-    double x, y, z;
-
-    Vector3D(double x_ = 0, double y_ = 0, double z_ = 0) : x(x_), y(y_), z(z_) {
-    }
-
-    Vector3D operator+(const Vector3D &other) const { return Vector3D(x + other.x, y + other.y, z + other.z); }
-    Vector3D operator-(const Vector3D &other) const { return Vector3D(x - other.x, y - other.y, z - other.z); }
-    Vector3D operator*(double scalar) const { return Vector3D(x * scalar, y * scalar, z * scalar); }
-    Vector3D operator-() const { return Vector3D(-x, -y, -z); }
-    double dot(const Vector3D &other) const { return x * other.x + y * other.y + z * other.z; }
-
-    Vector3D cross(const Vector3D &other) const {
-        return Vector3D(y * other.z - z * other.y, z * other.x - x * other.z, x * other.y - y * other.x);
-    }
-
-    double norm() const { return std::sqrt(x * x + y * y + z * z); }
-
-    Vector3D normalized() const {
-        double n = norm();
-        return n > 0 ? *this * (1.0 / n) : *this;
-    }
-};
+void errorFunction(void *userPtr, RTCError error, const char *str) {
+    std::cerr << "Embree Error " << error << ": " << str << std::endl;
+}
 
 /**
- * @brief RGB Color class for color representation
- * Supports color arithmetic operations for lighting calculations
+ * @brief Embree memory monitor
+ * Accumulates the bytes Embree allocates (BVH nodes and its own buffers) into an atomic counter
  */
-class Color {
-public:
-    double r, g, b;
-
-    Color(double r_ = 0, double g_ = 0, double b_ = 0) : r(r_), g(g_), b(b_) {
-    }
-
-    Color operator*(double scalar) const { return Color(r * scalar, g * scalar, b * scalar); }
-    Color operator+(const Color &other) const { return Color(r + other.r, g + other.g, b + other.b); }
-    Color operator*(const Color &other) const { return Color(r * other.r, g * other.g, b * other.b); }
-};
+bool memoryMonitor(void *userPtr, ssize_t bytes, [[maybe_unused]] bool post) {
+    static_cast<std::atomic<long long> *>(userPtr)->fetch_add(bytes, std::memory_order_relaxed);
+    return true;
+}
 
 /**
- * @brief Material structure for surface properties
- * Defines how a surface interacts with light (Phong reflection model)
+ * @brief Embree memory of a geometry: its buffers and a BVH built over it alone
+ * Builds the BVH in a scratch scene, released again before returning.
  */
-struct Material {
-    Color color;             ///< Base diffuse color
-    double diffuse;          ///< Diffuse reflection coefficient
-    double specular;         ///< Specular reflection coefficient
-    double exponent;         ///< Specular exponent (shininess)
-    Color specular_color;    ///< Specular highlight color
-    double reflectivity;     ///< Reflection coefficient (0.0 = no reflection, 1.0 = perfect mirror)
-};
+long long measureGeometryBytes(RTCDevice device, RTCGeometry geometry, const std::atomic<long long> &embreeBytes,
+                               long long bytesBefore) {
+    RTCScene scratch = rtcNewScene(device);
+    rtcAttachGeometry(scratch, geometry);
+    rtcCommitScene(scratch);
+    const long long bytes = embreeBytes.load() - bytesBefore;
+    rtcReleaseScene(scratch);
+    return bytes;
+}
 
 /**
- * @brief Abstract base class for light sources
- * Defines the interface for different types of light sources
+ * @brief A built-in object the scene file can edit: its material and position
  */
-class Light {
-public:
-    Color intensity;
-
-    virtual bool isOccluded(const Vector3D &point, RTCScene scene) const = 0;
-
-    virtual Vector3D getDirection(const Vector3D &point) const = 0;
-
-    virtual double getAttenuation(const Vector3D &point) const = 0;
-
-    virtual ~Light() {
-    }
+struct EditableObject {
+    RTCGeometry geometry;
+    unsigned id;                 ///< Geometry ID in the scene
+    Material *material;          ///< Material the geometry's user data points to
+    std::vector<float> base;     ///< Vertices as built, x, y, z each
+    float *vertices;             ///< Vertex array shared with Embree
+    Vector3D pivot;              ///< Pivot of the shutter motion
+    ObjectMotion motion;         ///< Shutter motion, none for static objects
 };
 
 /**
- * @brief Point light source class
- * Emits light uniformly in all directions from a single point
+ * @brief Move an object by offset from where it was built and recommit its geometry
+ * The scene still has to be committed.
  */
-class PointLight : public Light {
-public:
-    Vector3D position;
-
-    PointLight(Vector3D pos, Color intens) {
-        position = pos;
-        intensity = intens;
+void placeObject(EditableObject &object, const Vector3D &offset) {
+    const double delta[3] = {offset.x, offset.y, offset.z};
+    for (std::size_t k = 0; k < object.base.size(); ++k) {
+        object.vertices[k] = static_cast<float>(object.base[k] + delta[k % 3]);
     }
-
-    bool isOccluded(const Vector3D &point, RTCScene scene) const override {
-        RTCRay ray;
-        ray.org_x = point.x;
-        ray.org_y = point.y;
-        ray.org_z = point.z;
-        Vector3D dir = (position - point).normalized();
-        ray.dir_x = dir.x;
-        ray.dir_y = dir.y;
-        ray.dir_z = dir.z;
-        ray.tnear = 0.001f;
-        ray.tfar = (position - point).norm() - 0.001f;
-        ray.flags = 0;
-        rtcOccluded1(scene, &ray);
-        return ray.tfar < 0;
+    if (object.motion.moving()) {
+        // Buffers of each time step are Embree's own copies: build them anew
+        setMotionVertices(object.geometry, object.vertices, static_cast<unsigned>(object.base.size() / 3),
+                          object.pivot + offset, object.motion);
+    } else {
+        rtcUpdateGeometryBuffer(object.geometry, RTC_BUFFER_TYPE_VERTEX, 0);
     }
-
-    Vector3D getDirection(const Vector3D &point) const override {
-        return (position - point).normalized();
-    }
-
-    double getAttenuation(const Vector3D &point) const override {
-        return 1.0;
-    }
-};
-
-/**
- * @brief Directional light source class
- * Emits parallel light rays in a specific direction (like sunlight)
- */
-class DirectionalLight : public Light {
-public:
-    Vector3D direction;
-
-    DirectionalLight(Vector3D dir, Color intens) {
-        direction = dir.normalized();
-        intensity = intens;
-    }
-
-    bool isOccluded(const Vector3D &point, RTCScene scene) const override {
-        RTCRay ray;
-        ray.org_x = point.x;
-        ray.org_y = point.y;
-        ray.org_z = point.z;
-        Vector3D dir = -direction.normalized();
-        ray.dir_x = dir.x;
-        ray.dir_y = dir.y;
-        ray.dir_z = dir.z;
-        ray.tnear = 0.001f;
-        ray.tfar = std::numeric_limits<float>::infinity();
-        ray.flags = 0;
-        rtcOccluded1(scene, &ray);
-        return ray.tfar < 0;
-    }
-
-    Vector3D getDirection(const Vector3D &point) const override {
-        return -direction.normalized();
-    }
-
-    double getAttenuation(const Vector3D &point) const override {
-        return 1.0;
-    }
-};
-
-/**
- * @brief Compute the ray direction through a pixel
- * 
- * Calculates the direction of a ray from the camera eye through a specific
- * pixel (i, j) on the virtual screen.
- * 
- * @param i Pixel column index
- * @param j Pixel row index
- * @param width Image width in pixels
- * @param height Image height in pixels
- * @param eye Camera position
- * @param center Point the camera is looking at
- * @param up Up direction vector
- * @param distance Distance from camera to the screen
- * @param screen_width Width of the virtual screen
- * @param screen_height Height of the virtual screen
- * @return Normalized ray direction vector
- */
-Vector3D computeRayDirection(int i, int j, int width, int height, const Vector3D &eye, const Vector3D center,
-                             const Vector3D &up, double distance, double screen_width, double screen_height) {
-    Vector3D view = (center - eye).normalized();
-    Vector3D right = view.cross(up).normalized();
-    Vector3D actual_up = right.cross(view).normalized();
-    Vector3D screen_center = eye + view * distance;
-    double u = (i + 0.5) / width * screen_width - screen_width / 2;
-    double v = -(j + 0.5) / height * screen_height + screen_height / 2;
-    Vector3D screen_point = screen_center + right * u + actual_up * v;
-    Vector3D rayDir = (screen_point - eye).normalized();
-    if (i == 0 && j == 0) {
-        std::cout << "Луч для пикселя (0,0): направление (" << rayDir.x << ", " << rayDir.y << ", " << rayDir.z << ")"
-                << std::endl;
-    }
-    return rayDir;
+    rtcCommitGeometry(object.geometry);
 }
 
 /**
- * @brief Shading function with recursive ray tracing
- * 
- * Computes the color at a ray-surface intersection point using the Phong
- * reflection model and supports recursive ray tracing for reflections.
- * 
- * @param rayhit Ray-surface intersection information
- * @param scene Embree scene containing all geometry
- * @param lights Vector of light sources
- * @param viewDir View direction (ray direction)
- * @param depth Current recursion depth for reflections
- * @return Final color at the intersection point
+ * @brief Save an image as a plain-text PPM
  */
-Color shade(const RTCRayHit &rayhit, RTCScene scene, const std::vector<Light *> &lights, const Vector3D &viewDir,
-            int depth = 0) {
-    const int MAX_DEPTH = 50; // Maximum recursion depth for reflections
-
-    // Stop recursion at maximum depth to prevent infinite loops
-    if (depth >= MAX_DEPTH) {
-        return Color(0, 0, 0);
+bool writePpm(const std::string &path, const std::vector<Color> &image, int width, int height) {
+    std::ofstream ppm(path);
+    if (!ppm) {
+        return false;
     }
-
-    RTCGeometry geometry = rtcGetGeometry(scene, rayhit.hit.geomID);
-    Material *material = static_cast<Material *>(rtcGetGeometryUserData(geometry));
-    Vector3D point(rayhit.ray.org_x + rayhit.ray.tfar * rayhit.ray.dir_x,
-                   rayhit.ray.org_y + rayhit.ray.tfar * rayhit.ray.dir_y,
-                   rayhit.ray.org_z + rayhit.ray.tfar * rayhit.ray.dir_z);
-    Vector3D normal(rayhit.hit.Ng_x, rayhit.hit.Ng_y, rayhit.hit.Ng_z);
-    normal = normal.normalized();
-
-    Color totalColor(0, 0, 0);
-    for (const auto *light: lights) {
-        if (!light->isOccluded(point, scene)) {
-            Vector3D L = light->getDirection(point);
-            Vector3D H = (viewDir + L).normalized();
-            double NdotL = std::max(0.0, normal.dot(L));
-            double HdotN = std::max(0.0, H.dot(normal));
-            Color diffuse = material->color * material->diffuse * NdotL;
-            Color specular = material->specular_color * material->specular * std::pow(HdotN, material->exponent);
-            Color contribution = (diffuse + specular) * light->intensity * light->getAttenuation(point);
-            totalColor = totalColor + contribution;
-        }
+    ppm << "P3\n" << width << " " << height << "\n255\n";
+    std::vector<std::uint8_t> rgb(image.size() * 3);
+    tonemapToRgb8(image.data(), image.size(), 1.0, rgb.data());
+    for (std::size_t p = 0; p < image.size(); ++p) {
+        ppm << int(rgb[3 * p]) << " " << int(rgb[3 * p + 1]) << " " << int(rgb[3 * p + 2]) << "\n";
     }
-
-    if (material->reflectivity > 0.0) {
-        Vector3D incident = -viewDir;
-        double NdotI = normal.dot(incident);
-        Vector3D reflectedDir = incident - normal * (2.0 * NdotI);
-        reflectedDir = reflectedDir.normalized();
-
-        RTCRayHit reflectedRay;
-        reflectedRay.ray.org_x = point.x;
-        reflectedRay.ray.org_y = point.y;
-        reflectedRay.ray.org_z = point.z;
-        reflectedRay.ray.dir_x = reflectedDir.x;
-        reflectedRay.ray.dir_y = reflectedDir.y;
-        reflectedRay.ray.dir_z = reflectedDir.z;
-        reflectedRay.ray.tnear = 0.001f;
-        reflectedRay.ray.tfar = std::numeric_limits<float>::infinity();
-        reflectedRay.ray.flags = 0;
-        reflectedRay.hit.geomID = RTC_INVALID_GEOMETRY_ID;
-
-        rtcIntersect1(scene, &reflectedRay);
-
-        if (reflectedRay.hit.geomID != RTC_INVALID_GEOMETRY_ID) {
-            Color reflectedColor = shade(reflectedRay, scene, lights, reflectedDir, depth + 1);
-            totalColor = totalColor + reflectedColor * material->reflectivity;
-        }
-    }
-
-    return totalColor;
+    return static_cast<bool>(ppm);
 }
 
-/**
- * @brief Embree error handler
- * Called when Embree encounters an error during ray tracing operations
- */
-void errorFunction(void *userPtr, RTCError error, const char *str) {
-    std::cerr << "Embree Error " << error << ": " << str << std::endl;
-}
+int main(int argc, char *argv[]) {
+    RenderOptions options;
+    if (!parseRenderOptions(argc, argv, options)) {
+        return 1;
+    }
 
-int main() {
-    RTCDevice device = rtcNewDevice(nullptr);
+    // Размер кэша тесселяции задаётся при создании устройства (в МБ)
+    const std::string deviceConfig = "tessellation_cache_size=" + std::to_string(options.tessellationCacheMb);
+    RTCDevice device = rtcNewDevice(deviceConfig.c_str());
     if (!device) {
         std::cerr << "Не удалось создать устройство Embree" << std::endl;
         return 1;
     }
     rtcSetDeviceErrorFunction(device, errorFunction, nullptr);
+    std::atomic<long long> embreeBytes{0};
+    rtcSetDeviceMemoryMonitorFunction(device, memoryMonitor, &embreeBytes);
+    std::cout << "Набор инструкций: " << isaName(activeIsa()) << std::endl;
     RTCScene scene = rtcNewScene(device);
 
     // Определяем материалы для объектов
@@ -340,7 +247,8 @@ int main() {
         0, 3, 7,  0, 7, 4,
         1, 2, 6,  1, 6, 5
     };
-    rtcSetSharedGeometryBuffer(cube1, RTC_BUFFER_TYPE_VERTEX, 0, RTC_FORMAT_FLOAT3, cube1Vertices, 0, 3 * sizeof(float), 8);
+    // Синий куб может двигаться за время выдержки (--motion, --spin)
+    setMotionVertices(cube1, cube1Vertices, 8, Vector3D(-0.7, 1.3, -0.6), options.motion);
     rtcSetSharedGeometryBuffer(cube1, RTC_BUFFER_TYPE_INDEX, 0, RTC_FORMAT_UINT3, cubeIndices, 0, 3 * sizeof(unsigned), 12);
     rtcCommitGeometry(cube1);
     unsigned cube1ID = rtcAttachGeometry(scene, cube1);
@@ -401,74 +309,542 @@ int main() {
     rtcSetGeometryUserData(wall, &wallMaterial);
 
 
-    rtcCommitScene(scene);
-    std::cout << "Сцена успешно создана" << std::endl;
+    // Процедурный рельеф за кубами: карта высот без треугольной сетки
+    std::unique_ptr<Heightfield> terrain;
+    ProceduralGeometry terrainGeometry{{Color(0.35, 0.6, 0.3), 0.8, 0.2, 10.0, Color(1, 1, 1), 0.0}, nullptr};
+    if (options.terrainCells > 0) {
+        const int samples = options.terrainCells + 1;
+        std::vector<float> heights(static_cast<std::size_t>(samples) * samples);
+        for (int z = 0; z < samples; ++z) {
+            for (int x = 0; x < samples; ++x) {
+                const double u = static_cast<double>(x) / options.terrainCells;
+                const double v = static_cast<double>(z) / options.terrainCells;
+                heights[static_cast<std::size_t>(z) * samples + x] = static_cast<float>(
+                    0.6 + 0.35 * std::sin(9.0 * u + 2.0 * v) * std::cos(7.0 * v) + 0.1 * std::sin(41.0 * u) *
+                    std::sin(37.0 * v + 1.0) + 0.02 * std::sin(173.0 * u + 151.0 * v));
+            }
+        }
+        terrain = std::make_unique<Heightfield>(std::move(heights), samples, samples, Vector3D(-10, 0, -9.5), 22.0,
+                                                7.0);
+        terrainGeometry.shape = terrain.get();
+        RTCGeometry geometry = createProceduralGeometry(device, terrainGeometry);
+        rtcAttachGeometry(scene, geometry);
+        rtcReleaseGeometry(geometry);
+        std::cout << "Карта высот: " << samples << "x" << samples << " отсчётов, " << terrain->primitiveCount()
+                  << " тайлов, " << terrain->memoryBytes() / 1048576.0 << " МБ (треугольная сетка: "
+                  << terrain->triangleMeshBytes() / 1048576.0 << " МБ без BVH)" << std::endl;
+    }
+
+    // Тор, заданный функцией расстояния
+    TorusShape torus(Vector3D(-2.6, 3.4, -0.5), Vector3D(0.4, 1, 0.5), 0.7, 0.22);
+    ProceduralGeometry torusGeometry{{Color(0.9, 0.7, 0.2), 0.6, 20, 80.0, Color(1, 1, 1), 0.3}, &torus};
+    if (options.sdf) {
+        RTCGeometry geometry = createProceduralGeometry(device, torusGeometry);
+        rtcAttachGeometry(scene, geometry);
+        rtcReleaseGeometry(geometry);
+    }
 
     // Настройка камеры
-    Vector3D eye(1, 2, 5);
-    Vector3D center(1, 2, 0);
-    Vector3D up(0, 1, 0);
-    double distance = 8.0;
-    double screen_width = 15.0;
-    double screen_height = 15.0;
-    int image_width = 800;
-    int image_height = 800;
+    Camera camera{Vector3D(1, 2, 5), Vector3D(1, 2, 0), Vector3D(0, 1, 0), 8.0, 15.0, 15.0};
+    camera.aperture = options.aperture;
+    camera.focus_distance = options.focusDistance;
+    int image_width = options.width;
+    int image_height = options.height;
+
+    // Ряд сфер из детализированной сетки; уровень детализации каждой сферы
+    // выбирается по её размеру на экране
+    Material lodSphereMaterial = {Color(0.2, 0.7, 0.7), 0.7, 30, 100.0, Color(1, 1, 1), 0.1};
+    std::size_t sceneTriangles = 28;
+    if (options.spheres > 0) {
+        const auto lodStart = std::chrono::steady_clock::now();
+        const LodChain sphereLods = buildLodChain(makeIcosphere(6));
+        std::cout << "Уровни детализации сферы:";
+        for (const auto &level: sphereLods.levels) {
+            std::cout << " " << level.triangleCount();
+        }
+        std::cout << " треугольников, построение "
+                  << std::chrono::duration<double>(std::chrono::steady_clock::now() - lodStart).count() << " с"
+                  << std::endl;
+
+        const double radius = 0.6;
+        std::size_t fullTriangles = 0;
+        std::vector<std::size_t> chosen;
+        std::vector<TriangleMesh> sphereMeshes;
+        for (int k = 0; k < options.spheres; ++k) {
+            const double t = options.spheres > 1 ? static_cast<double>(k) / (options.spheres - 1) : 0.0;
+            const Vector3D center = Vector3D(-1.2, 3.5, 1.8) * (1.0 - t) + Vector3D(9.0, 4.2, -9.0) * t;
+            const std::size_t level = selectLod(sphereLods, camera, image_width, center, radius, radius,
+                                                options.lodError);
+            chosen.push_back(level);
+            sphereMeshes.push_back(transformMesh(sphereLods.levels[level], radius, center));
+            fullTriangles += sphereLods.levels[0].triangleCount();
+        }
+        for (const TriangleMesh &mesh: sphereMeshes) {
+            RTCGeometry sphere = rtcNewGeometry(device, RTC_GEOMETRY_TYPE_TRIANGLE);
+            // Копии в буферах Embree: они выровнены так, как требует Embree
+            auto *vertices = static_cast<float *>(rtcSetNewGeometryBuffer(
+                sphere, RTC_BUFFER_TYPE_VERTEX, 0, RTC_FORMAT_FLOAT3, 3 * sizeof(float), mesh.vertexCount()));
+            auto *indices = static_cast<unsigned *>(rtcSetNewGeometryBuffer(
+                sphere, RTC_BUFFER_TYPE_INDEX, 0, RTC_FORMAT_UINT3, 3 * sizeof(unsigned), mesh.triangleCount()));
+            std::copy(mesh.vertices.begin(), mesh.vertices.end(), vertices);
+            std::copy(mesh.indices.begin(), mesh.indices.end(), indices);
+            rtcCommitGeometry(sphere);
+            rtcAttachGeometry(scene, sphere);
+            rtcSetGeometryUserData(sphere, &lodSphereMaterial);
+            rtcReleaseGeometry(sphere);
+            sceneTriangles += mesh.triangleCount();
+        }
+        std::cout << "Сферы: " << options.spheres << ", уровни детализации:";
+        for (const std::size_t level: chosen) {
+            std::cout << " " << level;
+        }
+        std::cout << ", треугольников " << sceneTriangles - 28 << " из " << fullTriangles << std::endl;
+    }
+
+    // Гладкое тело из поверхности подразделения Катмулла-Кларка; уровни
+    // тесселяции рёбер зависят от их размера на экране
+    Material subdivMaterial = {Color(0.8, 0.35, 0.3), 0.7, 20, 60.0, Color(1, 1, 1), 0.1};
+    if (options.subdivPixels > 0.0) {
+        const SubdivisionMesh cage = makeCubeCage(Vector3D(2.5, 3.6, 0.0), 0.8, 3);
+        std::vector<float> levels = computeEdgeLevels(cage, camera, image_width, options.subdivPixels);
+        const std::size_t requested = estimateTessellationBytes(cage, levels);
+        const std::size_t budget = static_cast<std::size_t>(options.tessellationCacheMb) * 1048576;
+        const std::size_t fitted = fitTessellationBudget(cage, levels, budget);
+        RTCGeometry geometry = createSubdivisionGeometry(device, cage, levels);
+        rtcAttachGeometry(scene, geometry);
+        rtcSetGeometryUserData(geometry, &subdivMaterial);
+        rtcReleaseGeometry(geometry);
+        const auto [minLevel, maxLevel] = std::minmax_element(levels.begin(), levels.end());
+        std::cout << "Поверхность подразделения: граней " << cage.faceCount() << ", уровни рёбер " << *minLevel
+                  << ".." << *maxLevel << ", тесселяция ~" << fitted / 1048576.0 << " МБ";
+        if (fitted < requested) {
+            std::cout << " (запрошено " << requested / 1048576.0 << " МБ, уровни уменьшены под кэш "
+                      << options.tessellationCacheMb << " МБ)";
+        }
+        std::cout << std::endl;
+    }
+
+    // Кабели (кривые Безье) и волокна (плоские ломаные) без триангуляции
+    Material cableMaterial = {Color(0.15, 0.15, 0.18), 0.7, 2, 40.0, Color(1, 1, 1), 0.0};
+    Material fibreMaterial = {Color(0.55, 0.35, 0.2), 0.7, 1, 30.0, Color(1, 0.9, 0.8), 0.0};
+    fibreMaterial.model = ShadingModel::Strand;
+    std::vector<std::pair<CurveSet, Material *>> curveSets;
+    if (!options.curvesFile.empty()) {
+        CurveSet cables, wires;
+        std::string error;
+        if (!loadCurves(options.curvesFile, cables, wires, error)) {
+            std::cerr << "Ошибка в файле кривых " << options.curvesFile << ": " << error << std::endl;
+            return 1;
+        }
+        curveSets.emplace_back(std::move(cables), &cableMaterial);
+        curveSets.emplace_back(std::move(wires), &fibreMaterial);
+    }
+    if (options.hairStrands > 0) {
+        curveSets.emplace_back(makeFibreTuft(Vector3D(1.0, 0.0, 2.2), 0.8, options.hairStrands, 7), &fibreMaterial);
+    }
+    if (!curveSets.empty()) {
+        std::size_t segments = 0, tubeTriangles = 0;
+        long long curveBytes = 0, tubeBytes = 0;
+        for (const auto &[curves, material]: curveSets) {
+            if (curves.segmentCount() == 0) {
+                continue;
+            }
+            segments += curves.segmentCount();
+            // Для сравнения: те же пряди трубками из треугольников, в отдельной сцене
+            const long long beforeTubes = embreeBytes.load();
+            const TriangleMesh tubes = tubeMesh(curves);
+            RTCGeometry tubeGeometry = rtcNewGeometry(device, RTC_GEOMETRY_TYPE_TRIANGLE);
+            auto *vertices = static_cast<float *>(rtcSetNewGeometryBuffer(
+                tubeGeometry, RTC_BUFFER_TYPE_VERTEX, 0, RTC_FORMAT_FLOAT3, 3 * sizeof(float), tubes.vertexCount()));
+            auto *indices = static_cast<unsigned *>(rtcSetNewGeometryBuffer(
+                tubeGeometry, RTC_BUFFER_TYPE_INDEX, 0, RTC_FORMAT_UINT3, 3 * sizeof(unsigned), tubes.triangleCount()));
+            std::copy(tubes.vertices.begin(), tubes.vertices.end(), vertices);
+            std::copy(tubes.indices.begin(), tubes.indices.end(), indices);
+            rtcCommitGeometry(tubeGeometry);
+            tubeBytes += measureGeometryBytes(device, tubeGeometry, embreeBytes, beforeTubes);
+            rtcReleaseGeometry(tubeGeometry);
+            tubeTriangles += tubes.triangleCount();
+
+            const long long beforeCurves = embreeBytes.load();
+            RTCGeometry geometry = createCurveGeometry(device, curves);
+            curveBytes += measureGeometryBytes(device, geometry, embreeBytes, beforeCurves);
+            rtcAttachGeometry(scene, geometry);
+            rtcSetGeometryUserData(geometry, material);
+            rtcReleaseGeometry(geometry);
+        }
+        std::cout << "Кривые: сегментов " << segments << ", память Embree " << curveBytes / 1048576.0
+                  << " МБ; трубками: треугольников " << tubeTriangles << ", " << tubeBytes / 1048576.0 << " МБ (в "
+                  << static_cast<double>(tubeBytes) / std::max(curveBytes, 1LL) << " раза больше)" << std::endl;
+    }
+
+    // Объекты, которые файл сцены может менять: материал и положение
+    std::map<std::string, EditableObject> objects;
+    objects["floor"] = {floor, floorID, &floorMaterial, {std::begin(floorVertices), std::end(floorVertices)},
+                        floorVertices, Vector3D(), {}};
+    objects["cube1"] = {cube1, cube1ID, &sphereMaterial1, {std::begin(cube1Vertices), std::end(cube1Vertices)},
+                        cube1Vertices, Vector3D(-0.7, 1.3, -0.6), options.motion};
+    objects["cube2"] = {cube2, cube2ID, &sphereMaterial2, {std::begin(cube2Vertices), std::end(cube2Vertices)},
+                        cube2Vertices, Vector3D(), {}};
+    objects["wall"] = {wall, wallID, &wallMaterial, {std::begin(wallVertices), std::end(wallVertices)},
+                       wallVertices, Vector3D(), {}};
+    SceneState sceneState;
+    for (const auto &[name, object]: objects) {
+        sceneState.materials[name] = *object.material;
+        sceneState.offsets[name] = Vector3D();
+    }
+    sceneState.lights = {{false, Vector3D(1, 3, 3), Color(200, 200, 200)},
+                         {true, Vector3D(-1, -1, -1), Color(200.0, 200.0, 200.0)}};
+    const SceneState builtIn = sceneState;
+
+    // Применяет к сцене отличия от текущего состояния: материалы меняются на
+    // месте, сдвинутые геометрии обновляются и коммитятся, затем вся сцена
+    auto applyScene = [&](const SceneState &loaded, const SceneDiff &diff) {
+        for (const std::string &name: diff.materials) {
+            *objects.at(name).material = loaded.materials.at(name);
+        }
+        for (const std::string &name: diff.moved) {
+            placeObject(objects.at(name), loaded.offsets.at(name));
+        }
+        sceneState = loaded;
+    };
+    if (!options.sceneFile.empty()) {
+        SceneState loaded;
+        std::string error;
+        if (!loadSceneFile(options.sceneFile, builtIn, loaded, error)) {
+            std::cerr << "Ошибка в файле сцены " << options.sceneFile << ": " << error << std::endl;
+            return 1;
+        }
+        applyScene(loaded, diffScenes(sceneState, loaded));
+    }
+
+    rtcCommitScene(scene);
+    std::cout << "Сцена успешно создана: треугольников " << sceneTriangles << ", память Embree (BVH и буферы) "
+              << embreeBytes.load() / 1048576.0 << " МБ" << std::endl;
 
     // Создаем источники света
+    std::vector<std::unique_ptr<Light>> ownedLights;
     std::vector<Light *> lights;
-    PointLight plight(Vector3D(1, 3, 3), Color(200, 200, 200));
-    DirectionalLight dlight(Vector3D(-1, -1, -1), Color(200.0, 200.0, 200.0));
-    lights.push_back(&plight);
-    lights.push_back(&dlight);
+    auto createLights = [&] {
+        ownedLights.clear();
+        lights.clear();
+        for (const LightSpec &spec: sceneState.lights) {
+            ownedLights.push_back(createLight(spec));
+            lights.push_back(ownedLights.back().get());
+        }
+    };
+    createLights();
+
+    // Карта окружения: свет с бесконечности и фон вместо чёрного цвета
+    std::unique_ptr<EnvironmentMap> environment;
+    if (!options.environmentFile.empty()) {
+        const auto envStart = std::chrono::steady_clock::now();
+        std::vector<Color> pixels;
+        int envWidth = 0, envHeight = 0;
+        std::string error;
+        if (!loadPfm(options.environmentFile, pixels, envWidth, envHeight, error)) {
+            std::cerr << "Ошибка карты окружения " << options.environmentFile << ": " << error << std::endl;
+            return 1;
+        }
+        environment = std::make_unique<EnvironmentMap>(std::move(pixels), envWidth, envHeight,
+                                                       options.environmentScale);
+        std::cout << "Карта окружения: " << envWidth << "x" << envHeight << ", таблицы и текселы "
+                  << environment->memoryBytes() / 1048576.0 << " МБ, загрузка "
+                  << std::chrono::duration<double>(std::chrono::steady_clock::now() - envStart).count() << " с"
+                  << std::endl;
+    }
+
+    // Туман: однородная дымка и/или неоднородная полоса у пола в границах сцены
+    std::unique_ptr<Medium> medium;
+    if (options.fogDensity > 0.0 || options.fogBank > 0.0) {
+        RTCBounds bounds;
+        rtcGetSceneBounds(scene, &bounds);
+        const Vector3D lower(bounds.lower_x, bounds.lower_y, bounds.lower_z);
+        const Vector3D upper(bounds.upper_x, bounds.upper_y, bounds.upper_z);
+        int counts[3] = {1, 1, 1};
+        std::vector<float> density{static_cast<float>(options.fogDensity)};
+        if (options.fogBank > 0.0) {
+            const Vector3D extent = upper - lower;
+            const double longest = std::max({extent.x, extent.y, extent.z});
+            const double sides[3] = {extent.x, extent.y, extent.z};
+            for (int axis = 0; axis < 3; ++axis) {
+                counts[axis] = std::max(1, static_cast<int>(std::lround(options.fogGrid * sides[axis] / longest)));
+            }
+            density.resize(static_cast<std::size_t>(counts[0]) * counts[1] * counts[2]);
+            for (int z = 0; z < counts[2]; ++z) {
+                for (int y = 0; y < counts[1]; ++y) {
+                    for (int x = 0; x < counts[0]; ++x) {
+                        // Центр вокселя; плотность спадает с высотой над полом (y = 0), клочья — из синусов
+                        const Vector3D p = lower + Vector3D((x + 0.5) * extent.x / counts[0],
+                                                            (y + 0.5) * extent.y / counts[1],
+                                                            (z + 0.5) * extent.z / counts[2]);
+                        const double patches = 0.5 + 0.5 * std::sin(0.9 * p.x + 0.3 * p.z) *
+                                                         std::sin(0.7 * p.z - 0.2 * p.x);
+                        density[(static_cast<std::size_t>(z) * counts[1] + y) * counts[0] + x] = static_cast<float>(
+                            options.fogDensity + options.fogBank * std::exp(-std::max(p.y, 0.0) / 0.8) * patches);
+                    }
+                }
+            }
+        }
+        medium = std::make_unique<Medium>(lower, upper, counts[0], counts[1], counts[2], std::move(density),
+                                          options.fogAlbedo, options.fogAnisotropy);
+        std::cout << "Туман: сетка " << counts[0] << "x" << counts[1] << "x" << counts[2] << ", блоков мажоранты "
+                  << medium->blockCount() << ", память " << medium->memoryBytes() / 1048576.0 << " МБ" << std::endl;
+    }
+
+    RenderStats stats;
+    RenderContext context{scene, &lights};
+    context.gi = options.gi;
+    context.motionBlur = options.motion.moving();
+    context.giRows = options.giRows;
+    context.splitThroughput = options.splitThroughput;
+    context.maxDepth = options.maxDepth;
+    context.stats = &stats;
+    context.environment = environment.get();
+    context.environmentSamples = options.environmentSamples;
+    context.missFootprint = camera.screen_width / image_width / camera.distance;
+    context.medium = medium.get();
+    context.mediumSteps = options.fogSteps;
+
+    // Кэш освещённости и фотонная карта зависят от всей сцены: после правки
+    // файла сцены они строятся заново
+    std::unique_ptr<IrradianceCache> irradianceCache;
+    PhotonMap causticMap;
+    auto prepareSceneCaches = [&] {
+        if (options.gi == GiMode::Cache) {
+            RTCBounds bounds;
+            rtcGetSceneBounds(scene, &bounds);
+            irradianceCache = std::make_unique<IrradianceCache>(
+                Vector3D(bounds.lower_x, bounds.lower_y, bounds.lower_z),
+                Vector3D(bounds.upper_x, bounds.upper_y, bounds.upper_z), options.giAccuracy);
+            context.irradianceCache = irradianceCache.get();
+        }
+
+        if (options.causticPhotons > 0) {
+            const auto traceStart = std::chrono::steady_clock::now();
+            context.causticMap = nullptr;
+            std::vector<Photon> photons = traceCausticPhotons(
+                context, static_cast<std::size_t>(options.causticPhotons), options.threads);
+            const auto buildStart = std::chrono::steady_clock::now();
+            const std::size_t stored = photons.size();
+            causticMap.build(std::move(photons));
+            const auto buildEnd = std::chrono::steady_clock::now();
+            std::cout << "Фотонная карта каустик: фотонов " << stored << " из " << options.causticPhotons
+                      << ", трассировка " << std::chrono::duration<double>(buildStart - traceStart).count()
+                      << " с, построение kd-дерева "
+                      << std::chrono::duration<double>(buildEnd - buildStart).count() << " с" << std::endl;
+            context.causticMap = &causticMap;
+            context.causticNeighbours = options.causticNeighbours;
+            context.causticRadius = options.causticRadius;
+        }
+    };
+    prepareSceneCaches();
+
+    // Режим сервера: задания из файла делят потоки по классам приоритета,
+    // окончательные кадры уступают тайлы предпросмотрам
+    if (!options.jobsFile.empty()) {
+        std::vector<RenderJob> jobs;
+        std::string error;
+        if (!loadJobs(options.jobsFile, jobs, error)) {
+            std::cerr << "Ошибка в файле заданий " << options.jobsFile << ": " << error << std::endl;
+            return 1;
+        }
+        std::stable_sort(jobs.begin(), jobs.end(),
+                         [](const RenderJob &a, const RenderJob &b) { return a.arrival < b.arrival; });
+        std::mutex outputMutex;
+        bool failed = false;
+        JobScheduler scheduler(camera, context, options.threads, options.tileSize,
+                               [&](const RenderJob &job, const std::vector<Color> &image, double wait,
+                                   double latency) {
+            const bool written = writePpm(job.output, image, job.width, job.height);
+            std::lock_guard lock(outputMutex);
+            std::cout << "Задание " << job.output << " (" << jobClassName(job.jobClass) << ", " << job.width << "x"
+                      << job.height << ", " << job.sampling.maxSamples << " spp): ожидание в очереди "
+                      << wait * 1000.0 << " мс, готово через " << latency << " с" << std::endl;
+            if (!written) {
+                std::cerr << "Не удалось открыть " << job.output << std::endl;
+                failed = true;
+            }
+        });
+        std::cout << "Заданий: " << jobs.size() << ", тайлы " << options.tileSize << "x" << options.tileSize
+                  << std::endl;
+        const auto runStart = std::chrono::steady_clock::now();
+        for (RenderJob &job: jobs) {
+            job.sampling.minSamples = std::min(options.minSamples, job.sampling.maxSamples);
+            job.sampling.noiseThreshold = options.noiseThreshold;
+            std::this_thread::sleep_until(runStart + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                                         std::chrono::duration<double>(job.arrival)));
+            scheduler.submit(job);
+        }
+        scheduler.finish();
+        for (const JobClass jobClass: {JobClass::Preview, JobClass::Final}) {
+            const JobClassMetrics metrics = scheduler.metrics(jobClass);
+            if (metrics.jobs == 0) {
+                continue;
+            }
+            std::cout << "Класс " << jobClassName(jobClass) << ": заданий " << metrics.jobs << ", тайлов "
+                      << metrics.tiles << ", ожидание в очереди " << metrics.meanWait * 1000.0 << " мс (макс. "
+                      << metrics.maxWait * 1000.0 << " мс), выполнение " << metrics.meanLatency << " с (макс. "
+                      << metrics.maxLatency << " с)" << std::endl;
+        }
+        rtcReleaseScene(scene);
+        rtcReleaseDevice(device);
+        return failed ? 1 : 0;
+    }
 
     // Буфер для хранения цветов изображения
-    std::vector<Color> image(image_width * image_height);
+    std::vector<Color> image;
     std::cout << "Начало рендеринга" << std::endl;
-    for (int j = 0; j < image_height; ++j) {
-        for (int i = 0; i < image_width; ++i) {
-            Vector3D rayDir = computeRayDirection(i, j, image_width, image_height, eye, center, up, distance,
-                                                  screen_width, screen_height);
-            RTCRayHit rayhit;
-            rayhit.ray.org_x = eye.x;
-            rayhit.ray.org_y = eye.y;
-            rayhit.ray.org_z = eye.z;
-            rayhit.ray.dir_x = rayDir.x;
-            rayhit.ray.dir_y = rayDir.y;
-            rayhit.ray.dir_z = rayDir.z;
-            rayhit.ray.tnear = 0.001f;
-            rayhit.ray.tfar = std::numeric_limits<float>::infinity();
-            rayhit.ray.flags = 0;
-            rayhit.hit.geomID = RTC_INVALID_GEOMETRY_ID;
-            rtcIntersect1(scene, &rayhit);
-            if (rayhit.hit.geomID != RTC_INVALID_GEOMETRY_ID) {
-                std::cout << "Пересечение в пикселе (" << i << "," << j << "), geomID: " << rayhit.hit.geomID
-                        << ", tfar: " << rayhit.ray.tfar << ", x: " << rayhit.ray.org_x + rayhit.ray.tfar * rayhit.ray.
-                        dir_x
-                        << ", y: " << rayhit.ray.org_y + rayhit.ray.tfar * rayhit.ray.dir_y
-                        << ", z: " << rayhit.ray.org_z + rayhit.ray.tfar * rayhit.ray.dir_z << std::endl;
-                image[j * image_width + i] = shade(rayhit, scene, lights, rayDir, 0); // Начинаем с глубины 0
-            } else {
-                image[j * image_width + i] = Color(0, 0, 0);
+    const auto start = std::chrono::steady_clock::now();
+    SamplingSettings sampling;
+    sampling.maxSamples = options.samples;
+    sampling.minSamples = std::min(options.minSamples, options.samples);
+    sampling.noiseThreshold = options.noiseThreshold;
+    Checkpoint checkpoint;
+    if (options.deadline > 0.0) {
+        const std::vector<DeadlineLevel> levels =
+            renderWithDeadline(camera, context, sampling, image_width, image_height, options.threads,
+                               options.tileSize, options.deadline * 1e-3, image);
+        for (std::size_t k = 0; k < levels.size(); ++k) {
+            const DeadlineLevel &level = levels[k];
+            std::cout << "Проход " << k + 1 << ": " << level.width << "x" << level.height << ", до "
+                      << level.samples << " spp, глубина " << level.maxDepth << ", тайлов " << level.tilesDone
+                      << " из " << level.tiles << " за " << level.seconds * 1e3 << " мс";
+            if (level.predicted > 0.0) {
+                std::cout << " (прогноз " << level.predicted * 1e3 << " мс)";
             }
+            std::cout << std::endl;
+        }
+    } else if (options.checkpointFile.empty()) {
+        renderImage(camera, context, sampling, image_width, image_height, options.threads, image);
+    } else {
+        std::string error;
+        if (!checkpoint.open(options.checkpointFile, image_width, image_height, options.tileSize,
+                             optionsFingerprint(argc, argv), error)) {
+            std::cerr << "Не удалось открыть контрольную точку " << options.checkpointFile << ": " << error
+                      << std::endl;
+            return 1;
         }
+        if (checkpoint.resumedTiles() > 0) {
+            std::cout << "Продолжение с контрольной точки: готово тайлов " << checkpoint.resumedTiles() << " из "
+                      << checkpoint.tileCount() << std::endl;
+        }
+        renderWithCheckpoint(camera, context, sampling, image_width, image_height, options.threads, checkpoint,
+                             options.checkpointInterval, image);
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Время рендеринга: " << seconds << " с, первичных лучей: " << stats.primaryRays << " ("
+              << static_cast<double>(stats.primaryRays) / (static_cast<double>(image_width) * image_height)
+              << " на пиксель)"
+              << ", вторичных лучей: " << stats.secondaryRays
+              << ", лучей непрямого освещения: " << stats.giRays << std::endl;
+    if (irradianceCache) {
+        const IrradianceCacheStats cacheStats = irradianceCache->stats();
+        std::cout << "Кэш освещённости: записей " << cacheStats.records << ", узлов " << cacheStats.nodes
+                  << ", запросов " << cacheStats.lookups << ", попаданий " << cacheStats.hits << " ("
+                  << (cacheStats.lookups ? 100.0 * cacheStats.hits / cacheStats.lookups : 0.0) << "%)"
+                  << std::endl;
+    }
+    if (stats.causticGathers > 0) {
+        std::cout << "Сбор фотонов: запросов " << stats.causticGathers << ", суммарно "
+                  << stats.causticGatherNs * 1e-9 << " с ("
+                  << static_cast<double>(stats.causticGatherNs) / stats.causticGathers << " нс на запрос)"
+                  << std::endl;
+    }
+    if (medium) {
+        std::cout << "Туман: шагов трекинга " << stats.mediumSteps << ", лучей с исчерпанным бюджетом "
+                  << stats.mediumBudgetHits << std::endl;
     }
 
     // Сохраняем изображение в PPM-файл
-    std::ofstream ppm("output.ppm");
-    ppm << "P3\n" << image_width << " " << image_height << "\n255\n";
-    for (const auto &c: image) {
-        double scale = 1.0;
-        int r = std::min(255, std::max(0, static_cast<int>(c.r * scale)));
-        int g = std::min(255, std::max(0, static_cast<int>(c.g * scale)));
-        int b = std::min(255, std::max(0, static_cast<int>(c.b * scale)));
-        ppm << r << " " << g << " " << b << "\n";
+    if (!writePpm(options.output, image, image_width, image_height)) {
+        std::cerr << "Не удалось открыть " << options.output << std::endl;
+        return 1;
+    }
+    std::cout << "Изображение сохранено в " << options.output << std::endl;
+    if (!options.checkpointFile.empty()) {
+        // The image is safe on disk, the progress is no longer needed
+        checkpoint.remove();
+    }
+
+    if (options.watch) {
+        FileWatcher watcher;
+        std::string error;
+        if (!watcher.open(options.sceneFile, error)) {
+            std::cerr << "Не удалось следить за " << options.sceneFile << ": " << error << std::endl;
+            return 1;
+        }
+        std::cout << "Слежение за " << options.sceneFile << " (Ctrl+C для выхода)" << std::endl;
+        // G-буфер: какая геометрия видна в каждом пикселе
+        std::vector<unsigned> visible;
+        traceGeometryIds(camera, scene, image_width, image_height, options.threads, visible);
+        while (watcher.wait()) {
+            SceneState loaded;
+            if (!loadSceneFile(options.sceneFile, builtIn, loaded, error)) {
+                std::cerr << "Ошибка в файле сцены " << options.sceneFile << ": " << error
+                          << "; сцена не изменена" << std::endl;
+                continue;
+            }
+            const SceneDiff diff = diffScenes(sceneState, loaded);
+            if (diff.empty()) {
+                std::cout << "Файл сцены сохранён без изменений" << std::endl;
+                continue;
+            }
+            const auto editStart = std::chrono::steady_clock::now();
+            applyScene(loaded, diff);
+            if (!diff.moved.empty()) {
+                rtcCommitScene(scene);
+            }
+            if (diff.lights) {
+                createLights();
+            }
+            prepareSceneCaches();
+            std::cout << "Изменения: материалов " << diff.materials.size() << ", сдвигов " << diff.moved.size()
+                      << (diff.lights ? ", источники света" : "") << std::endl;
+
+            // Без изменённого света и без кэша освещённости сначала
+            // перерисовываются пиксели, где изменённые объекты видны до или
+            // после правки, затем остальные (тени и отражения)
+            std::vector<std::uint8_t> region;
+            std::size_t regionPixels = 0;
+            std::vector<unsigned> nowVisible;
+            traceGeometryIds(camera, scene, image_width, image_height, options.threads, nowVisible);
+            if (!diff.lights && !irradianceCache) {
+                std::vector<unsigned> changed;
+                for (const std::string &name: diff.materials) {
+                    changed.push_back(objects.at(name).id);
+                }
+                for (const std::string &name: diff.moved) {
+                    changed.push_back(objects.at(name).id);
+                }
+                regionPixels = markChangedPixels(visible, nowVisible, changed, image_width, image_height, region);
+            }
+            if (regionPixels > 0 && regionPixels < image.size()) {
+                renderRegion(camera, context, sampling, image_width, image_height, options.threads, region, image);
+                const double regionSeconds =
+                    std::chrono::duration<double>(std::chrono::steady_clock::now() - editStart).count();
+                writePpm(options.output, image, image_width, image_height);
+                std::cout << "Область правки: пикселей " << regionPixels << " из " << image.size() << ", "
+                          << regionSeconds << " с" << std::endl;
+                for (std::uint8_t &flag: region) {
+                    flag = !flag;
+                }
+                renderRegion(camera, context, sampling, image_width, image_height, options.threads, region, image);
+            } else {
+                renderImage(camera, context, sampling, image_width, image_height, options.threads, image);
+            }
+            visible = std::move(nowVisible);
+            if (!writePpm(options.output, image, image_width, image_height)) {
+                std::cerr << "Не удалось открыть " << options.output << std::endl;
+                return 1;
+            }
+            std::cout << "Кадр обновлён за "
+                      << std::chrono::duration<double>(std::chrono::steady_clock::now() - editStart).count()
+                      << " с" << std::endl;
+        }
     }
-    ppm.close();
 
     // Очистка ресурсов
     rtcReleaseScene(scene);
     rtcReleaseDevice(device);
-
-    std::cout << "Изображение сохранено в output.ppm" << std::endl;
     return 0;
 }
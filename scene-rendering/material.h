@@ -0,0 +1,34 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include "color.h"
+
+/**
+ * @brief Lighting model of a material
+ */
+enum class ShadingModel {
+    Phong,  ///< Surfaces: diffuse and specular terms from the normal
+    Strand  ///< Thin fibres: Kajiya-Kay terms from the tangent of the curve hit
+};
+
+/**
+ * @brief Material structure for surface properties
+ * Defines how a surface interacts with light (Phong reflection model).
+ * A material with transparency > 0 is a dielectric: the Phong and mirror
+ * terms are scaled by 1 - transparency and the rest is split between the
+ * reflected and refracted rays by the Fresnel reflectance. A Strand
+ * material may only be used on curve geometry.
+ */
+struct Material {
+    Color color;             ///< Base diffuse color
+    double diffuse;          ///< Diffuse reflection coefficient
+    double specular;         ///< Specular reflection coefficient
+    double exponent;         ///< Specular exponent (shininess)
+    Color specular_color;    ///< Specular highlight color
+    double reflectivity;     ///< Reflection coefficient (0.0 = no reflection, 1.0 = perfect mirror)
+    double transparency = 0.0; ///< Dielectric weight: share of light split by Fresnel into reflection and refraction
+    double ior = 1.5;        ///< Index of refraction of a dielectric (glass ~1.5, water ~1.33)
+    ShadingModel model = ShadingModel::Phong; ///< Lighting model of the direct term
+};
+
+#endif // MATERIAL_H
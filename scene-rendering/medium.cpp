@@ -0,0 +1,211 @@
+#include "medium.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numbers>
+#include <utility>
+
+namespace {
+
+// Ratio tracking stops once so little light gets through
+constexpr double kMinTransmittance = 1e-4;
+
+double component(const Vector3D &v, int axis) {
+    return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+} // namespace
+
+Medium::Medium(const Vector3D &lower, const Vector3D &upper, int nx, int ny, int nz, std::vector<float> density,
+               double albedo, double g, int blockSize)
+    : lower_(lower), upper_(upper), nx_(nx), ny_(ny), nz_(nz), density_(std::move(density)), albedo_(albedo), g_(g),
+      blockSize_(blockSize) {
+    voxel_ = Vector3D((upper.x - lower.x) / nx, (upper.y - lower.y) / ny, (upper.z - lower.z) / nz);
+    bx_ = (nx + blockSize - 1) / blockSize;
+    by_ = (ny + blockSize - 1) / blockSize;
+    bz_ = (nz + blockSize - 1) / blockSize;
+    blockMin_.assign(static_cast<std::size_t>(bx_) * by_ * bz_, std::numeric_limits<float>::max());
+    blockMax_.assign(blockMin_.size(), 0.0f);
+
+    // Interpolation inside a block reaches one voxel past each of its faces
+    auto range = [blockSize](int block, int count, int &first, int &last) {
+        first = std::max(block * blockSize - 1, 0);
+        last = std::min((block + 1) * blockSize, count - 1);
+    };
+    for (int c = 0; c < bz_; ++c) {
+        for (int b = 0; b < by_; ++b) {
+            for (int a = 0; a < bx_; ++a) {
+                int x0, x1, y0, y1, z0, z1;
+                range(a, nx, x0, x1);
+                range(b, ny, y0, y1);
+                range(c, nz, z0, z1);
+                float lo = std::numeric_limits<float>::max(), hi = 0.0f;
+                for (int z = z0; z <= z1; ++z) {
+                    for (int y = y0; y <= y1; ++y) {
+                        for (int x = x0; x <= x1; ++x) {
+                            const float d = density_[(static_cast<std::size_t>(z) * ny + y) * nx + x];
+                            lo = std::min(lo, d);
+                            hi = std::max(hi, d);
+                        }
+                    }
+                }
+                const std::size_t index = (static_cast<std::size_t>(c) * by_ + b) * bx_ + a;
+                blockMin_[index] = lo;
+                blockMax_[index] = hi;
+            }
+        }
+    }
+}
+
+double Medium::extinction(const Vector3D &point) const {
+    if (point.x < lower_.x || point.y < lower_.y || point.z < lower_.z || point.x > upper_.x ||
+        point.y > upper_.y || point.z > upper_.z) {
+        return 0.0;
+    }
+    // Trilinear between voxel centers, clamped at the faces of the box
+    int i0[3], i1[3];
+    double f[3];
+    const int counts[3] = {nx_, ny_, nz_};
+    for (int axis = 0; axis < 3; ++axis) {
+        const double local = std::clamp((component(point, axis) - component(lower_, axis)) /
+                                        component(voxel_, axis) - 0.5, 0.0, counts[axis] - 1.0);
+        i0[axis] = static_cast<int>(local);
+        i1[axis] = std::min(i0[axis] + 1, counts[axis] - 1);
+        f[axis] = local - i0[axis];
+    }
+    auto at = [this](int x, int y, int z) {
+        return static_cast<double>(density_[(static_cast<std::size_t>(z) * ny_ + y) * nx_ + x]);
+    };
+    const double x00 = at(i0[0], i0[1], i0[2]) * (1 - f[0]) + at(i1[0], i0[1], i0[2]) * f[0];
+    const double x10 = at(i0[0], i1[1], i0[2]) * (1 - f[0]) + at(i1[0], i1[1], i0[2]) * f[0];
+    const double x01 = at(i0[0], i0[1], i1[2]) * (1 - f[0]) + at(i1[0], i0[1], i1[2]) * f[0];
+    const double x11 = at(i0[0], i1[1], i1[2]) * (1 - f[0]) + at(i1[0], i1[1], i1[2]) * f[0];
+    return (x00 * (1 - f[1]) + x10 * f[1]) * (1 - f[2]) + (x01 * (1 - f[1]) + x11 * f[1]) * f[2];
+}
+
+template<typename Visit>
+void Medium::traverse(const Vector3D &origin, const Vector3D &direction, double distance, Visit &&visit) const {
+    // Clip the segment to the box
+    double t0 = 0.0, t1 = distance;
+    for (int axis = 0; axis < 3; ++axis) {
+        const double o = component(origin, axis), d = component(direction, axis);
+        const double lo = component(lower_, axis), hi = component(upper_, axis);
+        if (std::abs(d) < 1e-12) {
+            if (o < lo || o > hi) {
+                return;
+            }
+            continue;
+        }
+        double ta = (lo - o) / d, tb = (hi - o) / d;
+        if (ta > tb) {
+            std::swap(ta, tb);
+        }
+        t0 = std::max(t0, ta);
+        t1 = std::min(t1, tb);
+    }
+    if (t0 >= t1) {
+        return;
+    }
+
+    // 3D DDA over the majorant blocks (Amanatides & Woo 1987)
+    const int blocks[3] = {bx_, by_, bz_};
+    int cell[3], step[3];
+    double next[3], delta[3];
+    for (int axis = 0; axis < 3; ++axis) {
+        const double o = component(origin, axis), d = component(direction, axis);
+        const double size = component(voxel_, axis) * blockSize_;
+        const double lo = component(lower_, axis);
+        cell[axis] = std::clamp(static_cast<int>(std::floor((o + d * t0 - lo) / size)), 0, blocks[axis] - 1);
+        step[axis] = d > 0.0 ? 1 : -1;
+        if (std::abs(d) < 1e-12) {
+            next[axis] = std::numeric_limits<double>::infinity();
+            delta[axis] = std::numeric_limits<double>::infinity();
+        } else {
+            next[axis] = (lo + (cell[axis] + (d > 0.0 ? 1 : 0)) * size - o) / d;
+            delta[axis] = size / std::abs(d);
+        }
+    }
+    double t = t0;
+    while (t < t1) {
+        const int axis = next[0] < next[1] ? (next[0] < next[2] ? 0 : 2) : (next[1] < next[2] ? 1 : 2);
+        const double end = std::min(next[axis], t1);
+        const std::size_t index = (static_cast<std::size_t>(cell[2]) * by_ + cell[1]) * bx_ + cell[0];
+        if (end > t && !visit(t, end, static_cast<double>(blockMin_[index]), static_cast<double>(blockMax_[index]))) {
+            return;
+        }
+        t = end;
+        cell[axis] += step[axis];
+        if (cell[axis] < 0 || cell[axis] >= blocks[axis]) {
+            return;
+        }
+        next[axis] += delta[axis];
+    }
+}
+
+double Medium::transmittance(const Vector3D &origin, const Vector3D &direction, double distance, Random &random,
+                             int &steps) const {
+    double result = 1.0;
+    traverse(origin, direction, distance, [&](double t0, double t1, double lo, double hi) {
+        if (hi <= 0.0) {
+            return true;
+        }
+        if (lo == hi) {
+            result *= std::exp(-hi * (t1 - t0)); // Uniform block: Beer-Lambert in closed form
+            return result > kMinTransmittance;
+        }
+        double t = t0;
+        while (true) {
+            t -= std::log(1.0 - random.nextDouble()) / hi;
+            if (t >= t1) {
+                return true;
+            }
+            if (steps <= 0) {
+                return false;
+            }
+            --steps;
+            // Each tentative collision keeps the share of the majorant that is null
+            result *= 1.0 - extinction(origin + direction * t) / hi;
+            if (result < kMinTransmittance) {
+                return false;
+            }
+        }
+    });
+    return result < kMinTransmittance ? 0.0 : result;
+}
+
+bool Medium::sampleCollision(const Vector3D &origin, const Vector3D &direction, double distance, Random &random,
+                             int &steps, double &t) const {
+    bool collided = false;
+    traverse(origin, direction, distance, [&](double t0, double t1, double lo, double hi) {
+        if (hi <= 0.0) {
+            return true;
+        }
+        double s = t0;
+        while (true) {
+            // Exponential steps are memoryless, so each block starts afresh at its entry
+            s -= std::log(1.0 - random.nextDouble()) / hi;
+            if (s >= t1) {
+                return true;
+            }
+            if (steps <= 0) {
+                return false;
+            }
+            --steps;
+            if (lo == hi || random.nextDouble() * hi < extinction(origin + direction * s)) {
+                t = s;
+                collided = true;
+                return false;
+            }
+        }
+    });
+    return collided;
+}
+
+double Medium::phase(double cosTheta) const {
+    const double denominator = 1.0 + g_ * g_ - 2.0 * g_ * cosTheta;
+    return (1.0 - g_ * g_) / (4.0 * std::numbers::pi * denominator * std::sqrt(denominator));
+}
+
+std::size_t Medium::memoryBytes() const {
+    return (density_.size() + blockMin_.size() + blockMax_.size()) * sizeof(float);
+}
@@ -0,0 +1,103 @@
+#ifndef MEDIUM_H
+#define MEDIUM_H
+
+#include <cstddef>
+#include <vector>
+#include "vector3d.h"
+#include "sampling.h"
+
+/**
+ * @brief Participating medium (fog, haze) on a density grid in a box
+ *
+ * The extinction coefficient is interpolated trilinearly between voxel
+ * centers; a 1 x 1 x 1 grid is a homogeneous medium. Outside the box the
+ * medium is empty.
+ *
+ * Free-flight distances are sampled by delta tracking and transmittance is
+ * estimated by ratio tracking (Novak et al. 2014). Both draw tentative
+ * collisions against a majorant: the grid is split into blocks of
+ * blockSize^3 voxels, and each block stores the smallest and largest
+ * extinction any point inside it can have. Rays walk the blocks with a 3D
+ * DDA, so a tentative collision is only as likely as the densest voxel
+ * nearby, not the densest in the grid. Where a block is uniform (smallest ==
+ * largest, e.g. the whole homogeneous medium), transmittance is computed in
+ * closed form.
+ *
+ * Every tentative collision costs one step of a caller-supplied budget.
+ * When the budget runs out, tracking stops: transmittance keeps its current
+ * estimate and no scattering event is reported.
+ */
+class Medium {
+public:
+    /**
+     * @param lower Lower corner of the box
+     * @param upper Upper corner of the box
+     * @param nx Voxels along x
+     * @param ny Voxels along y
+     * @param nz Voxels along z
+     * @param density nx * ny * nz extinction coefficients per unit length, x fastest, then y
+     * @param albedo Share of extinction that is scattering
+     * @param g Henyey-Greenstein asymmetry: 0 isotropic, > 0 forward scattering
+     * @param blockSize Voxels per majorant block side
+     */
+    Medium(const Vector3D &lower, const Vector3D &upper, int nx, int ny, int nz, std::vector<float> density,
+           double albedo, double g, int blockSize = 4);
+
+    /// Extinction coefficient at a point
+    double extinction(const Vector3D &point) const;
+
+    /**
+     * @brief Ratio-tracking estimate of the transmittance along a ray segment
+     * @param origin Ray origin
+     * @param direction Unit ray direction
+     * @param distance Segment length, may be infinite
+     * @param random Random numbers of the current pixel
+     * @param steps Remaining step budget, decremented
+     */
+    double transmittance(const Vector3D &origin, const Vector3D &direction, double distance, Random &random,
+                         int &steps) const;
+
+    /**
+     * @brief Delta-tracking free-flight sample along a ray segment
+     *
+     * The probability of a collision before distance is 1 - transmittance,
+     * and the collision point is distributed in proportion to extinction
+     * times transmittance up to it.
+     *
+     * @param t Receives the distance of the collision
+     * @return true if a real collision happens before distance
+     */
+    bool sampleCollision(const Vector3D &origin, const Vector3D &direction, double distance, Random &random,
+                         int &steps, double &t) const;
+
+    double albedo() const { return albedo_; }
+
+    /**
+     * @brief Henyey-Greenstein phase function
+     * @param cosTheta Cosine between the directions of travel before and after scattering
+     * @return Density per steradian
+     */
+    double phase(double cosTheta) const;
+
+    /// Majorant blocks along all axes
+    std::size_t blockCount() const { return blockMin_.size(); }
+
+    /// Memory of the voxels and the majorant grid in bytes
+    std::size_t memoryBytes() const;
+
+private:
+    // Visit the majorant blocks along a ray segment in order; visit(t0, t1,
+    // min, max) returns false to stop
+    template<typename Visit>
+    void traverse(const Vector3D &origin, const Vector3D &direction, double distance, Visit &&visit) const;
+
+    Vector3D lower_, upper_, voxel_;
+    int nx_, ny_, nz_;
+    std::vector<float> density_;
+    double albedo_, g_;
+    int blockSize_;
+    int bx_, by_, bz_;                        ///< Majorant blocks per axis
+    std::vector<float> blockMin_, blockMax_;  ///< Extinction bounds per block
+};
+
+#endif // MEDIUM_H
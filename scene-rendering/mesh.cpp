@@ -0,0 +1,286 @@
+#include "mesh.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <queue>
+#include <utility>
+
+namespace {
+
+/**
+ * Symmetric 4x4 quadric, upper triangle: a^2 ab ac ad b^2 bc bd c^2 cd d^2
+ * for the plane ax + by + cz + d = 0.
+ */
+struct Quadric {
+    std::array<double, 10> q{};
+
+    static Quadric plane(const Vector3D &n, double d) {
+        Quadric r;
+        r.q = {n.x * n.x, n.x * n.y, n.x * n.z, n.x * d, n.y * n.y, n.y * n.z, n.y * d, n.z * n.z, n.z * d, d * d};
+        return r;
+    }
+
+    Quadric &operator+=(const Quadric &other) {
+        for (int k = 0; k < 10; ++k) {
+            q[k] += other.q[k];
+        }
+        return *this;
+    }
+
+    // v^T Q v for v = (p, 1)
+    double evaluate(const Vector3D &p) const {
+        return q[0] * p.x * p.x + 2 * q[1] * p.x * p.y + 2 * q[2] * p.x * p.z + 2 * q[3] * p.x +
+               q[4] * p.y * p.y + 2 * q[5] * p.y * p.z + 2 * q[6] * p.y + q[7] * p.z * p.z + 2 * q[8] * p.z + q[9];
+    }
+
+    // Point minimizing the quadric, false if the 3x3 system is singular
+    bool minimum(Vector3D &p) const {
+        const double a = q[0], b = q[1], c = q[2], e = q[4], f = q[5], i = q[7];
+        const double det = a * (e * i - f * f) - b * (b * i - f * c) + c * (b * f - e * c);
+        if (std::abs(det) < 1e-12) {
+            return false;
+        }
+        const double inv = 1.0 / det;
+        const double rx = -q[3], ry = -q[6], rz = -q[8];
+        p.x = inv * (rx * (e * i - f * f) - b * (ry * i - f * rz) + c * (ry * f - e * rz));
+        p.y = inv * (a * (ry * i - f * rz) - rx * (b * i - f * c) + c * (b * rz - ry * c));
+        p.z = inv * (a * (e * rz - ry * f) - b * (b * rz - ry * c) + rx * (b * f - e * c));
+        return true;
+    }
+};
+
+struct Collapse {
+    double cost;
+    unsigned a, b;
+    std::uint32_t versionA, versionB;
+    Vector3D target;
+
+    bool operator>(const Collapse &other) const { return cost > other.cost; }
+};
+
+} // namespace
+
+TriangleMesh makeIcosphere(int subdivisions) {
+    const double t = (1.0 + std::sqrt(5.0)) / 2.0;
+    std::vector<Vector3D> points = {
+        {-1, t, 0}, {1, t, 0}, {-1, -t, 0}, {1, -t, 0}, {0, -1, t}, {0, 1, t},
+        {0, -1, -t}, {0, 1, -t}, {t, 0, -1}, {t, 0, 1}, {-t, 0, -1}, {-t, 0, 1}};
+    for (auto &p: points) {
+        p = p.normalized();
+    }
+    std::vector<unsigned> indices = {
+        0, 11, 5, 0, 5, 1, 0, 1, 7, 0, 7, 10, 0, 10, 11, 1, 5, 9, 5, 11, 4, 11, 10, 2, 10, 7, 6, 7, 1, 8,
+        3, 9, 4, 3, 4, 2, 3, 2, 6, 3, 6, 8, 3, 8, 9, 4, 9, 5, 2, 4, 11, 6, 2, 10, 8, 6, 7, 9, 8, 1};
+
+    for (int s = 0; s < subdivisions; ++s) {
+        std::map<std::pair<unsigned, unsigned>, unsigned> midpoints;
+        auto midpoint = [&](unsigned a, unsigned b) {
+            const auto key = std::minmax(a, b);
+            const auto it = midpoints.find(key);
+            if (it != midpoints.end()) {
+                return it->second;
+            }
+            points.push_back((points[a] + points[b]).normalized());
+            const unsigned index = static_cast<unsigned>(points.size() - 1);
+            midpoints.emplace(key, index);
+            return index;
+        };
+        std::vector<unsigned> refined;
+        refined.reserve(indices.size() * 4);
+        for (std::size_t f = 0; f < indices.size(); f += 3) {
+            const unsigned a = indices[f], b = indices[f + 1], c = indices[f + 2];
+            const unsigned ab = midpoint(a, b), bc = midpoint(b, c), ca = midpoint(c, a);
+            refined.insert(refined.end(), {a, ab, ca, b, bc, ab, c, ca, bc, ab, bc, ca});
+        }
+        indices = std::move(refined);
+    }
+
+    TriangleMesh mesh;
+    mesh.vertices.reserve(points.size() * 3);
+    for (const auto &p: points) {
+        mesh.vertices.insert(mesh.vertices.end(), {static_cast<float>(p.x), static_cast<float>(p.y),
+                                                   static_cast<float>(p.z)});
+    }
+    mesh.indices = std::move(indices);
+    return mesh;
+}
+
+TriangleMesh transformMesh(const TriangleMesh &mesh, double scale, const Vector3D &offset) {
+    TriangleMesh result = mesh;
+    for (std::size_t v = 0; v < result.vertexCount(); ++v) {
+        result.vertices[3 * v] = static_cast<float>(mesh.vertices[3 * v] * scale + offset.x);
+        result.vertices[3 * v + 1] = static_cast<float>(mesh.vertices[3 * v + 1] * scale + offset.y);
+        result.vertices[3 * v + 2] = static_cast<float>(mesh.vertices[3 * v + 2] * scale + offset.z);
+    }
+    return result;
+}
+
+TriangleMesh simplifyMesh(const TriangleMesh &mesh, std::size_t targetTriangles, double &error) {
+    const std::size_t vertexCount = mesh.vertexCount();
+    const std::size_t faceCount = mesh.triangleCount();
+    std::vector<Vector3D> positions(vertexCount);
+    for (std::size_t v = 0; v < vertexCount; ++v) {
+        positions[v] = Vector3D(mesh.vertices[3 * v], mesh.vertices[3 * v + 1], mesh.vertices[3 * v + 2]);
+    }
+    std::vector<std::array<unsigned, 3>> faces(faceCount);
+    std::vector<bool> faceAlive(faceCount, true);
+    std::vector<std::vector<unsigned>> vertexFaces(vertexCount);
+    std::vector<Quadric> quadrics(vertexCount);
+    for (std::size_t f = 0; f < faceCount; ++f) {
+        faces[f] = {mesh.indices[3 * f], mesh.indices[3 * f + 1], mesh.indices[3 * f + 2]};
+        const Vector3D &p0 = positions[faces[f][0]];
+        const Vector3D n = (positions[faces[f][1]] - p0).cross(positions[faces[f][2]] - p0).normalized();
+        const Quadric plane = Quadric::plane(n, -n.dot(p0));
+        for (unsigned v: faces[f]) {
+            quadrics[v] += plane;
+            vertexFaces[v].push_back(static_cast<unsigned>(f));
+        }
+    }
+
+    std::vector<std::uint32_t> version(vertexCount, 0);
+    std::vector<bool> vertexAlive(vertexCount, true);
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<>> heap;
+
+    auto pushEdge = [&](unsigned a, unsigned b) {
+        Quadric q = quadrics[a];
+        q += quadrics[b];
+        Vector3D target;
+        if (!q.minimum(target)) {
+            target = (positions[a] + positions[b]) * 0.5;
+        }
+        heap.push({std::max(0.0, q.evaluate(target)), a, b, version[a], version[b], target});
+    };
+    for (const auto &face: faces) {
+        for (int k = 0; k < 3; ++k) {
+            const unsigned a = face[k], b = face[(k + 1) % 3];
+            if (a < b) {
+                pushEdge(a, b); // Each interior edge is seen twice, once in each direction
+            }
+        }
+    }
+
+    auto neighboursOf = [&](unsigned v) {
+        std::vector<unsigned> result;
+        for (unsigned f: vertexFaces[v]) {
+            if (!faceAlive[f]) {
+                continue;
+            }
+            for (unsigned n: faces[f]) {
+                if (n != v) {
+                    result.push_back(n);
+                }
+            }
+        }
+        std::sort(result.begin(), result.end());
+        result.erase(std::unique(result.begin(), result.end()), result.end());
+        return result;
+    };
+
+    // Link condition: a and b may only share the two vertices opposite their edge,
+    // otherwise the collapse pinches the surface into a non-manifold one
+    auto keepsManifold = [&](unsigned a, unsigned b) {
+        const std::vector<unsigned> na = neighboursOf(a);
+        const std::vector<unsigned> nb = neighboursOf(b);
+        std::vector<unsigned> common;
+        std::set_intersection(na.begin(), na.end(), nb.begin(), nb.end(), std::back_inserter(common));
+        return common.size() <= 2;
+    };
+
+    // A collapse must not flip any surviving triangle around a or b
+    auto flips = [&](unsigned a, unsigned b, const Vector3D &target) {
+        for (unsigned v: {a, b}) {
+            for (unsigned f: vertexFaces[v]) {
+                if (!faceAlive[f]) {
+                    continue;
+                }
+                const auto &face = faces[f];
+                const bool hasA = face[0] == a || face[1] == a || face[2] == a;
+                const bool hasB = face[0] == b || face[1] == b || face[2] == b;
+                if (hasA && hasB) {
+                    continue; // Removed by the collapse
+                }
+                Vector3D p[3];
+                for (int k = 0; k < 3; ++k) {
+                    p[k] = face[k] == v ? target : positions[face[k]];
+                }
+                const Vector3D before = (positions[face[1]] - positions[face[0]]).cross(
+                    positions[face[2]] - positions[face[0]]);
+                const Vector3D after = (p[1] - p[0]).cross(p[2] - p[0]);
+                if (before.dot(after) <= 0.2 * before.norm() * after.norm()) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    };
+
+    std::size_t liveFaces = faceCount;
+    double maxCost = 0.0;
+    while (liveFaces > targetTriangles && !heap.empty()) {
+        const Collapse c = heap.top();
+        heap.pop();
+        if (!vertexAlive[c.a] || !vertexAlive[c.b] || version[c.a] != c.versionA || version[c.b] != c.versionB) {
+            continue; // Stale entry
+        }
+        if (!keepsManifold(c.a, c.b) || flips(c.a, c.b, c.target)) {
+            continue; // Dropped until a or b absorbs another collapse
+        }
+
+        // Collapse b into a
+        positions[c.a] = c.target;
+        quadrics[c.a] += quadrics[c.b];
+        vertexAlive[c.b] = false;
+        ++version[c.a];
+        maxCost = std::max(maxCost, c.cost);
+        for (unsigned f: vertexFaces[c.b]) {
+            if (!faceAlive[f]) {
+                continue;
+            }
+            auto &face = faces[f];
+            if (face[0] == c.a || face[1] == c.a || face[2] == c.a) {
+                faceAlive[f] = false;
+                --liveFaces;
+                continue;
+            }
+            for (unsigned &v: face) {
+                if (v == c.b) {
+                    v = c.a;
+                }
+            }
+            vertexFaces[c.a].push_back(f);
+        }
+        vertexFaces[c.b].clear();
+        std::erase_if(vertexFaces[c.a], [&](unsigned f) { return !faceAlive[f]; });
+
+        // Only the edges around the merged vertex change cost; the version bump
+        // above made their old entries stale
+        for (unsigned n: neighboursOf(c.a)) {
+            pushEdge(c.a, n);
+        }
+    }
+    error = std::sqrt(maxCost);
+
+    // Compact the surviving vertices and triangles
+    TriangleMesh result;
+    std::vector<unsigned> remap(vertexCount, 0);
+    unsigned next = 0;
+    for (std::size_t v = 0; v < vertexCount; ++v) {
+        if (vertexAlive[v] && !vertexFaces[v].empty()) {
+            remap[v] = next++;
+            result.vertices.insert(result.vertices.end(), {static_cast<float>(positions[v].x),
+                                                           static_cast<float>(positions[v].y),
+                                                           static_cast<float>(positions[v].z)});
+        }
+    }
+    for (std::size_t f = 0; f < faceCount; ++f) {
+        if (faceAlive[f]) {
+            for (unsigned v: faces[f]) {
+                result.indices.push_back(remap[v]);
+            }
+        }
+    }
+    return result;
+}
@@ -0,0 +1,51 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <cstddef>
+#include <vector>
+#include "vector3d.h"
+
+/**
+ * @brief Indexed triangle mesh in the layout of Embree's triangle buffers
+ */
+struct TriangleMesh {
+    std::vector<float> vertices;    ///< x, y, z per vertex (RTC_FORMAT_FLOAT3)
+    std::vector<unsigned> indices;  ///< Three vertex indices per triangle (RTC_FORMAT_UINT3)
+
+    std::size_t vertexCount() const { return vertices.size() / 3; }
+
+    std::size_t triangleCount() const { return indices.size() / 3; }
+
+    /// Bytes of the vertex and index buffers
+    std::size_t bufferBytes() const { return vertices.size() * sizeof(float) + indices.size() * sizeof(unsigned); }
+};
+
+/**
+ * @brief Unit sphere from a subdivided icosahedron
+ * @param subdivisions Each level splits every triangle into four: 20 * 4^n triangles
+ */
+TriangleMesh makeIcosphere(int subdivisions);
+
+/**
+ * @brief Copy of a mesh scaled by scale and moved by offset
+ */
+TriangleMesh transformMesh(const TriangleMesh &mesh, double scale, const Vector3D &offset);
+
+/**
+ * @brief Simplify a mesh by quadric error edge collapses (Garland & Heckbert 1997)
+ *
+ * Each vertex carries the sum of the plane quadrics of its triangles. The
+ * edge whose collapse to the quadric-optimal point adds the least squared
+ * distance to those planes is collapsed first, until targetTriangles
+ * remain or no collapse is left that keeps every triangle's orientation.
+ * Open boundaries get no extra constraint, so the mesh should be closed.
+ *
+ * @param mesh Input mesh with shared vertices
+ * @param targetTriangles Triangle count to reduce to
+ * @param error Output: square root of the largest collapse cost, an estimate
+ *              of the largest distance between the input and the result
+ * @return Simplified mesh
+ */
+TriangleMesh simplifyMesh(const TriangleMesh &mesh, std::size_t targetTriangles, double &error);
+
+#endif // MESH_H
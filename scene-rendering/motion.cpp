@@ -0,0 +1,51 @@
+#include "motion.h"
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+namespace {
+
+constexpr double kDegreesPerStep = 15.0; // Chord error below 1% of the radius
+
+} // namespace
+
+unsigned motionTimeSteps(const ObjectMotion &motion) {
+    if (!motion.moving()) {
+        return 1;
+    }
+    if (motion.timeSteps >= 2) {
+        return static_cast<unsigned>(motion.timeSteps);
+    }
+    const double segments = std::ceil(std::abs(motion.spinDegrees) / kDegreesPerStep);
+    return static_cast<unsigned>(std::max(1.0, segments)) + 1;
+}
+
+void setMotionVertices(RTCGeometry geometry, const float *vertices, unsigned count, const Vector3D &pivot,
+                       const ObjectMotion &motion) {
+    const unsigned steps = motionTimeSteps(motion);
+    if (steps == 1) {
+        rtcSetSharedGeometryBuffer(geometry, RTC_BUFFER_TYPE_VERTEX, 0, RTC_FORMAT_FLOAT3, vertices, 0,
+                                   3 * sizeof(float), count);
+        return;
+    }
+
+    rtcSetGeometryTimeStepCount(geometry, steps);
+    for (unsigned s = 0; s < steps; ++s) {
+        const double time = static_cast<double>(s) / (steps - 1);
+        const double angle = motion.spinDegrees * time * std::numbers::pi / 180.0;
+        const double c = std::cos(angle);
+        const double sn = std::sin(angle);
+        const Vector3D offset = motion.translation * time;
+
+        // Transformed copies, in buffers allocated and owned by Embree
+        auto *out = static_cast<float *>(rtcSetNewGeometryBuffer(geometry, RTC_BUFFER_TYPE_VERTEX, s,
+                                                                 RTC_FORMAT_FLOAT3, 3 * sizeof(float), count));
+        for (unsigned v = 0; v < count; ++v) {
+            const double x = vertices[3 * v] - pivot.x;
+            const double z = vertices[3 * v + 2] - pivot.z;
+            out[3 * v] = static_cast<float>(pivot.x + c * x + sn * z + offset.x);
+            out[3 * v + 1] = static_cast<float>(vertices[3 * v + 1] + offset.y);
+            out[3 * v + 2] = static_cast<float>(pivot.z - sn * x + c * z + offset.z);
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef MOTION_H
+#define MOTION_H
+
+#include <embree4/rtcore.h>
+#include "vector3d.h"
+
+/**
+ * @brief Rigid motion of an object over the shutter interval [0, 1]
+ *
+ * The object turns by spinDegrees about the vertical axis through its pivot
+ * and moves by translation, both at constant speed.
+ */
+struct ObjectMotion {
+    Vector3D translation;       ///< Offset at shutter close
+    double spinDegrees = 0.0;   ///< Rotation about the vertical axis at shutter close
+    int timeSteps = 0;          ///< Vertex buffers over the interval, 0 = choose from the motion
+
+    /// Whether the object moves at all
+    bool moving() const {
+        return translation.norm() > 0.0 || spinDegrees != 0.0;
+    }
+};
+
+/**
+ * @brief Number of time steps used for a motion
+ *
+ * Embree interpolates vertices linearly between time steps, which is exact
+ * for a translation. A rotation needs enough segments for the chords to
+ * follow the arc: one per 15 degrees.
+ */
+unsigned motionTimeSteps(const ObjectMotion &motion);
+
+/**
+ * @brief Set the vertex buffers of a triangle geometry that moves
+ *
+ * Static objects get the vertices as one shared buffer, as before. Moving
+ * ones get motionTimeSteps() buffers (rtcSetGeometryTimeStepCount), step s
+ * holding the vertices transformed to time s / (steps - 1). Embree then
+ * places the object by the time of each ray.
+ *
+ * @param geometry Triangle geometry, not yet committed
+ * @param vertices x, y, z per vertex; must outlive the geometry when static
+ * @param count Number of vertices
+ * @param pivot Point the rotation turns about
+ * @param motion Motion over the shutter interval
+ */
+void setMotionVertices(RTCGeometry geometry, const float *vertices, unsigned count, const Vector3D &pivot,
+                       const ObjectMotion &motion);
+
+#endif // MOTION_H
@@ -0,0 +1,58 @@
+#ifndef OPTICS_H
+#define OPTICS_H
+
+#include <algorithm>
+#include <cmath>
+#include "vector3d.h"
+
+/**
+ * @brief Mirror a direction about a unit normal
+ */
+inline Vector3D reflectDirection(const Vector3D &direction, const Vector3D &normal) {
+    return (direction - normal * (2.0 * normal.dot(direction))).normalized();
+}
+
+/**
+ * @brief Refract a unit direction through a surface (Snell's law)
+ *
+ * @param direction Incoming unit direction
+ * @param normal Unit normal facing against direction
+ * @param eta Ratio of refractive indices, incident side / transmitted side
+ * @param refracted Receives the transmitted direction
+ * @return false on total internal reflection
+ */
+inline bool refractDirection(const Vector3D &direction, const Vector3D &normal, double eta, Vector3D &refracted) {
+    const double cosI = -normal.dot(direction);
+    const double sin2T = eta * eta * std::max(0.0, 1.0 - cosI * cosI);
+    if (sin2T > 1.0) {
+        return false;
+    }
+    refracted = (direction * eta + normal * (eta * cosI - std::sqrt(1.0 - sin2T))).normalized();
+    return true;
+}
+
+/**
+ * @brief Schlick's approximation of the Fresnel reflectance of a dielectric
+ *
+ * Uses the cosine on the optically thinner side, so the approximation also
+ * holds when leaving the denser medium; returns 1 on total internal
+ * reflection.
+ *
+ * @param cosI Cosine between the incoming direction and the normal
+ * @param eta Ratio of refractive indices, incident side / transmitted side
+ */
+inline double schlickFresnel(double cosI, double eta) {
+    const double r0 = (eta - 1.0) * (eta - 1.0) / ((eta + 1.0) * (eta + 1.0));
+    double cosine = cosI;
+    if (eta > 1.0) {
+        const double sin2T = eta * eta * std::max(0.0, 1.0 - cosI * cosI);
+        if (sin2T > 1.0) {
+            return 1.0;
+        }
+        cosine = std::sqrt(1.0 - sin2T);
+    }
+    const double m = 1.0 - cosine;
+    return r0 + (1.0 - r0) * m * m * m * m * m;
+}
+
+#endif // OPTICS_H
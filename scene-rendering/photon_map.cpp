@@ -0,0 +1,315 @@
+#include "photon_map.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <numbers>
+#include <thread>
+#include "light.h"
+#include "material.h"
+#include "renderer.h"
+#include "sampling.h"
+#include "optics.h"
+
+namespace {
+
+constexpr int kMaxGather = 256;
+constexpr std::size_t kChunk = 4096;   // Photons per work item
+constexpr double kConeFilter = 1.1;    // Jensen's cone filter constant
+
+/**
+ * Size of the left subtree of a left-balanced (complete) binary tree of n
+ * nodes: all levels full except the last, which is filled from the left.
+ */
+std::size_t leftSubtreeSize(std::size_t n) {
+    if (n <= 1) {
+        return 0;
+    }
+    std::size_t levels = 0;
+    while ((std::size_t{2} << levels) - 1 <= n) {
+        ++levels;
+    }
+    const std::size_t full = (std::size_t{1} << levels) - 1; // Nodes in the complete levels
+    const std::size_t last = n - full;                        // Nodes on the partial level
+    const std::size_t halfLast = levels > 0 ? std::size_t{1} << (levels - 1) : 0;
+    return (full - 1) / 2 + std::min(last, halfLast);
+}
+
+struct Neighbour {
+    float distance2;
+    std::uint32_t index;
+
+    bool operator<(const Neighbour &other) const { return distance2 < other.distance2; }
+};
+
+/// State of one k-nearest-neighbour query; the neighbours form a max-heap
+struct Gather {
+    float point[3];
+    int k;
+    int found = 0;
+    float maxDistance2;
+    Neighbour heap[kMaxGather];
+};
+
+void locate(const std::vector<Photon> &tree, std::size_t index, Gather &g) {
+    const Photon &photon = tree[index];
+    const std::size_t left = 2 * index + 1;
+    if (left < tree.size()) {
+        const float delta = g.point[photon.axis] - photon.position[photon.axis];
+        const std::size_t nearSide = delta < 0.0f ? left : left + 1;
+        const std::size_t farSide = delta < 0.0f ? left + 1 : left;
+        if (nearSide < tree.size()) {
+            locate(tree, nearSide, g);
+        }
+        if (farSide < tree.size() && delta * delta < g.maxDistance2) {
+            locate(tree, farSide, g);
+        }
+    }
+
+    const float dx = g.point[0] - photon.position[0];
+    const float dy = g.point[1] - photon.position[1];
+    const float dz = g.point[2] - photon.position[2];
+    const float d2 = dx * dx + dy * dy + dz * dz;
+    if (d2 >= g.maxDistance2) {
+        return;
+    }
+    if (g.found < g.k) {
+        g.heap[g.found++] = {d2, static_cast<std::uint32_t>(index)};
+        std::push_heap(g.heap, g.heap + g.found);
+        if (g.found == g.k) {
+            g.maxDistance2 = g.heap[0].distance2;
+        }
+    } else {
+        std::pop_heap(g.heap, g.heap + g.k);
+        g.heap[g.k - 1] = {d2, static_cast<std::uint32_t>(index)};
+        std::push_heap(g.heap, g.heap + g.k);
+        g.maxDistance2 = g.heap[0].distance2;
+    }
+}
+
+/**
+ * Follow one photon from a point light through mirror bounces, at most
+ * context.maxDepth of them like the camera paths in shade().
+ */
+void tracePhoton(const RenderContext &context, const Vector3D &origin, const Color &flux, Random &random,
+                 std::vector<Photon> &out) {
+    constexpr double pi = std::numbers::pi;
+    const double z = 1.0 - 2.0 * random.nextDouble();
+    const double r = std::sqrt(std::max(0.0, 1.0 - z * z));
+    const double phi = 2.0 * pi * random.nextDouble();
+    Vector3D direction(r * std::cos(phi), r * std::sin(phi), z);
+    Vector3D position = origin;
+    double pathLength = 0.0;
+    bool specular = false;
+
+    bool inside = false;
+    // Moving geometry: the photon map averages the caustics over the shutter interval
+    const float time = context.motionBlur ? static_cast<float>(random.nextDouble()) : 0.0f;
+
+    for (int bounce = 0; bounce < context.maxDepth; ++bounce) {
+        RTCRayHit hit;
+        if (!traceRay(context.scene, position, direction, hit, time)) {
+            return;
+        }
+        RTCGeometry geometry = rtcGetGeometry(context.scene, hit.hit.geomID);
+        const Material *material = static_cast<Material *>(rtcGetGeometryUserData(geometry));
+        position = Vector3D(hit.ray.org_x + hit.ray.tfar * hit.ray.dir_x,
+                            hit.ray.org_y + hit.ray.tfar * hit.ray.dir_y,
+                            hit.ray.org_z + hit.ray.tfar * hit.ray.dir_z);
+        pathLength += hit.ray.tfar;
+
+        // Irradiance counts every arriving photon, whatever happens to it next
+        if (specular && material->diffuse > 0.0) {
+            Photon photon{};
+            photon.position[0] = static_cast<float>(position.x);
+            photon.position[1] = static_cast<float>(position.y);
+            photon.position[2] = static_cast<float>(position.z);
+            // Undo the 1/r^2 spreading: the renderer's point lights do not fall off with distance
+            const double spread = pathLength * pathLength;
+            photon.power[0] = static_cast<float>(flux.r * spread);
+            photon.power[1] = static_cast<float>(flux.g * spread);
+            photon.power[2] = static_cast<float>(flux.b * spread);
+            setPhotonDirection(photon, direction);
+            out.push_back(photon);
+        }
+
+        // Russian roulette over the specular events of shade(), which keep the flux when survived
+        const Vector3D normal = Vector3D(hit.hit.Ng_x, hit.hit.Ng_y, hit.hit.Ng_z).normalized();
+        const Vector3D facing = normal.dot(direction) > 0.0 ? -normal : normal;
+        const double mirror = material->reflectivity * (1.0 - material->transparency);
+        const double u = random.nextDouble();
+        if (u < mirror) {
+            direction = reflectDirection(direction, facing);
+        } else if (u < mirror + material->transparency) {
+            const double eta = inside ? material->ior : 1.0 / material->ior;
+            Vector3D refracted;
+            if (random.nextDouble() >= schlickFresnel(-facing.dot(direction), eta) &&
+                refractDirection(direction, facing, eta, refracted)) {
+                direction = refracted;
+                inside = !inside;
+            } else {
+                direction = reflectDirection(direction, facing);
+            }
+        } else {
+            return;
+        }
+        specular = true;
+    }
+}
+
+} // namespace
+
+void setPhotonDirection(Photon &photon, const Vector3D &direction) {
+    constexpr double pi = std::numbers::pi;
+    const double theta = std::acos(std::clamp(direction.z, -1.0, 1.0));
+    const double phi = std::atan2(direction.y, direction.x) + pi;
+    photon.theta = static_cast<std::uint8_t>(std::min(255.0, theta * (256.0 / pi)));
+    photon.phi = static_cast<std::uint8_t>(std::min(255.0, phi * (256.0 / (2.0 * pi))));
+}
+
+/**
+ * Decoded through sine/cosine tables of the 256 angle steps.
+ */
+Vector3D photonDirection(const Photon &photon) {
+    struct Tables {
+        double sinTheta[256], cosTheta[256], sinPhi[256], cosPhi[256];
+
+        Tables() {
+            constexpr double pi = std::numbers::pi;
+            for (int i = 0; i < 256; ++i) {
+                const double theta = (i + 0.5) * (pi / 256.0);
+                const double phi = (i + 0.5) * (2.0 * pi / 256.0) - pi;
+                sinTheta[i] = std::sin(theta);
+                cosTheta[i] = std::cos(theta);
+                sinPhi[i] = std::sin(phi);
+                cosPhi[i] = std::cos(phi);
+            }
+        }
+    };
+    static const Tables tables;
+    return Vector3D(tables.sinTheta[photon.theta] * tables.cosPhi[photon.phi],
+                    tables.sinTheta[photon.theta] * tables.sinPhi[photon.phi], tables.cosTheta[photon.theta]);
+}
+
+void PhotonMap::build(std::vector<Photon> photons) {
+    tree.assign(photons.size(), Photon{});
+    if (!photons.empty()) {
+        buildNode(photons, 0, photons.size(), 0);
+    }
+}
+
+/**
+ * Place the left-balanced median of [begin, end) along the axis of largest
+ * extent at heap slot index, then build both halves.
+ */
+void PhotonMap::buildNode(std::vector<Photon> &photons, std::size_t begin, std::size_t end, std::size_t index) {
+    float lower[3] = {photons[begin].position[0], photons[begin].position[1], photons[begin].position[2]};
+    float upper[3] = {lower[0], lower[1], lower[2]};
+    for (std::size_t i = begin + 1; i < end; ++i) {
+        for (int a = 0; a < 3; ++a) {
+            lower[a] = std::min(lower[a], photons[i].position[a]);
+            upper[a] = std::max(upper[a], photons[i].position[a]);
+        }
+    }
+    int axis = 0;
+    for (int a = 1; a < 3; ++a) {
+        if (upper[a] - lower[a] > upper[axis] - lower[axis]) {
+            axis = a;
+        }
+    }
+
+    const std::size_t median = begin + leftSubtreeSize(end - begin);
+    std::nth_element(photons.begin() + begin, photons.begin() + median, photons.begin() + end,
+                     [axis](const Photon &a, const Photon &b) { return a.position[axis] < b.position[axis]; });
+    tree[index] = photons[median];
+    tree[index].axis = static_cast<std::uint8_t>(axis);
+
+    if (median > begin) {
+        buildNode(photons, begin, median, 2 * index + 1);
+    }
+    if (end > median + 1) {
+        buildNode(photons, median + 1, end, 2 * index + 2);
+    }
+}
+
+Color PhotonMap::irradiance(const Vector3D &point, const Vector3D &normal, int k, double maxRadius) const {
+    if (tree.empty()) {
+        return Color(0, 0, 0);
+    }
+    Gather g;
+    g.point[0] = static_cast<float>(point.x);
+    g.point[1] = static_cast<float>(point.y);
+    g.point[2] = static_cast<float>(point.z);
+    g.k = std::clamp(k, 1, kMaxGather);
+    g.maxDistance2 = static_cast<float>(maxRadius * maxRadius);
+    locate(tree, 0, g);
+    if (g.found == 0) {
+        return Color(0, 0, 0);
+    }
+
+    // With fewer than k photons the whole search radius was covered
+    const double radius = g.found == g.k ? std::sqrt(static_cast<double>(g.maxDistance2)) : maxRadius;
+    double sum[3] = {0.0, 0.0, 0.0};
+    for (int n = 0; n < g.found; ++n) {
+        const Photon &photon = tree[g.heap[n].index];
+        if (photonDirection(photon).dot(normal) >= 0.0) {
+            continue; // Arrived at the back of the surface
+        }
+        const double w = 1.0 - std::sqrt(static_cast<double>(g.heap[n].distance2)) / (kConeFilter * radius);
+        sum[0] += photon.power[0] * w;
+        sum[1] += photon.power[1] * w;
+        sum[2] += photon.power[2] * w;
+    }
+    const double area = (1.0 - 2.0 / (3.0 * kConeFilter)) * std::numbers::pi * radius * radius;
+    return Color(sum[0] / area, sum[1] / area, sum[2] / area);
+}
+
+/**
+ * Photons are split into fixed chunks handed out through an atomic counter;
+ * every photon is seeded by its global index and chunks are concatenated in
+ * order, so the map does not depend on the thread count.
+ */
+std::vector<Photon> traceCausticPhotons(const RenderContext &context, std::size_t count, unsigned threads) {
+    std::vector<const PointLight *> emitters;
+    for (const auto *light: *context.lights) {
+        if (const auto *point = dynamic_cast<const PointLight *>(light)) {
+            emitters.push_back(point);
+        }
+    }
+    if (emitters.empty() || count == 0) {
+        return {};
+    }
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    const std::size_t perLight = std::max<std::size_t>(1, count / emitters.size());
+    const std::size_t total = perLight * emitters.size();
+    const std::size_t chunks = (total + kChunk - 1) / kChunk;
+    std::vector<std::vector<Photon>> results(chunks);
+    std::atomic<std::size_t> next{0};
+
+    auto worker = [&] {
+        for (std::size_t c = next.fetch_add(1); c < chunks; c = next.fetch_add(1)) {
+            const std::size_t end = std::min(total, (c + 1) * kChunk);
+            for (std::size_t p = c * kChunk; p < end; ++p) {
+                const PointLight *light = emitters[p / perLight];
+                const Color flux = light->intensity * (4.0 * std::numbers::pi / static_cast<double>(perLight));
+                Random random(hashSeed(p, 0x70686f746f6e)); // "photon"
+                tracePhoton(context, light->position, flux, random, results[c]);
+            }
+        }
+    };
+    {
+        std::vector<std::jthread> pool;
+        for (unsigned t = 1; t < threads; ++t) {
+            pool.emplace_back(worker);
+        }
+        worker();
+    }
+
+    std::vector<Photon> photons;
+    for (auto &chunk: results) {
+        photons.insert(photons.end(), chunk.begin(), chunk.end());
+    }
+    return photons;
+}
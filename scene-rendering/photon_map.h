@@ -0,0 +1,102 @@
+#ifndef PHOTON_MAP_H
+#define PHOTON_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "vector3d.h"
+#include "color.h"
+
+struct RenderContext;
+
+/**
+ * @brief Photon stored on a diffuse surface (28 bytes)
+ *
+ * Single precision position and power, incoming direction quantised to two
+ * bytes as in Jensen's photon maps, and the kd-tree split axis.
+ */
+struct Photon {
+    float position[3];   ///< Hit point
+    float power[3];      ///< Flux carried, r g b
+    std::uint8_t theta;  ///< Incoming direction, polar angle in 256 steps
+    std::uint8_t phi;    ///< Incoming direction, azimuth in 256 steps
+    std::uint8_t axis;   ///< Split axis in the kd-tree (set by PhotonMap)
+};
+
+/**
+ * @brief Quantise a unit direction into a photon
+ */
+void setPhotonDirection(Photon &photon, const Vector3D &direction);
+
+/**
+ * @brief Unit direction stored in a photon
+ */
+Vector3D photonDirection(const Photon &photon);
+
+/**
+ * @brief Left-balanced kd-tree of photons
+ *
+ * The tree is stored as a heap in one array (children of node i are 2i + 1
+ * and 2i + 2), so it needs no pointers and the top levels share cache lines.
+ * It is immutable after build(), so any number of threads may gather from
+ * it concurrently.
+ */
+class PhotonMap {
+public:
+    /**
+     * @brief Build the tree, taking ownership of the photons
+     */
+    void build(std::vector<Photon> photons);
+
+    /**
+     * @brief Irradiance estimate from the k nearest photons
+     *
+     * Cone-filtered density estimate (filter constant 1.1) over at most k
+     * photons within maxRadius that arrive at the front of the surface.
+     *
+     * @param point Shading point
+     * @param normal Unit normal facing the viewer
+     * @param k Number of photons to gather (at most 256)
+     * @param maxRadius Gather radius limit
+     * @return Irradiance, zero if no photon is found
+     */
+    Color irradiance(const Vector3D &point, const Vector3D &normal, int k, double maxRadius) const;
+
+    /// Number of stored photons
+    std::size_t size() const { return tree.size(); }
+
+    /// Whether the map holds no photons
+    bool empty() const { return tree.empty(); }
+
+private:
+    void buildNode(std::vector<Photon> &photons, std::size_t begin, std::size_t end, std::size_t index);
+
+    std::vector<Photon> tree;
+};
+
+/**
+ * @brief Trace caustic photons from the point lights of a scene
+ *
+ * Each point light emits its share of count photons uniformly over the
+ * sphere with flux 4 pi I / count. Like the direct lighting of the
+ * renderer's point lights (attenuation 1), caustics do not fall off with
+ * distance: a stored photon's flux is scaled by its squared path length, so
+ * a perfect mirror reproduces the irradiance I cos(theta) of the mirrored
+ * light. Photons are reflected by
+ * mirror surfaces with probability equal to their reflectivity and
+ * reflected or refracted by dielectrics by their transparency and Fresnel
+ * reflectance (Russian roulette), and stored at every diffuse surface they
+ * reach after at least one such specular bounce, i.e. only light paths
+ * L S+ D are kept. A photon is followed for at most context.maxDepth hits,
+ * the bounce limit of the camera paths.
+ * Directional lights emit no photons. Photons are traced in parallel and
+ * returned in emission order, independent of the thread count.
+ *
+ * @param context Scene, lights and bounce limit
+ * @param count Photons to emit over all point lights
+ * @param threads Worker threads, 0 = hardware concurrency
+ * @return Stored caustic photons
+ */
+std::vector<Photon> traceCausticPhotons(const RenderContext &context, std::size_t count, unsigned threads);
+
+#endif // PHOTON_MAP_H
@@ -0,0 +1,361 @@
+#include "procedural.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace {
+
+constexpr int kMaxSdfSteps = 256;
+constexpr double kSdfEpsilon = 1e-4;    // Hit threshold, relative to the ray distance
+constexpr double kSdfEscape = 1e-3;     // Distance a ray needs to leave the surface it starts on
+
+RTCBounds makeBounds(const Vector3D &lo, const Vector3D &hi) {
+    return {static_cast<float>(lo.x), static_cast<float>(lo.y), static_cast<float>(lo.z), 0.0f,
+            static_cast<float>(hi.x), static_cast<float>(hi.y), static_cast<float>(hi.z), 0.0f};
+}
+
+// Ray interval inside an axis-aligned box, clipped to [t0, t1]
+bool slab(const Vector3D &lo, const Vector3D &hi, const Vector3D &origin, const Vector3D &inverse, double &t0,
+          double &t1) {
+    const double lower[3] = {lo.x, lo.y, lo.z};
+    const double upper[3] = {hi.x, hi.y, hi.z};
+    const double o[3] = {origin.x, origin.y, origin.z};
+    const double inv[3] = {inverse.x, inverse.y, inverse.z};
+    for (int a = 0; a < 3; ++a) {
+        double near = (lower[a] - o[a]) * inv[a];
+        double far = (upper[a] - o[a]) * inv[a];
+        if (near > far) {
+            std::swap(near, far);
+        }
+        // NaN from 0 * inf (origin on a slab plane, direction parallel) keeps the old bound
+        t0 = near > t0 ? near : t0;
+        t1 = far < t1 ? far : t1;
+    }
+    return t0 <= t1;
+}
+
+// Möller-Trumbore, two-sided
+bool intersectTriangle(const Vector3D &p0, const Vector3D &p1, const Vector3D &p2, const Vector3D &origin,
+                       const Vector3D &direction, double tnear, double tfar, double &t) {
+    const Vector3D e1 = p1 - p0;
+    const Vector3D e2 = p2 - p0;
+    const Vector3D p = direction.cross(e2);
+    const double det = e1.dot(p);
+    if (std::abs(det) < 1e-14) {
+        return false;
+    }
+    const double inv = 1.0 / det;
+    const Vector3D s = origin - p0;
+    const double u = s.dot(p) * inv;
+    if (u < 0.0 || u > 1.0) {
+        return false;
+    }
+    const Vector3D q = s.cross(e1);
+    const double v = direction.dot(q) * inv;
+    if (v < 0.0 || u + v > 1.0) {
+        return false;
+    }
+    const double hit = e2.dot(q) * inv;
+    if (hit <= tnear || hit >= tfar) {
+        return false;
+    }
+    t = hit;
+    return true;
+}
+
+void proceduralBounds(const RTCBoundsFunctionArguments *args) {
+    const auto *procedural = static_cast<const ProceduralGeometry *>(args->geometryUserPtr);
+    *args->bounds_o = procedural->shape->bounds(args->primID);
+}
+
+void proceduralIntersect(const RTCIntersectFunctionNArguments *args) {
+    const auto *procedural = static_cast<const ProceduralGeometry *>(args->geometryUserPtr);
+    const unsigned N = args->N;
+    RTCRayN *ray = RTCRayHitN_RayN(args->rayhit, N);
+    RTCHitN *hit = RTCRayHitN_HitN(args->rayhit, N);
+    for (unsigned i = 0; i < N; ++i) {
+        if (args->valid[i] == 0) {
+            continue;
+        }
+        const Vector3D origin(RTCRayN_org_x(ray, N, i), RTCRayN_org_y(ray, N, i), RTCRayN_org_z(ray, N, i));
+        const Vector3D direction(RTCRayN_dir_x(ray, N, i), RTCRayN_dir_y(ray, N, i), RTCRayN_dir_z(ray, N, i));
+        double t = RTCRayN_tfar(ray, N, i);
+        Vector3D normal;
+        if (!procedural->shape->intersect(args->primID, origin, direction, RTCRayN_tnear(ray, N, i), t, normal,
+                                          false)) {
+            continue;
+        }
+        RTCRayN_tfar(ray, N, i) = static_cast<float>(t);
+        RTCHitN_Ng_x(hit, N, i) = static_cast<float>(normal.x);
+        RTCHitN_Ng_y(hit, N, i) = static_cast<float>(normal.y);
+        RTCHitN_Ng_z(hit, N, i) = static_cast<float>(normal.z);
+        RTCHitN_u(hit, N, i) = 0.0f;
+        RTCHitN_v(hit, N, i) = 0.0f;
+        RTCHitN_primID(hit, N, i) = args->primID;
+        RTCHitN_geomID(hit, N, i) = args->geomID;
+        RTCHitN_instID(hit, N, i, 0) = args->context->instID[0];
+    }
+}
+
+void proceduralOccluded(const RTCOccludedFunctionNArguments *args) {
+    const auto *procedural = static_cast<const ProceduralGeometry *>(args->geometryUserPtr);
+    const unsigned N = args->N;
+    RTCRayN *ray = args->ray;
+    for (unsigned i = 0; i < N; ++i) {
+        if (args->valid[i] == 0) {
+            continue;
+        }
+        const Vector3D origin(RTCRayN_org_x(ray, N, i), RTCRayN_org_y(ray, N, i), RTCRayN_org_z(ray, N, i));
+        const Vector3D direction(RTCRayN_dir_x(ray, N, i), RTCRayN_dir_y(ray, N, i), RTCRayN_dir_z(ray, N, i));
+        double t = RTCRayN_tfar(ray, N, i);
+        Vector3D normal;
+        if (procedural->shape->intersect(args->primID, origin, direction, RTCRayN_tnear(ray, N, i), t, normal,
+                                         true)) {
+            RTCRayN_tfar(ray, N, i) = -std::numeric_limits<float>::infinity();
+        }
+    }
+}
+
+} // namespace
+
+Heightfield::Heightfield(std::vector<float> heights, int samplesX, int samplesZ, const Vector3D &corner,
+                         double sizeX, double sizeZ, int tileLevel)
+    : heights_(std::move(heights)), samplesX_(samplesX), samplesZ_(samplesZ), corner_(corner),
+      cellX_(sizeX / (samplesX - 1)), cellZ_(sizeZ / (samplesZ - 1)), tileLevel_(tileLevel) {
+    // Level 0 is the cells themselves, read from the heights; each level above
+    // holds the range of 2 x 2 blocks of the level below
+    levelWidth_.push_back(samplesX_ - 1);
+    levelDepth_.push_back(samplesZ_ - 1);
+    levels_.emplace_back();
+    for (int l = 1; l <= tileLevel_; ++l) {
+        const int w = (levelWidth_[l - 1] + 1) / 2;
+        const int d = (levelDepth_[l - 1] + 1) / 2;
+        std::vector<HeightRange> level(static_cast<std::size_t>(w) * d,
+                                       {std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest()});
+        for (int z = 0; z < levelDepth_[l - 1]; ++z) {
+            for (int x = 0; x < levelWidth_[l - 1]; ++x) {
+                const HeightRange child = range(l - 1, x, z);
+                HeightRange &parent = level[static_cast<std::size_t>(z / 2) * w + x / 2];
+                parent.lo = std::min(parent.lo, child.lo);
+                parent.hi = std::max(parent.hi, child.hi);
+            }
+        }
+        levels_.push_back(std::move(level));
+        levelWidth_.push_back(w);
+        levelDepth_.push_back(d);
+    }
+}
+
+unsigned Heightfield::primitiveCount() const {
+    return static_cast<unsigned>(levelWidth_[tileLevel_] * levelDepth_[tileLevel_]);
+}
+
+Heightfield::HeightRange Heightfield::range(int level, int x, int z) const {
+    if (level == 0) {
+        const float a = height(x, z), b = height(x + 1, z), c = height(x, z + 1), d = height(x + 1, z + 1);
+        return {std::min({a, b, c, d}), std::max({a, b, c, d})};
+    }
+    return levels_[level][static_cast<std::size_t>(z) * levelWidth_[level] + x];
+}
+
+RTCBounds Heightfield::bounds(unsigned primID) const {
+    const int x = static_cast<int>(primID) % levelWidth_[tileLevel_];
+    const int z = static_cast<int>(primID) / levelWidth_[tileLevel_];
+    const int span = 1 << tileLevel_;
+    const HeightRange tile = range(tileLevel_, x, z);
+    return makeBounds(
+        Vector3D(corner_.x + x * span * cellX_, corner_.y + tile.lo, corner_.z + z * span * cellZ_),
+        Vector3D(corner_.x + std::min((x + 1) * span, samplesX_ - 1) * cellX_, corner_.y + tile.hi,
+                 corner_.z + std::min((z + 1) * span, samplesZ_ - 1) * cellZ_));
+}
+
+bool Heightfield::nodeInterval(int level, int x, int z, const Vector3D &origin, const Vector3D &inverse,
+                               double tnear, double tfar, double &t0) const {
+    const int span = 1 << level;
+    const HeightRange block = range(level, x, z);
+    const Vector3D lo(corner_.x + x * span * cellX_, corner_.y + block.lo, corner_.z + z * span * cellZ_);
+    const Vector3D hi(corner_.x + std::min((x + 1) * span, samplesX_ - 1) * cellX_, corner_.y + block.hi,
+                      corner_.z + std::min((z + 1) * span, samplesZ_ - 1) * cellZ_);
+    t0 = tnear;
+    double t1 = tfar;
+    return slab(lo, hi, origin, inverse, t0, t1);
+}
+
+bool Heightfield::intersectCell(int x, int z, const Vector3D &origin, const Vector3D &direction, double tnear,
+                                double &t, Vector3D &normal) const {
+    const double x0 = corner_.x + x * cellX_, x1 = x0 + cellX_;
+    const double z0 = corner_.z + z * cellZ_, z1 = z0 + cellZ_;
+    const Vector3D p00(x0, corner_.y + height(x, z), z0);
+    const Vector3D p10(x1, corner_.y + height(x + 1, z), z0);
+    const Vector3D p01(x0, corner_.y + height(x, z + 1), z1);
+    const Vector3D p11(x1, corner_.y + height(x + 1, z + 1), z1);
+    // Both triangles are wound so that cross(p1 - p0, p2 - p0) points up
+    bool found = false;
+    double hit = t;
+    if (intersectTriangle(p00, p01, p11, origin, direction, tnear, hit, hit)) {
+        normal = (p01 - p00).cross(p11 - p00);
+        found = true;
+    }
+    if (intersectTriangle(p00, p11, p10, origin, direction, tnear, hit, hit)) {
+        normal = (p11 - p00).cross(p10 - p00);
+        found = true;
+    }
+    t = hit;
+    return found;
+}
+
+bool Heightfield::intersect(unsigned primID, const Vector3D &origin, const Vector3D &direction, double tnear,
+                            double &t, Vector3D &normal, bool any) const {
+    struct Node {
+        int level, x, z;
+        double entry;
+    };
+    const Vector3D inverse(1.0 / direction.x, 1.0 / direction.y, 1.0 / direction.z);
+    std::array<Node, 64> stack;
+    int top = 0;
+    double entry = 0.0;
+    const int tileX = static_cast<int>(primID) % levelWidth_[tileLevel_];
+    const int tileZ = static_cast<int>(primID) / levelWidth_[tileLevel_];
+    if (!nodeInterval(tileLevel_, tileX, tileZ, origin, inverse, tnear, t, entry)) {
+        return false;
+    }
+    stack[top++] = {tileLevel_, tileX, tileZ, entry};
+
+    bool found = false;
+    while (top > 0) {
+        const Node node = stack[--top];
+        if (node.entry >= t) {
+            continue; // A closer hit was found after this node was pushed
+        }
+        if (node.level == 0) {
+            if (intersectCell(node.x, node.z, origin, direction, tnear, t, normal)) {
+                found = true;
+                if (any) {
+                    return true;
+                }
+            }
+            continue;
+        }
+        // Push the children that the ray enters, farthest first, so the nearest is visited first
+        Node children[4];
+        int count = 0;
+        const int level = node.level - 1;
+        for (int dz = 0; dz < 2; ++dz) {
+            for (int dx = 0; dx < 2; ++dx) {
+                const int x = node.x * 2 + dx, z = node.z * 2 + dz;
+                if (x < levelWidth_[level] && z < levelDepth_[level] &&
+                    nodeInterval(level, x, z, origin, inverse, tnear, t, entry)) {
+                    children[count++] = {level, x, z, entry};
+                }
+            }
+        }
+        // Insertion sort by descending entry: at most four children, and std::sort on the
+        // fixed array trips -Warray-bounds
+        for (int c = 1; c < count; ++c) {
+            const Node child = children[c];
+            int k = c;
+            for (; k > 0 && children[k - 1].entry < child.entry; --k) {
+                children[k] = children[k - 1];
+            }
+            children[k] = child;
+        }
+        for (int c = 0; c < count; ++c) {
+            stack[top++] = children[c];
+        }
+    }
+    return found;
+}
+
+std::size_t Heightfield::memoryBytes() const {
+    std::size_t bytes = heights_.size() * sizeof(float);
+    for (const auto &level: levels_) {
+        bytes += level.size() * sizeof(HeightRange);
+    }
+    return bytes;
+}
+
+std::size_t Heightfield::triangleMeshBytes() const {
+    // float3 vertices and uint3 indices, two triangles per cell
+    return heights_.size() * 3 * sizeof(float) +
+           static_cast<std::size_t>(levelWidth_[0]) * levelDepth_[0] * 2 * 3 * sizeof(unsigned);
+}
+
+SignedDistanceShape::SignedDistanceShape(const Vector3D &boundsMin, const Vector3D &boundsMax)
+    : boundsMin_(boundsMin), boundsMax_(boundsMax) {
+}
+
+unsigned SignedDistanceShape::primitiveCount() const {
+    return 1;
+}
+
+RTCBounds SignedDistanceShape::bounds(unsigned) const {
+    return makeBounds(boundsMin_, boundsMax_);
+}
+
+bool SignedDistanceShape::intersect(unsigned, const Vector3D &origin, const Vector3D &direction, double tnear,
+                                    double &t, Vector3D &normal, bool) const {
+    const double length = direction.norm();
+    const Vector3D inverse(1.0 / direction.x, 1.0 / direction.y, 1.0 / direction.z);
+    double t0 = tnear, t1 = t;
+    if (!slab(boundsMin_, boundsMax_, origin, inverse, t0, t1)) {
+        return false;
+    }
+
+    // March on the side the ray heads into; a ray leaving the surface it starts on
+    // first has to get kSdfEscape away from it
+    const double start = t0;
+    const double side = distance(origin + direction * (start + kSdfEscape / length)) < 0.0 ? -1.0 : 1.0;
+    double s = t0;
+    for (int step = 0; step < kMaxSdfSteps && s <= t1; ++step) {
+        const double d = side * distance(origin + direction * s);
+        if (d < kSdfEpsilon * std::max(1.0, s * length)) {
+            if ((s - start) * length < kSdfEscape) {
+                s += kSdfEscape / length;
+                continue;
+            }
+            // Gradient by the tetrahedron technique: four evaluations
+            const Vector3D p = origin + direction * s;
+            const double h = kSdfEpsilon;
+            const double a = distance(p + Vector3D(h, -h, -h));
+            const double b = distance(p + Vector3D(-h, -h, h));
+            const double c = distance(p + Vector3D(-h, h, -h));
+            const double e = distance(p + Vector3D(h, h, h));
+            normal = Vector3D(a - b - c + e, -a - b + c + e, -a + b - c + e);
+            t = s;
+            return true;
+        }
+        s += d / length;
+    }
+    return false;
+}
+
+std::size_t SignedDistanceShape::memoryBytes() const {
+    return sizeof(*this);
+}
+
+TorusShape::TorusShape(const Vector3D &center, const Vector3D &axis, double majorRadius, double minorRadius)
+    : SignedDistanceShape(center - Vector3D(1, 1, 1) * (majorRadius + minorRadius),
+                          center + Vector3D(1, 1, 1) * (majorRadius + minorRadius)),
+      center_(center), axis_(axis.normalized()), majorRadius_(majorRadius), minorRadius_(minorRadius) {
+}
+
+double TorusShape::distance(const Vector3D &point) const {
+    const Vector3D q = point - center_;
+    const double h = q.dot(axis_);
+    const double radial = (q - axis_ * h).norm();
+    const double ring = radial - majorRadius_;
+    return std::sqrt(ring * ring + h * h) - minorRadius_;
+}
+
+RTCGeometry createProceduralGeometry(RTCDevice device, ProceduralGeometry &procedural) {
+    RTCGeometry geometry = rtcNewGeometry(device, RTC_GEOMETRY_TYPE_USER);
+    rtcSetGeometryUserPrimitiveCount(geometry, procedural.shape->primitiveCount());
+    rtcSetGeometryUserData(geometry, &procedural);
+    rtcSetGeometryBoundsFunction(geometry, proceduralBounds, &procedural);
+    rtcSetGeometryIntersectFunction(geometry, proceduralIntersect);
+    rtcSetGeometryOccludedFunction(geometry, proceduralOccluded);
+    rtcCommitGeometry(geometry);
+    return geometry;
+}
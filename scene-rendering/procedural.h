@@ -0,0 +1,178 @@
+#ifndef PROCEDURAL_H
+#define PROCEDURAL_H
+
+#include <embree4/rtcore.h>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+#include "vector3d.h"
+#include "material.h"
+
+/**
+ * @brief A surface defined by code instead of a triangle mesh
+ *
+ * The surface is split into primitives with bounding boxes. Embree builds
+ * its BVH over the boxes and calls intersect() only for the primitives a
+ * ray reaches, so the shape keeps its own compact representation.
+ */
+class ProceduralShape {
+public:
+    virtual ~ProceduralShape() = default;
+
+    /// Number of primitives Embree sees
+    virtual unsigned primitiveCount() const = 0;
+
+    /// Conservative bounding box of one primitive
+    virtual RTCBounds bounds(unsigned primID) const = 0;
+
+    /**
+     * @brief Intersect a ray with one primitive
+     * @param primID Primitive
+     * @param origin Ray origin
+     * @param direction Ray direction (need not be unit length)
+     * @param tnear Start of the ray interval
+     * @param t In: end of the interval; out: distance of the closest hit
+     * @param normal Geometric normal at the hit, pointing out of the surface
+     * @param any Accept the first hit found (occlusion rays)
+     * @return true if the primitive is hit in (tnear, t)
+     */
+    virtual bool intersect(unsigned primID, const Vector3D &origin, const Vector3D &direction, double tnear,
+                           double &t, Vector3D &normal, bool any) const = 0;
+
+    /// Memory held by the shape in bytes
+    virtual std::size_t memoryBytes() const = 0;
+};
+
+/**
+ * @brief Grid of height samples over the XZ plane
+ *
+ * Each grid cell is two triangles between its four corner samples, so the
+ * surface is identical to the triangulated mesh, without storing vertices,
+ * indices or a BVH per triangle. Embree sees tiles of 2^tileLevel x
+ * 2^tileLevel cells. Inside a tile, rays walk a min/max mip pyramid of the
+ * heights from near to far children, skipping every block whose height
+ * range the ray passes above or below.
+ */
+class Heightfield : public ProceduralShape {
+public:
+    /**
+     * @param heights samplesX * samplesZ heights, row by row along x
+     * @param samplesX Samples along x, at least 2
+     * @param samplesZ Samples along z, at least 2
+     * @param corner Position of sample (0, 0); y is added to every height
+     * @param sizeX Extent along x
+     * @param sizeZ Extent along z
+     * @param tileLevel Cells per tile side = 2^tileLevel
+     */
+    Heightfield(std::vector<float> heights, int samplesX, int samplesZ, const Vector3D &corner, double sizeX,
+                double sizeZ, int tileLevel = 4);
+
+    unsigned primitiveCount() const override;
+
+    RTCBounds bounds(unsigned primID) const override;
+
+    bool intersect(unsigned primID, const Vector3D &origin, const Vector3D &direction, double tnear, double &t,
+                   Vector3D &normal, bool any) const override;
+
+    std::size_t memoryBytes() const override;
+
+    /// Vertex and index buffer bytes of the same surface as an Embree triangle mesh
+    std::size_t triangleMeshBytes() const;
+
+private:
+    struct HeightRange {
+        float lo, hi;
+    };
+
+    float height(int x, int z) const { return heights_[static_cast<std::size_t>(z) * samplesX_ + x]; }
+
+    // Height range of block (x, z) of a level
+    HeightRange range(int level, int x, int z) const;
+
+    // Ray parameter interval of a node's box, false if the ray misses it
+    bool nodeInterval(int level, int x, int z, const Vector3D &origin, const Vector3D &inverse, double tnear,
+                      double tfar, double &t0) const;
+
+    bool intersectCell(int x, int z, const Vector3D &origin, const Vector3D &direction, double tnear, double &t,
+                       Vector3D &normal) const;
+
+    std::vector<float> heights_;
+    int samplesX_, samplesZ_;
+    Vector3D corner_;
+    double cellX_, cellZ_;
+    int tileLevel_;
+    std::vector<std::vector<HeightRange>> levels_; ///< levels_[l]: range of each 2^l x 2^l block, l >= 1
+    std::vector<int> levelWidth_, levelDepth_;      ///< Blocks per level along x and z
+};
+
+/**
+ * @brief Surface given by a signed distance function, found by sphere tracing
+ *
+ * The distance function must not overestimate the distance to the surface
+ * (Lipschitz constant at most 1); a ray then advances by the distance at
+ * its current point without ever stepping through the surface (Hart 1996).
+ * The whole shape is one primitive with the given bounds.
+ */
+class SignedDistanceShape : public ProceduralShape {
+public:
+    SignedDistanceShape(const Vector3D &boundsMin, const Vector3D &boundsMax);
+
+    /// Signed distance to the surface, negative inside
+    virtual double distance(const Vector3D &point) const = 0;
+
+    unsigned primitiveCount() const override;
+
+    RTCBounds bounds(unsigned primID) const override;
+
+    bool intersect(unsigned primID, const Vector3D &origin, const Vector3D &direction, double tnear, double &t,
+                   Vector3D &normal, bool any) const override;
+
+    std::size_t memoryBytes() const override;
+
+private:
+    Vector3D boundsMin_, boundsMax_;
+};
+
+/**
+ * @brief Torus as a signed distance function
+ */
+class TorusShape : public SignedDistanceShape {
+public:
+    /**
+     * @param center Center of the ring
+     * @param axis Axis of symmetry
+     * @param majorRadius Distance from the center to the tube center
+     * @param minorRadius Tube radius
+     */
+    TorusShape(const Vector3D &center, const Vector3D &axis, double majorRadius, double minorRadius);
+
+    double distance(const Vector3D &point) const override;
+
+private:
+    Vector3D center_, axis_;
+    double majorRadius_, minorRadius_;
+};
+
+/**
+ * @brief Geometry user data of a procedural shape
+ *
+ * shade() reads the user data of every geometry as a Material, so the
+ * material is the first member of this standard-layout struct and a pointer
+ * to it is also a valid pointer to the material.
+ */
+struct ProceduralGeometry {
+    Material material;              ///< Surface material
+    const ProceduralShape *shape;   ///< Surface
+};
+
+static_assert(std::is_standard_layout_v<ProceduralGeometry>);
+
+/**
+ * @brief Create an Embree user geometry for a procedural shape
+ *
+ * Registers the bounds, intersect and occluded callbacks and commits the
+ * geometry; the caller attaches it. procedural must outlive the geometry.
+ */
+RTCGeometry createProceduralGeometry(RTCDevice device, ProceduralGeometry &procedural);
+
+#endif // PROCEDURAL_H
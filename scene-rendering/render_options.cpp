@@ -0,0 +1,256 @@
+#include "render_options.h"
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+namespace {
+
+void printUsage(const char *program) {
+    std::cerr << "Usage: " << program << " [--size <width>x<height>] [--threads <n>]"
+              << " [--gi off|cache|brute] [--gi-accuracy <a>] [--gi-rows <n>]"
+              << " [--caustics <photons>] [--caustic-k <n>] [--caustic-radius <r>]"
+              << " [--split-throughput <t>] [--spp <n>] [--min-spp <n>] [--noise <t>]"
+              << " [--aperture <radius>] [--focus <distance>] [--motion <dx>,<dy>,<dz>]"
+              << " [--spin <degrees>] [--time-steps <n>] [--terrain <cells>] [--sdf on|off]"
+              << " [--spheres <n>] [--lod-error <pixels>] [--subdiv <pixels>] [--tess-cache <MB>]"
+              << " [--curves <file>] [--hair <n>] [--env <file.pfm>] [--env-scale <s>] [--env-samples <n>]"
+              << " [--fog <sigma>] [--fog-bank <sigma>] [--fog-grid <n>] [--fog-albedo <a>] [--fog-g <g>]"
+              << " [--fog-steps <n>] [--scene <file>] [--watch on|off] [--jobs <file>] [--tile <px>]"
+              << " [--checkpoint <file>] [--checkpoint-interval <s>] [--max-depth <n>] [--deadline <ms>]"
+              << " [--output <file.ppm>]\n";
+}
+
+// Parse a positive integer, false on garbage or overflow
+bool parsePositive(const char *text, long long limit, long long &value) {
+    char *end = nullptr;
+    value = std::strtoll(text, &end, 10);
+    return end != text && *end == '\0' && value > 0 && value <= limit;
+}
+
+// Parse a finite real number >= 0
+bool parseNonNegative(const char *text, double &value) {
+    char *end = nullptr;
+    value = std::strtod(text, &end);
+    return end != text && *end == '\0' && value >= 0.0 && value < 1e300;
+}
+
+// Parse a finite real number
+bool parseReal(const char *text, double &value) {
+    char *end = nullptr;
+    value = std::strtod(text, &end);
+    return end != text && *end == '\0' && std::isfinite(value);
+}
+
+// Parse "x,y,z"
+bool parseVector(const char *text, Vector3D &value) {
+    char *end = nullptr;
+    double xyz[3];
+    for (int k = 0; k < 3; ++k) {
+        xyz[k] = std::strtod(text, &end);
+        if (end == text || !std::isfinite(xyz[k]) || *end != (k < 2 ? ',' : '\0')) {
+            return false;
+        }
+        text = end + 1;
+    }
+    value = Vector3D(xyz[0], xyz[1], xyz[2]);
+    return true;
+}
+
+} // namespace
+
+/**
+ * Parse "--name value" pairs; every option takes exactly one value.
+ */
+bool parseRenderOptions(int argc, char *argv[], RenderOptions &options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string name = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Error: Missing value for '" << name << "'.\n";
+            printUsage(argv[0]);
+            return false;
+        }
+        const char *value = argv[++i];
+        long long number = 0;
+        bool ok = true;
+        if (name == "--size") {
+            const std::string text = value;
+            const std::size_t x = text.find('x');
+            long long w = 0, h = 0;
+            ok = x != std::string::npos && parsePositive(text.substr(0, x).c_str(), 1 << 15, w) &&
+                 parsePositive(text.substr(x + 1).c_str(), 1 << 15, h);
+            options.width = static_cast<int>(w);
+            options.height = static_cast<int>(h);
+        } else if (name == "--threads") {
+            ok = parsePositive(value, 1024, number);
+            options.threads = static_cast<unsigned>(number);
+        } else if (name == "--gi") {
+            const std::string mode = value;
+            if (mode == "off") {
+                options.gi = GiMode::Off;
+            } else if (mode == "cache") {
+                options.gi = GiMode::Cache;
+            } else if (mode == "brute") {
+                options.gi = GiMode::Brute;
+            } else {
+                ok = false;
+            }
+        } else if (name == "--gi-accuracy") {
+            char *end = nullptr;
+            options.giAccuracy = std::strtod(value, &end);
+            ok = end != value && *end == '\0' && options.giAccuracy > 0.0 && options.giAccuracy <= 2.0;
+        } else if (name == "--gi-rows") {
+            ok = parsePositive(value, 64, number);
+            options.giRows = static_cast<int>(number);
+        } else if (name == "--caustics") {
+            ok = parsePositive(value, 1LL << 32, number);
+            options.causticPhotons = number;
+        } else if (name == "--caustic-k") {
+            ok = parsePositive(value, 256, number);
+            options.causticNeighbours = static_cast<int>(number);
+        } else if (name == "--caustic-radius") {
+            char *end = nullptr;
+            options.causticRadius = std::strtod(value, &end);
+            ok = end != value && *end == '\0' && options.causticRadius > 0.0;
+        } else if (name == "--split-throughput") {
+            char *end = nullptr;
+            options.splitThroughput = std::strtod(value, &end);
+            ok = end != value && *end == '\0' && options.splitThroughput >= 1e-3;
+        } else if (name == "--spp") {
+            ok = parsePositive(value, 1 << 16, number);
+            options.samples = static_cast<int>(number);
+        } else if (name == "--min-spp") {
+            ok = parsePositive(value, 1 << 16, number);
+            options.minSamples = static_cast<int>(number);
+        } else if (name == "--noise") {
+            ok = parseNonNegative(value, options.noiseThreshold);
+        } else if (name == "--aperture") {
+            ok = parseNonNegative(value, options.aperture);
+        } else if (name == "--focus") {
+            ok = parseNonNegative(value, options.focusDistance);
+        } else if (name == "--motion") {
+            ok = parseVector(value, options.motion.translation);
+        } else if (name == "--spin") {
+            ok = parseReal(value, options.motion.spinDegrees);
+        } else if (name == "--time-steps") {
+            ok = parsePositive(value, 129, number) && number >= 2;
+            options.motion.timeSteps = static_cast<int>(number);
+        } else if (name == "--terrain") {
+            ok = parsePositive(value, 1 << 14, number);
+            options.terrainCells = static_cast<int>(number);
+        } else if (name == "--sdf") {
+            const std::string mode = value;
+            ok = mode == "on" || mode == "off";
+            options.sdf = mode == "on";
+        } else if (name == "--spheres") {
+            ok = parsePositive(value, 256, number);
+            options.spheres = static_cast<int>(number);
+        } else if (name == "--lod-error") {
+            ok = parseNonNegative(value, options.lodError);
+        } else if (name == "--subdiv") {
+            ok = parseNonNegative(value, options.subdivPixels);
+        } else if (name == "--tess-cache") {
+            ok = parsePositive(value, 1 << 16, number);
+            options.tessellationCacheMb = static_cast<int>(number);
+        } else if (name == "--curves") {
+            options.curvesFile = value;
+        } else if (name == "--hair") {
+            ok = parsePositive(value, 1 << 20, number);
+            options.hairStrands = static_cast<int>(number);
+        } else if (name == "--env") {
+            options.environmentFile = value;
+        } else if (name == "--env-scale") {
+            ok = parseNonNegative(value, options.environmentScale);
+        } else if (name == "--env-samples") {
+            ok = parsePositive(value, 4096, number);
+            options.environmentSamples = static_cast<int>(number);
+        } else if (name == "--fog") {
+            ok = parseNonNegative(value, options.fogDensity);
+        } else if (name == "--fog-bank") {
+            ok = parseNonNegative(value, options.fogBank);
+        } else if (name == "--fog-grid") {
+            ok = parsePositive(value, 512, number);
+            options.fogGrid = static_cast<int>(number);
+        } else if (name == "--fog-albedo") {
+            ok = parseNonNegative(value, options.fogAlbedo) && options.fogAlbedo <= 1.0;
+        } else if (name == "--fog-g") {
+            ok = parseReal(value, options.fogAnisotropy) && std::abs(options.fogAnisotropy) < 1.0;
+        } else if (name == "--fog-steps") {
+            ok = parsePositive(value, 1 << 20, number);
+            options.fogSteps = static_cast<int>(number);
+        } else if (name == "--scene") {
+            options.sceneFile = value;
+        } else if (name == "--watch") {
+            const std::string mode = value;
+            ok = mode == "on" || mode == "off";
+            options.watch = mode == "on";
+        } else if (name == "--jobs") {
+            options.jobsFile = value;
+        } else if (name == "--tile") {
+            ok = parsePositive(value, 1024, number);
+            options.tileSize = static_cast<int>(number);
+        } else if (name == "--checkpoint") {
+            options.checkpointFile = value;
+        } else if (name == "--checkpoint-interval") {
+            ok = parseNonNegative(value, options.checkpointInterval) && options.checkpointInterval > 0.0;
+        } else if (name == "--max-depth") {
+            ok = parsePositive(value, 1000, number);
+            options.maxDepth = static_cast<int>(number);
+        } else if (name == "--deadline") {
+            ok = parseNonNegative(value, options.deadline) && options.deadline > 0.0;
+        } else if (name == "--output") {
+            options.output = value;
+        } else {
+            std::cerr << "Error: Unknown option '" << name << "'.\n";
+            printUsage(argv[0]);
+            return false;
+        }
+        if (!ok) {
+            std::cerr << "Error: Invalid value '" << value << "' for '" << name << "'.\n";
+            printUsage(argv[0]);
+            return false;
+        }
+    }
+    if (options.watch && options.sceneFile.empty()) {
+        std::cerr << "Error: '--watch on' needs a scene file to watch (--scene).\n";
+        return false;
+    }
+    if (options.watch && !options.jobsFile.empty()) {
+        std::cerr << "Error: '--watch on' and '--jobs' cannot be combined.\n";
+        return false;
+    }
+    if (!options.checkpointFile.empty() && (options.watch || !options.jobsFile.empty())) {
+        std::cerr << "Error: '--checkpoint' cannot be combined with '--watch on' or '--jobs'.\n";
+        return false;
+    }
+    if (!options.checkpointFile.empty() && options.gi == GiMode::Cache) {
+        // Cache records depend on the order tiles are rendered in, so a resume would not match
+        std::cerr << "Error: '--checkpoint' cannot be combined with '--gi cache'.\n";
+        return false;
+    }
+    if (options.deadline > 0.0 && (options.watch || !options.jobsFile.empty() || !options.checkpointFile.empty())) {
+        std::cerr << "Error: '--deadline' cannot be combined with '--watch on', '--jobs' or '--checkpoint'.\n";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * FNV-1a over the arguments, skipping the options that do not change pixels.
+ */
+std::uint64_t optionsFingerprint(int argc, char *argv[]) {
+    std::uint64_t hash = 14695981039346656037ull;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string name = argv[i];
+        if (name == "--threads" || name == "--output" || name == "--checkpoint" ||
+            name == "--checkpoint-interval") {
+            continue;
+        }
+        // Terminators included, so "ab" "c" and "a" "bc" differ
+        for (const char *text: {argv[i], argv[i + 1]}) {
+            do {
+                hash = (hash ^ static_cast<unsigned char>(*text)) * 1099511628211ull;
+            } while (*text++ != '\0');
+        }
+    }
+    return hash;
+}
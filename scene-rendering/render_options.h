@@ -0,0 +1,83 @@
+#ifndef RENDER_OPTIONS_H
+#define RENDER_OPTIONS_H
+
+#include <cstdint>
+#include <string>
+#include "motion.h"
+
+/**
+ * @brief How indirect diffuse lighting (one bounce) is computed
+ */
+enum class GiMode {
+    Off,   ///< Direct lighting and mirror reflections only
+    Cache, ///< Ward irradiance cache with gradient interpolation
+    Brute  ///< Hemisphere sampling at every shading point (reference)
+};
+
+/**
+ * @brief Command-line settings of the renderer
+ */
+struct RenderOptions {
+    int width = 800;                     ///< Image width in pixels
+    int height = 800;                    ///< Image height in pixels
+    unsigned threads = 0;                ///< Worker threads, 0 = all hardware threads
+    GiMode gi = GiMode::Off;             ///< Indirect diffuse lighting
+    double giAccuracy = 0.25;            ///< Irradiance cache error bound a (smaller = more records)
+    int giRows = 8;                      ///< Hemisphere strata in theta; 3x as many in phi
+    long long causticPhotons = 0;        ///< Photons emitted for caustics, 0 = no caustics
+    int causticNeighbours = 64;          ///< Photons per caustic estimate
+    double causticRadius = 0.5;          ///< Maximum caustic gather radius
+    double splitThroughput = 0.25;       ///< Dielectric splitting threshold, see RenderContext
+    int maxDepth = 50;                   ///< Reflection and refraction bounces
+    int samples = 1;                     ///< Maximum samples per pixel
+    int minSamples = 8;                  ///< Samples before the noise test (capped at samples)
+    double noiseThreshold = 0.5;         ///< Adaptive sampling target, see SamplingSettings
+    double aperture = 0.0;               ///< Lens radius, 0 = pinhole
+    double focusDistance = 0.0;          ///< Focus plane distance, 0 = distance to the look-at point
+    int terrainCells = 0;                ///< Procedural heightfield cells per side, 0 = no terrain
+    bool sdf = false;                    ///< Add the sphere-traced torus
+    int spheres = 0;                     ///< Detailed sphere meshes in a row, 0 = none
+    double lodError = 0.5;               ///< Largest LOD error in pixels, 0 = always full detail
+    double subdivPixels = 0.0;           ///< Subdivision surface segment length in pixels, 0 = no surface
+    int tessellationCacheMb = 32;        ///< Embree tessellation cache size in MB
+    std::string curvesFile;              ///< Strands to load (see loadCurves), empty = none
+    int hairStrands = 0;                 ///< Fibres in the generated tuft, 0 = none
+    std::string environmentFile;         ///< Latitude-longitude PFM environment map, empty = black background
+    double environmentScale = 100.0;     ///< Factor applied to the map's radiance
+    int environmentSamples = 16;         ///< Environment light samples per shading point
+    double fogDensity = 0.0;             ///< Extinction of the uniform haze per unit length, 0 = none
+    double fogBank = 0.0;                ///< Extinction of the ground fog bank at the floor, 0 = none
+    int fogGrid = 64;                    ///< Fog bank voxels along the longest side of its box
+    double fogAlbedo = 0.8;              ///< Share of fog extinction that is scattering
+    double fogAnisotropy = 0.3;          ///< Henyey-Greenstein g of the fog
+    int fogSteps = 256;                  ///< Tracking steps per ray through the fog
+    std::string sceneFile;               ///< Materials, offsets and lights to apply (see loadSceneFile), empty = none
+    bool watch = false;                  ///< Re-render whenever the scene file changes
+    std::string jobsFile;                ///< Jobs to schedule (see loadJobs) instead of one render, empty = none
+    int tileSize = 32;                   ///< Tile side of scheduled jobs and checkpoints in pixels
+    std::string checkpointFile;          ///< File to save render progress to and resume from, empty = none
+    double checkpointInterval = 30.0;    ///< Seconds between checkpoints
+    double deadline = 0.0;               ///< Time budget of the render in milliseconds, 0 = no deadline
+    ObjectMotion motion;                 ///< Motion of the blue cube over the shutter interval
+    std::string output = "output.ppm";   ///< Output image path
+};
+
+/**
+ * @brief Parse the command line into options
+ *
+ * Prints an error and the usage to std::cerr on failure.
+ *
+ * @return true if all arguments were understood
+ */
+bool parseRenderOptions(int argc, char *argv[], RenderOptions &options);
+
+/**
+ * @brief Hash of the arguments that affect the rendered image
+ *
+ * Threads, output and checkpoint options are left out, so a render can be
+ * resumed with a different thread count or output path. Input files are
+ * identified by name only.
+ */
+std::uint64_t optionsFingerprint(int argc, char *argv[]);
+
+#endif // RENDER_OPTIONS_H
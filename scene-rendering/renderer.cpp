@@ -0,0 +1,720 @@
+#include "renderer.h"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <numbers>
+#include <thread>
+#include "material.h"
+#include "shading.h"
+#include "sampling.h"
+#include "optics.h"
+
+namespace {
+
+// Clamp range of the harmonic mean distance of irradiance records
+constexpr double kMinRecordRadius = 0.1;
+constexpr double kMaxRecordRadius = 10.0;
+
+// Overture pass of the irradiance cache: one pixel in kOvertureStride^2
+constexpr int kOvertureStride = 8;
+
+Vector3D hitPoint(const RTCRayHit &rayhit) {
+    return Vector3D(rayhit.ray.org_x + rayhit.ray.tfar * rayhit.ray.dir_x,
+                    rayhit.ray.org_y + rayhit.ray.tfar * rayhit.ray.dir_y,
+                    rayhit.ray.org_z + rayhit.ray.tfar * rayhit.ray.dir_z);
+}
+
+double channel(const Color &c, int k) {
+    return k == 0 ? c.r : (k == 1 ? c.g : c.b);
+}
+
+/**
+ * Seed for the hemisphere jitter of a shading point. Derived from the point
+ * itself, so results do not depend on which thread shades it.
+ */
+std::uint64_t pointSeed(const Vector3D &point) {
+    return hashSeed(hashSeed(std::bit_cast<std::uint64_t>(point.x), std::bit_cast<std::uint64_t>(point.y)),
+                    std::bit_cast<std::uint64_t>(point.z));
+}
+
+// Whether anything blocks the ray from a point towards infinity
+bool occludedTowards(RTCScene scene, const Vector3D &point, const Vector3D &direction, float time) {
+    RTCRay ray;
+    ray.org_x = static_cast<float>(point.x);
+    ray.org_y = static_cast<float>(point.y);
+    ray.org_z = static_cast<float>(point.z);
+    ray.dir_x = static_cast<float>(direction.x);
+    ray.dir_y = static_cast<float>(direction.y);
+    ray.dir_z = static_cast<float>(direction.z);
+    ray.tnear = 0.001f;
+    ray.tfar = std::numeric_limits<float>::infinity();
+    ray.time = time;
+    ray.mask = ~0u;
+    ray.flags = 0;
+    rtcOccluded1(scene, &ray);
+    return ray.tfar < 0;
+}
+
+/**
+ * Radiance arriving along a ray that leaves the scene, averaged over a cone
+ * of the given width.
+ */
+Color background(const RenderContext &context, const Vector3D &direction, double angle) {
+    return context.environment ? context.environment->filtered(direction, angle) : Color(0, 0, 0);
+}
+
+/**
+ * Light of the point and directional lights scattered once at a point of
+ * the medium into the direction of travel, per unit of scattering. The
+ * shadow rays to all lights are traced kPacketSize at a time through
+ * rtcOccluded8; each light that is not blocked is dimmed by the medium's
+ * transmittance towards it.
+ */
+Color inscattered(const RenderContext &context, const Vector3D &point, const Vector3D &direction, Random &random,
+                  float time, int &steps) {
+    const auto &lights = *context.lights;
+    Color sum(0, 0, 0);
+    for (std::size_t first = 0; first < lights.size(); first += kPacketSize) {
+        const int lanes = static_cast<int>(std::min<std::size_t>(kPacketSize, lights.size() - first));
+        alignas(32) int valid[kPacketSize];
+        alignas(32) RTCRay8 rays;
+        Vector3D toLight[kPacketSize];
+        for (int k = 0; k < kPacketSize; ++k) {
+            valid[k] = k < lanes ? -1 : 0;
+            toLight[k] = k < lanes ? lights[first + k]->getDirection(point) : Vector3D(0, 1, 0);
+            const double distance = k < lanes ? lights[first + k]->getDistance(point) : 0.0;
+            rays.org_x[k] = static_cast<float>(point.x);
+            rays.org_y[k] = static_cast<float>(point.y);
+            rays.org_z[k] = static_cast<float>(point.z);
+            rays.dir_x[k] = static_cast<float>(toLight[k].x);
+            rays.dir_y[k] = static_cast<float>(toLight[k].y);
+            rays.dir_z[k] = static_cast<float>(toLight[k].z);
+            rays.tnear[k] = 0.001f;
+            rays.tfar[k] = std::isinf(distance) ? std::numeric_limits<float>::infinity()
+                                                : static_cast<float>(distance - 0.001);
+            rays.time[k] = time;
+            rays.mask[k] = ~0u;
+            rays.id[k] = static_cast<unsigned>(k);
+            rays.flags[k] = 0;
+        }
+        rtcOccluded8(valid, context.scene, &rays);
+        for (int k = 0; k < lanes; ++k) {
+            if (rays.tfar[k] < 0) {
+                continue;
+            }
+            const Light *light = lights[first + k];
+            const double transmittance = context.medium->transmittance(point, toLight[k],
+                                                                       light->getDistance(point), random, steps);
+            // Light travels along -toLight before scattering; the phase function
+            // is normalized per steradian, the lights' intensity is not
+            const double phase = 4.0 * std::numbers::pi * context.medium->phase(-toLight[k].dot(direction));
+            sum = sum + light->intensity * (light->getAttenuation(point) * transmittance * phase);
+        }
+    }
+    return sum;
+}
+
+/**
+ * What reaches the origin of a ray through the medium: the radiance arriving
+ * from distance (a surface or the background) times the transmittance, plus
+ * single scattering at a delta-tracked collision along the way.
+ */
+Color throughMedium(const RenderContext &context, const Vector3D &origin, const Vector3D &direction,
+                    double distance, const Color &arriving, Random &random, float time) {
+    if (!context.medium) {
+        return arriving;
+    }
+    int steps = context.mediumSteps;
+    Color result(0, 0, 0);
+    if (arriving.r > 0.0 || arriving.g > 0.0 || arriving.b > 0.0) {
+        result = arriving * context.medium->transmittance(origin, direction, distance, random, steps);
+    }
+    double t;
+    if (context.medium->sampleCollision(origin, direction, distance, random, steps, t)) {
+        result = result + inscattered(context, origin + direction * t, direction, random, time, steps) *
+                          context.medium->albedo();
+    }
+    if (context.stats) {
+        context.stats->mediumSteps.fetch_add(static_cast<std::uint64_t>(context.mediumSteps - steps),
+                                             std::memory_order_relaxed);
+        if (steps <= 0) {
+            context.stats->mediumBudgetHits.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    return result;
+}
+
+/**
+ * Direction along the curve at a hit, for Strand materials; zero for others,
+ * which do not use it.
+ */
+Vector3D strandTangent(RTCGeometry geometry, const RTCHit &hit, const Material &material) {
+    if (material.model != ShadingModel::Strand) {
+        return Vector3D();
+    }
+    float position[4], derivative[4];
+    rtcInterpolate1(geometry, hit.primID, hit.u, hit.v, RTC_BUFFER_TYPE_VERTEX, 0, position, derivative, nullptr, 4);
+    return Vector3D(derivative[0], derivative[1], derivative[2]).normalized();
+}
+
+/**
+ * Phong or strand lighting of a hit from the lights that are not occluded.
+ */
+Color directLighting(const Vector3D &point, const Vector3D &normal, const Vector3D &tangent,
+                     const Material &material, const RenderContext &context, const Vector3D &viewDir, float time) {
+    // Collect the visible lights, then accumulate them in the dispatched kernel.
+    // The buffer is per thread and reused; nothing below re-enters this function.
+    thread_local std::vector<LightSample> samples;
+    samples.clear();
+    samples.reserve(context.lights->size() + (context.environment ? context.environmentSamples : 0));
+    // Light reaching the point through the medium is dimmed by its transmittance
+    Random mediumRandom(hashSeed(pointSeed(point), 2));
+    int mediumSteps = context.mediumSteps;
+    auto transmittance = [&](const Vector3D &direction, double distance) {
+        return context.medium ? context.medium->transmittance(point, direction, distance, mediumRandom, mediumSteps)
+                              : 1.0;
+    };
+    for (const auto *light: *context.lights) {
+        if (!light->isOccluded(point, context.scene, time)) {
+            const Vector3D direction = light->getDirection(point);
+            samples.push_back({direction, light->intensity,
+                               light->getAttenuation(point) * transmittance(direction, light->getDistance(point))});
+        }
+    }
+    if (context.environment) {
+        // Each importance-sampled direction becomes a directional light of
+        // radiance / (pdf * count * pi), so the diffuse term estimates the
+        // Lambertian reflection of the whole map. Rows are stratified.
+        Random random(hashSeed(pointSeed(point), 1));
+        const int count = context.environmentSamples;
+        for (int k = 0; k < count; ++k) {
+            Color radiance;
+            double pdf;
+            const Vector3D direction = context.environment->sample((k + random.nextDouble()) / count,
+                                                                   random.nextDouble(), radiance, pdf);
+            if (pdf <= 0.0 || (material.model == ShadingModel::Phong && normal.dot(direction) <= 0.0)) {
+                continue; // Black texel, or below the surface where the diffuse term is zero anyway
+            }
+            if (!occludedTowards(context.scene, point, direction, time)) {
+                samples.push_back({direction, radiance * (1.0 / (pdf * count * std::numbers::pi)),
+                                   transmittance(direction, std::numeric_limits<double>::infinity())});
+            }
+        }
+    }
+    if (material.model == ShadingModel::Strand) {
+        return accumulateStrand(samples.data(), samples.size(), tangent, viewDir, material);
+    }
+    return accumulatePhong(samples.data(), samples.size(), normal, viewDir, material);
+}
+
+/**
+ * Indirect irradiance at a point: interpolated from the cache when possible,
+ * otherwise sampled (and, with the cache, stored for later lookups).
+ */
+Color indirectIrradiance(const Vector3D &point, const Vector3D &normal, const RenderContext &context,
+                         float time) {
+    if (context.gi == GiMode::Cache) {
+        Color irradiance;
+        if (context.irradianceCache->lookup(point, normal, irradiance)) {
+            return irradiance;
+        }
+        IrradianceRecord record;
+        sampleIrradiance(point, normal, context, pointSeed(point), time, true, record);
+        context.irradianceCache->insert(record);
+        return record.irradiance;
+    }
+    IrradianceRecord record;
+    sampleIrradiance(point, normal, context, pointSeed(point), time, false, record);
+    return record.irradiance;
+}
+
+// Run body(row) for every row in rows, distributed over threads
+template <typename Body>
+void forEachRow(const std::vector<int> &rows, unsigned threads, Body &&body) {
+    std::atomic<std::size_t> next{0};
+    auto worker = [&] {
+        for (std::size_t r = next.fetch_add(1); r < rows.size(); r = next.fetch_add(1)) {
+            body(rows[r]);
+        }
+    };
+    if (threads <= 1) {
+        worker();
+        return;
+    }
+    std::vector<std::jthread> pool;
+    pool.reserve(threads);
+    for (unsigned t = 0; t < threads; ++t) {
+        pool.emplace_back(worker);
+    }
+}
+
+} // namespace
+
+bool traceRay(RTCScene scene, const Vector3D &origin, const Vector3D &direction, RTCRayHit &rayhit, float time) {
+    rayhit.ray.org_x = origin.x;
+    rayhit.ray.org_y = origin.y;
+    rayhit.ray.org_z = origin.z;
+    rayhit.ray.dir_x = direction.x;
+    rayhit.ray.dir_y = direction.y;
+    rayhit.ray.dir_z = direction.z;
+    rayhit.ray.tnear = 0.001f;
+    rayhit.ray.tfar = std::numeric_limits<float>::infinity();
+    rayhit.ray.time = time;
+    rayhit.ray.mask = ~0u;
+    rayhit.ray.flags = 0;
+    rayhit.hit.geomID = RTC_INVALID_GEOMETRY_ID;
+    rtcIntersect1(scene, &rayhit);
+    return rayhit.hit.geomID != RTC_INVALID_GEOMETRY_ID;
+}
+
+/**
+ * Stratified hemisphere gather with the irradiance gradients of Ward &
+ * Heckbert 1992, in the form given by Krivanek et al. ("Practical Global
+ * Illumination with Irradiance Caching", 2009). Cell (j, k) spans
+ * sin^2(theta) in [j/M, (j+1)/M) and phi in [2 pi k/N, 2 pi (k+1)/N).
+ */
+void sampleIrradiance(const Vector3D &point, const Vector3D &normal, const RenderContext &context,
+                      std::uint64_t seed, float time, bool gradients, IrradianceRecord &record) {
+    const int M = context.giRows;
+    const int N = 3 * M;
+    thread_local std::vector<Color> radiance;
+    thread_local std::vector<double> distance;
+    radiance.assign(static_cast<std::size_t>(M) * N, Color(0, 0, 0));
+    distance.assign(static_cast<std::size_t>(M) * N, std::numeric_limits<double>::infinity());
+
+    Vector3D t, b;
+    buildBasis(normal, t, b);
+    Random random(seed);
+
+    constexpr double pi = std::numbers::pi;
+    Color sum(0, 0, 0);
+    double inverseDistanceSum = 0.0;
+    Vector3D rotational[3];
+    for (int j = 0; j < M; ++j) {
+        for (int k = 0; k < N; ++k) {
+            const double u1 = (j + random.nextDouble()) / M;
+            const double phi = 2.0 * pi * (k + random.nextDouble()) / N;
+            const double sinTheta = std::sqrt(u1);
+            const double cosTheta = std::sqrt(1.0 - u1);
+            const Vector3D dir = t * (std::cos(phi) * sinTheta) + b * (std::sin(phi) * sinTheta) + normal * cosTheta;
+
+            RTCRayHit hit;
+            Color L(0, 0, 0); // A miss adds nothing: the environment is sampled as direct light
+            if (traceRay(context.scene, point, dir, hit, time)) {
+                RTCGeometry geometry = rtcGetGeometry(context.scene, hit.hit.geomID);
+                const Material *material = static_cast<Material *>(rtcGetGeometryUserData(geometry));
+                const Vector3D hitNormal = Vector3D(hit.hit.Ng_x, hit.hit.Ng_y, hit.hit.Ng_z).normalized();
+                L = directLighting(hitPoint(hit), hitNormal, strandTangent(geometry, hit.hit, *material), *material,
+                                   context, dir, time);
+                distance[j * N + k] = hit.ray.tfar;
+                inverseDistanceSum += 1.0 / hit.ray.tfar;
+            }
+            radiance[j * N + k] = L;
+            sum = sum + L;
+
+            if (gradients && cosTheta > 1e-6) {
+                // Rotational gradient: -tan(theta) L along the tangent perpendicular to phi
+                const Vector3D v = t * -std::sin(phi) + b * std::cos(phi);
+                const double tanTheta = sinTheta / cosTheta;
+                for (int c = 0; c < 3; ++c) {
+                    rotational[c] = rotational[c] + v * (-tanTheta * channel(L, c));
+                }
+            }
+        }
+    }
+    if (context.stats) {
+        context.stats->giRays.fetch_add(static_cast<std::uint64_t>(M) * N, std::memory_order_relaxed);
+    }
+
+    const double cellWeight = pi / (static_cast<double>(M) * N);
+    record.position = point;
+    record.normal = normal;
+    record.irradiance = sum * cellWeight;
+    double radius = inverseDistanceSum > 0.0 ? static_cast<double>(M) * N / inverseDistanceSum : kMaxRecordRadius;
+
+    for (int c = 0; c < 3; ++c) {
+        record.rotationalGradient[c] = rotational[c] * cellWeight;
+        record.translationalGradient[c] = Vector3D(0, 0, 0);
+    }
+    if (gradients) {
+        for (int k = 0; k < N; ++k) {
+            const double phiCenter = 2.0 * pi * (k + 0.5) / N;
+            const double phiMinus = 2.0 * pi * k / N;
+            const Vector3D u = t * std::cos(phiCenter) + b * std::sin(phiCenter);
+            const Vector3D vMinus = t * -std::sin(phiMinus) + b * std::cos(phiMinus);
+            const int kPrev = (k + N - 1) % N;
+            for (int j = 0; j < M; ++j) {
+                const Color &L = radiance[j * N + k];
+                // Change across the theta boundary between cells j - 1 and j
+                if (j > 0) {
+                    const double sinMinus = std::sqrt(static_cast<double>(j) / M);
+                    const double cos2Minus = 1.0 - static_cast<double>(j) / M;
+                    const double r = std::min(distance[j * N + k], distance[(j - 1) * N + k]);
+                    const double factor = 2.0 * pi / N * sinMinus * cos2Minus / r;
+                    const Color &Lprev = radiance[(j - 1) * N + k];
+                    for (int c = 0; c < 3; ++c) {
+                        record.translationalGradient[c] = record.translationalGradient[c] +
+                            u * (factor * (channel(L, c) - channel(Lprev, c)));
+                    }
+                }
+                // Change across the phi boundary between cells k - 1 and k
+                const double cosMinus = std::sqrt(1.0 - static_cast<double>(j) / M);
+                const double cosPlus = std::sqrt(1.0 - static_cast<double>(j + 1) / M);
+                const double sinCenter = std::sqrt((j + 0.5) / M);
+                const double r = std::min(distance[j * N + k], distance[j * N + kPrev]);
+                const double factor = (cosMinus - cosPlus) / (sinCenter * r);
+                const Color &Lside = radiance[j * N + kPrev];
+                for (int c = 0; c < 3; ++c) {
+                    record.translationalGradient[c] = record.translationalGradient[c] +
+                        vMinus * (factor * (channel(L, c) - channel(Lside, c)));
+                }
+            }
+        }
+        // Keep the translational extrapolation from overshooting within the record radius
+        for (int c = 0; c < 3; ++c) {
+            const double magnitude = record.translationalGradient[c].norm();
+            const double E = channel(record.irradiance, c);
+            if (magnitude > 0.0 && magnitude * radius > E) {
+                radius = std::max(E / magnitude, kMinRecordRadius);
+            }
+        }
+    }
+    record.radius = std::clamp(radius, kMinRecordRadius, kMaxRecordRadius);
+}
+
+Color shade(const RTCRayHit &rayhit, const RenderContext &context, const Vector3D &viewDir, Random &random,
+            const PathState &path) {
+    // Stop recursion at maximum depth to prevent infinite loops
+    if (path.depth >= context.maxDepth) {
+        if (context.stats) {
+            context.stats->depthLimitHits.fetch_add(1, std::memory_order_relaxed);
+        }
+        return Color(0, 0, 0);
+    }
+
+    RTCGeometry geometry = rtcGetGeometry(context.scene, rayhit.hit.geomID);
+    Material *material = static_cast<Material *>(rtcGetGeometryUserData(geometry));
+    Vector3D point = hitPoint(rayhit);
+    Vector3D normal(rayhit.hit.Ng_x, rayhit.hit.Ng_y, rayhit.hit.Ng_z);
+    normal = normal.normalized();
+
+    Color totalColor = directLighting(point, normal, strandTangent(geometry, rayhit.hit, *material), *material,
+                                      context, viewDir, path.time);
+
+    if (context.gi != GiMode::Off && material->diffuse > 0.0) {
+        // Gather on the side the ray came from; diffuse BRDF = color * diffuse / pi
+        const Vector3D facing = normal.dot(viewDir) > 0.0 ? -normal : normal;
+        const Color irradiance = indirectIrradiance(point, facing, context, path.time);
+        totalColor = totalColor + material->color * irradiance * (material->diffuse / std::numbers::pi);
+    }
+
+    if (context.causticMap && material->diffuse > 0.0) {
+        const Vector3D facing = normal.dot(viewDir) > 0.0 ? -normal : normal;
+        const auto start = std::chrono::steady_clock::now();
+        const Color irradiance = context.causticMap->irradiance(point, facing, context.causticNeighbours,
+                                                                context.causticRadius);
+        if (context.stats) {
+            const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count();
+            context.stats->causticGathers.fetch_add(1, std::memory_order_relaxed);
+            context.stats->causticGatherNs.fetch_add(static_cast<std::uint64_t>(ns), std::memory_order_relaxed);
+        }
+        // Photon irradiance is in the units of the direct term, so it is reflected the same way
+        totalColor = totalColor + material->color * irradiance * material->diffuse;
+    }
+
+    // Trace a secondary ray and shade what it hits
+    auto follow = [&](const Vector3D &direction, double throughput, bool inside) {
+        if (context.stats) {
+            context.stats->secondaryRays.fetch_add(1, std::memory_order_relaxed);
+        }
+        RTCRayHit secondary;
+        const Color arriving = traceRay(context.scene, point, direction, secondary, path.time)
+                                   ? shade(secondary, context, direction, random,
+                                           {path.depth + 1, throughput, inside, path.time})
+                                   : background(context, direction, context.missFootprint);
+        return throughMedium(context, point, direction, secondary.ray.tfar, arriving, random, path.time);
+    };
+
+    if (material->transparency <= 0.0) {
+        if (material->reflectivity > 0.0) {
+            const Vector3D reflectedDir = reflectDirection(viewDir, normal);
+            const Color reflectedColor = follow(reflectedDir, path.throughput * material->reflectivity,
+                                                path.insideDielectric);
+            totalColor = totalColor + reflectedColor * material->reflectivity;
+        }
+        return totalColor;
+    }
+
+    // Dielectric: mirror and Fresnel reflection share one reflected ray
+    const Vector3D facing = normal.dot(viewDir) > 0.0 ? -normal : normal;
+    const double eta = path.insideDielectric ? material->ior : 1.0 / material->ior;
+    const double fresnel = schlickFresnel(-facing.dot(viewDir), eta);
+    const double opacity = 1.0 - material->transparency;
+    const Vector3D reflectedDir = reflectDirection(viewDir, facing);
+    Vector3D refractedDir;
+    const bool refracts = refractDirection(viewDir, facing, eta, refractedDir);
+    const double reflectedWeight = opacity * material->reflectivity +
+                                   material->transparency * (refracts ? fresnel : 1.0);
+    const double refractedWeight = refracts ? material->transparency * (1.0 - fresnel) : 0.0;
+    const double specularWeight = reflectedWeight + refractedWeight;
+
+    totalColor = totalColor * opacity;
+    if (refractedWeight <= 0.0 || path.throughput * specularWeight >= context.splitThroughput) {
+        if (reflectedWeight > 0.0) {
+            totalColor = totalColor + follow(reflectedDir, path.throughput * reflectedWeight,
+                                             path.insideDielectric) * reflectedWeight;
+        }
+        if (refractedWeight > 0.0) {
+            totalColor = totalColor + follow(refractedDir, path.throughput * refractedWeight,
+                                             !path.insideDielectric) * refractedWeight;
+        }
+    } else if (random.nextDouble() * specularWeight < reflectedWeight) {
+        // One branch, picked in proportion to its weight, keeps the estimate unbiased
+        totalColor = totalColor + follow(reflectedDir, path.throughput * specularWeight,
+                                         path.insideDielectric) * specularWeight;
+    } else {
+        totalColor = totalColor + follow(refractedDir, path.throughput * specularWeight,
+                                         !path.insideDielectric) * specularWeight;
+    }
+
+    return totalColor;
+}
+
+namespace {
+
+/**
+ * Adaptive packet sampling of one pixel. Welford's running variance of the
+ * clamped luminance drives the stopping rule. samples receives how many
+ * were taken.
+ */
+Color samplePixel(const Camera &camera, const RenderContext &context, const SamplingSettings &sampling, int i, int j,
+                  int width, int height, Random &random, int &samples) {
+    Color sum(0, 0, 0);
+    double mean = 0.0, m2 = 0.0;
+    int n = 0;
+    while (n < sampling.maxSamples) {
+        const int lanes = std::min(kPacketSize, sampling.maxSamples - n);
+        RTCRayHit8 packet;
+        int valid[kPacketSize];
+        Vector3D directions[kPacketSize];
+        float times[kPacketSize];
+        for (int k = 0; k < kPacketSize; ++k) {
+            valid[k] = k < lanes ? -1 : 0;
+            Vector3D origin = camera.eye;
+            directions[k] = Vector3D(0, 0, -1);
+            times[k] = 0.0f;
+            if (k < lanes) {
+                // 4 x 2 lens strata per packet, jittered
+                const double lensU = (k % 4 + random.nextDouble()) / 4.0;
+                const double lensV = (k / 4 + random.nextDouble()) / 2.0;
+                generateCameraRay(camera, i + random.nextDouble(), j + random.nextDouble(), width, height, lensU,
+                                  lensV, origin, directions[k]);
+                if (context.motionBlur) {
+                    // Time strata permuted against the lens strata (5 is coprime to 8)
+                    times[k] = static_cast<float>(((k * 5) % kPacketSize + random.nextDouble()) / kPacketSize);
+                }
+            }
+            packet.ray.org_x[k] = static_cast<float>(origin.x);
+            packet.ray.org_y[k] = static_cast<float>(origin.y);
+            packet.ray.org_z[k] = static_cast<float>(origin.z);
+            packet.ray.dir_x[k] = static_cast<float>(directions[k].x);
+            packet.ray.dir_y[k] = static_cast<float>(directions[k].y);
+            packet.ray.dir_z[k] = static_cast<float>(directions[k].z);
+            packet.ray.tnear[k] = 0.001f;
+            packet.ray.tfar[k] = std::numeric_limits<float>::infinity();
+            packet.ray.time[k] = times[k];
+            packet.ray.mask[k] = ~0u;
+            packet.ray.id[k] = static_cast<unsigned>(k);
+            packet.ray.flags[k] = 0;
+            packet.hit.geomID[k] = RTC_INVALID_GEOMETRY_ID;
+        }
+        rtcIntersect8(valid, context.scene, &packet);
+        if (context.stats) {
+            context.stats->primaryRays.fetch_add(lanes, std::memory_order_relaxed);
+        }
+
+        for (int k = 0; k < lanes; ++k) {
+            Color color(0, 0, 0);
+            if (packet.hit.geomID[k] != RTC_INVALID_GEOMETRY_ID) {
+                RTCRayHit rayhit;
+                rayhit.ray.org_x = packet.ray.org_x[k];
+                rayhit.ray.org_y = packet.ray.org_y[k];
+                rayhit.ray.org_z = packet.ray.org_z[k];
+                rayhit.ray.dir_x = packet.ray.dir_x[k];
+                rayhit.ray.dir_y = packet.ray.dir_y[k];
+                rayhit.ray.dir_z = packet.ray.dir_z[k];
+                rayhit.ray.tnear = packet.ray.tnear[k];
+                rayhit.ray.tfar = packet.ray.tfar[k];
+                rayhit.ray.time = packet.ray.time[k];
+                rayhit.hit.Ng_x = packet.hit.Ng_x[k];
+                rayhit.hit.Ng_y = packet.hit.Ng_y[k];
+                rayhit.hit.Ng_z = packet.hit.Ng_z[k];
+                rayhit.hit.u = packet.hit.u[k];
+                rayhit.hit.v = packet.hit.v[k];
+                rayhit.hit.primID = packet.hit.primID[k];
+                rayhit.hit.geomID = packet.hit.geomID[k];
+                color = shade(rayhit, context, directions[k], random, {0, 1.0, false, times[k]});
+            } else {
+                color = background(context, directions[k], context.missFootprint);
+            }
+            // tfar is still infinite for misses
+            color = throughMedium(context, Vector3D(packet.ray.org_x[k], packet.ray.org_y[k], packet.ray.org_z[k]),
+                                  directions[k], packet.ray.tfar[k], color, random, times[k]);
+            sum = sum + color;
+            const double luminance = std::clamp(0.2126 * color.r + 0.7152 * color.g + 0.0722 * color.b, 0.0, 255.0);
+            ++n;
+            const double delta = luminance - mean;
+            mean += delta / n;
+            m2 += delta * (luminance - mean);
+        }
+
+        if (n >= sampling.minSamples && n > 1 && std::sqrt(m2 / (n - 1) / n) <= sampling.noiseThreshold) {
+            break;
+        }
+    }
+    samples = n;
+    return sum * (1.0 / n);
+}
+
+/**
+ * Color of pixel (i, j). The random numbers are seeded from the pixel's
+ * index, so a pixel comes out the same whichever thread, tile or pass
+ * renders it. samples receives the number of camera rays.
+ */
+Color renderPixel(const Camera &camera, const RenderContext &context, const SamplingSettings &sampling, int i, int j,
+                  int width, int height, int &samples) {
+    Random random(static_cast<std::uint64_t>(j) * width + i);
+    const bool singleRay = sampling.maxSamples <= 1 && camera.aperture <= 0.0 && !context.motionBlur;
+    if (!singleRay) {
+        return samplePixel(camera, context, sampling, i, j, width, height, random, samples);
+    }
+    samples = 1;
+    Vector3D rayDir = computeRayDirection(i, j, width, height, camera);
+    RTCRayHit rayhit;
+    if (context.stats) {
+        context.stats->primaryRays.fetch_add(1, std::memory_order_relaxed);
+    }
+    const Color arriving = traceRay(context.scene, camera.eye, rayDir, rayhit)
+                               ? shade(rayhit, context, rayDir, random) // Начинаем с глубины 0
+                               : background(context, rayDir, context.missFootprint);
+    return throughMedium(context, camera.eye, rayDir, rayhit.ray.tfar, arriving, random, 0.0f);
+}
+
+/**
+ * Render the pixels a mask selects (all of them without a mask) into image.
+ */
+void renderPixels(const Camera &camera, const RenderContext &context, const SamplingSettings &sampling, int width,
+                  int height, unsigned threads, const std::uint8_t *mask, std::vector<Color> &image) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    auto selected = [&](int i, int j) {
+        return !mask || mask[static_cast<std::size_t>(j) * width + i];
+    };
+
+
+    if (context.gi == GiMode::Cache) {
+        std::vector<int> overtureRows;
+        for (int j = kOvertureStride / 2; j < height; j += kOvertureStride) {
+            overtureRows.push_back(j);
+        }
+        forEachRow(overtureRows, threads, [&](int j) {
+            for (int i = kOvertureStride / 2; i < width; i += kOvertureStride) {
+                int samples;
+                if (selected(i, j)) {
+                    renderPixel(camera, context, sampling, i, j, width, height, samples);
+                }
+            }
+        });
+    }
+
+    std::vector<int> rows(height);
+    for (int j = 0; j < height; ++j) {
+        rows[j] = j;
+    }
+    forEachRow(rows, threads, [&](int j) {
+        for (int i = 0; i < width; ++i) {
+            int samples;
+            if (selected(i, j)) {
+                image[static_cast<std::size_t>(j) * width + i] = renderPixel(camera, context, sampling, i, j, width,
+                                                                             height, samples);
+            }
+        }
+    });
+}
+
+} // namespace
+
+void renderImage(const Camera &camera, const RenderContext &context, const SamplingSettings &sampling, int width,
+                 int height, unsigned threads, std::vector<Color> &image) {
+    image.assign(static_cast<std::size_t>(width) * height, Color(0, 0, 0));
+    renderPixels(camera, context, sampling, width, height, threads, nullptr, image);
+}
+
+void renderRegion(const Camera &camera, const RenderContext &context, const SamplingSettings &sampling, int width,
+                  int height, unsigned threads, const std::vector<std::uint8_t> &mask, std::vector<Color> &image) {
+    renderPixels(camera, context, sampling, width, height, threads, mask.data(), image);
+}
+
+std::uint64_t renderTile(const Camera &camera, const RenderContext &context, const SamplingSettings &sampling,
+                         int width, int height, int x0, int y0, int x1, int y1, Color *image) {
+    std::uint64_t total = 0;
+    for (int j = y0; j < y1; ++j) {
+        for (int i = x0; i < x1; ++i) {
+            int samples;
+            image[static_cast<std::size_t>(j) * width + i] = renderPixel(camera, context, sampling, i, j, width,
+                                                                         height, samples);
+            total += static_cast<std::uint64_t>(samples);
+        }
+    }
+    return total;
+}
+
+void traceGeometryIds(const Camera &camera, RTCScene scene, int width, int height, unsigned threads,
+                      std::vector<unsigned> &ids) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    ids.assign(static_cast<std::size_t>(width) * height, RTC_INVALID_GEOMETRY_ID);
+    std::vector<int> rows(height);
+    for (int j = 0; j < height; ++j) {
+        rows[j] = j;
+    }
+    forEachRow(rows, threads, [&](int j) {
+        for (int i = 0; i < width; ++i) {
+            RTCRayHit rayhit;
+            traceRay(scene, camera.eye, computeRayDirection(i, j, width, height, camera), rayhit);
+            ids[static_cast<std::size_t>(j) * width + i] = rayhit.hit.geomID;
+        }
+    });
+}
+
+std::size_t markChangedPixels(const std::vector<unsigned> &before, const std::vector<unsigned> &after,
+                              const std::vector<unsigned> &changed, int width, int height,
+                              std::vector<std::uint8_t> &mask) {
+    auto edited = [&](unsigned id) {
+        return std::find(changed.begin(), changed.end(), id) != changed.end();
+    };
+    std::vector<std::uint8_t> core(before.size(), 0);
+    for (std::size_t p = 0; p < core.size(); ++p) {
+        core[p] = before[p] != after[p] || edited(before[p]) || edited(after[p]);
+    }
+    mask.assign(core.size(), 0);
+    std::size_t marked = 0;
+    for (int j = 0; j < height; ++j) {
+        for (int i = 0; i < width; ++i) {
+            bool near = false;
+            for (int y = std::max(j - 1, 0); y <= std::min(j + 1, height - 1) && !near; ++y) {
+                for (int x = std::max(i - 1, 0); x <= std::min(i + 1, width - 1) && !near; ++x) {
+                    near = core[static_cast<std::size_t>(y) * width + x];
+                }
+            }
+            mask[static_cast<std::size_t>(j) * width + i] = near;
+            marked += near;
+        }
+    }
+    return marked;
+}
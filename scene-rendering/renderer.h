@@ -0,0 +1,227 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <embree4/rtcore.h>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "vector3d.h"
+#include "color.h"
+#include "light.h"
+#include "camera.h"
+#include "irradiance_cache.h"
+#include "photon_map.h"
+#include "environment.h"
+#include "medium.h"
+#include "sampling.h"
+#include "render_options.h"
+
+/**
+ * @brief Counters shared by all render threads
+ */
+struct RenderStats {
+    std::atomic<std::uint64_t> primaryRays{0}; ///< Camera rays
+    std::atomic<std::uint64_t> secondaryRays{0}; ///< Reflected and refracted rays
+    std::atomic<std::uint64_t> giRays{0};      ///< Hemisphere rays for indirect diffuse lighting
+    std::atomic<std::uint64_t> causticGathers{0};   ///< Photon map lookups
+    std::atomic<std::uint64_t> causticGatherNs{0};  ///< Time spent in them, summed over threads
+    std::atomic<std::uint64_t> mediumSteps{0};      ///< Tentative collisions tracked through the medium
+    std::atomic<std::uint64_t> mediumBudgetHits{0}; ///< Camera and secondary rays that ran out of steps
+    std::atomic<std::uint64_t> depthLimitHits{0};   ///< Secondary hits not shaded because of maxDepth
+};
+
+/**
+ * @brief Everything shade() needs besides the hit itself
+ */
+struct RenderContext {
+    RTCScene scene;                        ///< Committed Embree scene
+    const std::vector<Light *> *lights;    ///< Light sources
+    GiMode gi = GiMode::Off;               ///< Indirect diffuse mode
+    int giRows = 8;                        ///< Hemisphere strata in theta (3x in phi)
+    IrradianceCache *irradianceCache = nullptr; ///< Required when gi == GiMode::Cache
+    const PhotonMap *causticMap = nullptr; ///< Caustic photons, nullptr = no caustics
+    int causticNeighbours = 64;            ///< Photons per caustic estimate
+    double causticRadius = 0.5;            ///< Maximum caustic gather radius
+    double splitThroughput = 0.25;         ///< Dielectrics trace both branches above this path weight
+    int maxDepth = 50;                     ///< Reflection and refraction bounces before a path turns black
+    bool motionBlur = false;               ///< Scene has moving geometry; rays sample the shutter interval
+    const EnvironmentMap *environment = nullptr; ///< Light from infinity and background, nullptr = black
+    int environmentSamples = 16;           ///< Importance samples of the environment per shading point
+    double missFootprint = 0.0;            ///< Angular width of a pixel; misses average the map over it
+    const Medium *medium = nullptr;        ///< Fog filling the scene, nullptr = clear air
+    int mediumSteps = 256;                 ///< Tracking steps per ray through the medium
+    RenderStats *stats = nullptr;          ///< Optional counters
+};
+
+/**
+ * @brief State carried along a ray path
+ */
+struct PathState {
+    int depth = 0;                  ///< Current recursion depth for reflections
+    double throughput = 1.0;        ///< Weight of this path in the pixel
+    bool insideDielectric = false;  ///< Whether the ray travels inside a dielectric
+    float time = 0.0f;              ///< Shutter time in [0, 1], shared by all rays of the path
+};
+
+/**
+ * @brief Trace a ray and report the closest hit
+ * @param time Shutter time in [0, 1]; places moving geometry
+ * @return true if something was hit
+ */
+bool traceRay(RTCScene scene, const Vector3D &origin, const Vector3D &direction, RTCRayHit &rayhit,
+              float time = 0.0f);
+
+/**
+ * @brief Shading function with recursive ray tracing
+ * 
+ * Computes the color at a ray-surface intersection point using the Phong
+ * reflection model and supports recursive ray tracing for reflections.
+ * With GI enabled, one bounce of indirect diffuse light is added from the
+ * irradiance cache or from brute-force hemisphere sampling; with a caustic
+ * photon map, light focused by mirrors is added from a k-nearest photon
+ * density estimate. With a participating medium, light from the lights and
+ * the environment is dimmed by the medium's transmittance, and secondary
+ * rays pick up single scattering along the way.
+ *
+ * Dielectric materials split into a reflected and a refracted ray weighted
+ * by the Fresnel reflectance. Both branches are traced while the path
+ * throughput is at least context.splitThroughput; below that, one branch is
+ * picked with probability equal to its Fresnel weight, so the ray tree
+ * stops doubling once the contribution is small. Entering and leaving is
+ * tracked in the path state rather than read from the normal, so meshes
+ * with mixed winding work.
+ * 
+ * @param rayhit Ray-surface intersection information
+ * @param context Scene, lights and GI settings
+ * @param viewDir View direction (ray direction)
+ * @param random Random numbers of the current pixel
+ * @param path Depth, throughput and medium of the ray
+ * @return Final color at the intersection point
+ */
+Color shade(const RTCRayHit &rayhit, const RenderContext &context, const Vector3D &viewDir, Random &random,
+            const PathState &path = PathState());
+
+/**
+ * @brief Sample the hemisphere above a point and build an irradiance record
+ *
+ * Stratified cosine-weighted sampling over M x 3M cells (M = giRows); each
+ * ray returns the direct lighting of the surface it hits. Fills the
+ * irradiance, the harmonic mean distance and, if gradients is set, the Ward
+ * & Heckbert rotational and translational gradients.
+ *
+ * @param point Shading point
+ * @param normal Unit normal on the side the light is gathered from
+ * @param context Scene and lights
+ * @param seed Random seed for the jitter
+ * @param time Shutter time of the gather rays
+ * @param gradients Whether to estimate gradients
+ * @param record Output record
+ */
+void sampleIrradiance(const Vector3D &point, const Vector3D &normal, const RenderContext &context,
+                      std::uint64_t seed, float time, bool gradients, IrradianceRecord &record);
+
+/**
+ * @brief Per-pixel sample budget
+ *
+ * Samples are traced in packets of kPacketSize primary rays. After
+ * minSamples, a pixel stops as soon as the standard error of its mean
+ * luminance (clamped to the displayable 0..255) drops below noiseThreshold,
+ * and at maxSamples at the latest.
+ */
+struct SamplingSettings {
+    int minSamples = 1;           ///< Samples every pixel gets
+    int maxSamples = 1;           ///< Upper bound per pixel
+    double noiseThreshold = 0.5;  ///< Target standard error, in 8-bit output units
+};
+
+/// Primary rays per packet (rtcIntersect8)
+inline constexpr int kPacketSize = 8;
+
+/**
+ * @brief Render an image, rows distributed over worker threads
+ *
+ * With one sample per pixel and a pinhole camera, one ray goes through each
+ * pixel center. Otherwise each pixel traces packets of kPacketSize rays
+ * with jittered image positions and lens samples stratified over the lens,
+ * through one rtcIntersect8 call per packet, until the budget says stop.
+ * The rays of a packet start from nearby lens points towards nearby focus
+ * points, so they stay coherent. With context.motionBlur, the rays of a
+ * packet also get stratified times over the shutter interval.
+ *
+ * With the irradiance cache, a sparse overture pass first fills the cache
+ * so that the final pass interpolates instead of following scanline order.
+ * Which records exist when a pixel looks up depends on thread timing in
+ * both passes, so with more than one thread GiMode::Cache images vary
+ * slightly from run to run; every other mode is deterministic.
+ *
+ * @param camera Camera
+ * @param context Scene, lights and GI settings
+ * @param sampling Per-pixel sample budget
+ * @param width Image width
+ * @param height Image height
+ * @param threads Worker threads, 0 = hardware concurrency
+ * @param image Output, width * height colors
+ */
+void renderImage(const Camera &camera, const RenderContext &context, const SamplingSettings &sampling, int width,
+                 int height, unsigned threads, std::vector<Color> &image);
+
+/**
+ * @brief Re-render the pixels selected by a mask, leaving the others as they are
+ *
+ * Pixels are sampled exactly as by renderImage, so a region re-rendered
+ * after an edit matches a full render of the edited scene there, up to the
+ * run-to-run variation renderImage has with GiMode::Cache.
+ *
+ * @param mask width * height flags, nonzero = render the pixel
+ * @param image Image of the previous render, updated in place
+ */
+void renderRegion(const Camera &camera, const RenderContext &context, const SamplingSettings &sampling, int width,
+                  int height, unsigned threads, const std::vector<std::uint8_t> &mask, std::vector<Color> &image);
+
+/**
+ * @brief Render the pixels of a rectangle on the calling thread
+ *
+ * Pixels are sampled exactly as by renderImage. Nothing fills the
+ * irradiance cache ahead, so with GiMode::Cache the result depends on which
+ * tiles were rendered before.
+ *
+ * @param x0 First column
+ * @param y0 First row
+ * @param x1 Column past the last
+ * @param y1 Row past the last
+ * @param image width * height colors; only the rectangle is written
+ * @return Camera rays traced for the tile
+ */
+std::uint64_t renderTile(const Camera &camera, const RenderContext &context, const SamplingSettings &sampling,
+                         int width, int height, int x0, int y0, int x1, int y1, Color *image);
+
+/**
+ * @brief G-buffer of the geometry seen through each pixel
+ *
+ * One ray per pixel center from the eye, unshaded; costs a small fraction
+ * of a render.
+ *
+ * @param ids Receives width * height geometry IDs, RTC_INVALID_GEOMETRY_ID where the ray leaves the scene
+ */
+void traceGeometryIds(const Camera &camera, RTCScene scene, int width, int height, unsigned threads,
+                      std::vector<unsigned> &ids);
+
+/**
+ * @brief Pixels an edit of some geometries changes directly
+ *
+ * A pixel is marked where one of the geometries is visible before or after
+ * the edit, or where the visible geometry differs. The marks are widened by
+ * one pixel, which covers the samples that land next to an edge. Shadows
+ * and reflections of the geometries elsewhere are not covered.
+ *
+ * @param before G-buffer of traceGeometryIds before the edit
+ * @param after G-buffer after the edit
+ * @param changed IDs of the edited geometries
+ * @param mask Receives width * height flags
+ * @return Number of marked pixels
+ */
+std::size_t markChangedPixels(const std::vector<unsigned> &before, const std::vector<unsigned> &after,
+                              const std::vector<unsigned> &changed, int width, int height,
+                              std::vector<std::uint8_t> &mask);
+
+#endif // RENDERER_H
@@ -0,0 +1,56 @@
+#ifndef SAMPLING_H
+#define SAMPLING_H
+
+#include <cmath>
+#include <cstdint>
+#include "vector3d.h"
+
+/**
+ * @brief Mix two 64-bit values into a well-distributed seed (SplitMix64 finaliser)
+ */
+inline std::uint64_t hashSeed(std::uint64_t a, std::uint64_t b = 0) {
+    std::uint64_t z = a * 0x9E3779B97F4A7C15ull + b + 0x632BE59BD9B4E019ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+/**
+ * @brief Small deterministic random number generator (PCG32)
+ *
+ * Seeded per pixel / per sample from hashSeed, so images do not depend on
+ * thread scheduling.
+ */
+class Random {
+public:
+    explicit Random(std::uint64_t seed = 0) : state(hashSeed(seed)) {
+    }
+
+    std::uint32_t nextUInt() {
+        std::uint64_t old = state;
+        state = old * 6364136223846793005ull + 1442695040888963407ull;
+        std::uint32_t xorshifted = static_cast<std::uint32_t>(((old >> 18u) ^ old) >> 27u);
+        std::uint32_t rot = static_cast<std::uint32_t>(old >> 59u);
+        return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+    }
+
+    /// Uniform double in [0, 1)
+    double nextDouble() { return nextUInt() * (1.0 / 4294967296.0); }
+
+private:
+    std::uint64_t state;
+};
+
+/**
+ * @brief Build an orthonormal basis (t, b, n) around a unit normal
+ */
+inline void buildBasis(const Vector3D &n, Vector3D &t, Vector3D &b) {
+    // Duff et al. 2017, branchless except for the sign
+    double sign = std::copysign(1.0, n.z);
+    double a = -1.0 / (sign + n.z);
+    double c = n.x * n.y * a;
+    t = Vector3D(1.0 + sign * n.x * n.x * a, sign * c, -sign * n.x);
+    b = Vector3D(c, sign + n.y * n.y * a, -n.y);
+}
+
+#endif // SAMPLING_H
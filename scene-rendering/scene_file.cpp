@@ -0,0 +1,146 @@
+#include "scene_file.h"
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+bool sameColor(const Color &a, const Color &b) {
+    return a.r == b.r && a.g == b.g && a.b == b.b;
+}
+
+bool sameVector(const Vector3D &a, const Vector3D &b) {
+    return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+bool sameMaterial(const Material &a, const Material &b) {
+    return sameColor(a.color, b.color) && a.diffuse == b.diffuse && a.specular == b.specular &&
+           a.exponent == b.exponent && sameColor(a.specular_color, b.specular_color) &&
+           a.reflectivity == b.reflectivity && a.transparency == b.transparency && a.ior == b.ior &&
+           a.model == b.model;
+}
+
+// Read count finite numbers
+bool readNumbers(std::istringstream &tokens, double *values, int count) {
+    for (int k = 0; k < count; ++k) {
+        if (!(tokens >> values[k]) || !std::isfinite(values[k])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+bool loadSceneFile(const std::string &path, const SceneState &defaults, SceneState &state, std::string &error) {
+    std::ifstream file(path);
+    if (!file) {
+        error = "не удалось открыть " + path;
+        return false;
+    }
+    state = defaults;
+    std::vector<LightSpec> lights;
+    std::string line;
+    int number = 0;
+    while (std::getline(file, line)) {
+        ++number;
+        std::istringstream tokens(line.substr(0, line.find('#')));
+        std::string keyword;
+        if (!(tokens >> keyword)) {
+            continue;
+        }
+        const std::string where = "строка " + std::to_string(number) + ": ";
+        std::string name;
+        if (keyword == "material" || keyword == "offset") {
+            if (!(tokens >> name) || !defaults.materials.count(name)) {
+                error = where + "неизвестный объект \"" + name + "\"";
+                return false;
+            }
+        }
+        double v[9];
+        if (keyword == "material") {
+            if (!readNumbers(tokens, v, 7)) {
+                error = where + "ожидается material <объект> <r> <g> <b> <diffuse> <specular> <exponent> "
+                                "<reflectivity> [<transparency> <ior>]";
+                return false;
+            }
+            Material &material = state.materials[name];
+            material.color = Color(v[0], v[1], v[2]);
+            material.diffuse = v[3];
+            material.specular = v[4];
+            material.exponent = v[5];
+            material.reflectivity = v[6];
+            if (!(tokens >> std::ws).eof()) {
+                if (!readNumbers(tokens, v + 7, 2) || v[7] < 0.0 || v[7] > 1.0 || v[8] <= 0.0) {
+                    error = where + "прозрачность должна быть в [0, 1], а показатель преломления положительным";
+                    return false;
+                }
+                material.transparency = v[7];
+                material.ior = v[8];
+            }
+        } else if (keyword == "offset") {
+            if (!readNumbers(tokens, v, 3)) {
+                error = where + "ожидается offset <объект> <dx> <dy> <dz>";
+                return false;
+            }
+            state.offsets[name] = Vector3D(v[0], v[1], v[2]);
+        } else if (keyword == "light") {
+            std::string type;
+            tokens >> type;
+            if ((type != "point" && type != "directional") || !readNumbers(tokens, v, 6)) {
+                error = where + "ожидается light point|directional <x> <y> <z> <r> <g> <b>";
+                return false;
+            }
+            LightSpec light;
+            light.directional = type == "directional";
+            light.vector = Vector3D(v[0], v[1], v[2]);
+            light.intensity = Color(v[3], v[4], v[5]);
+            if (light.directional && light.vector.norm() == 0.0) {
+                error = where + "нулевое направление света";
+                return false;
+            }
+            lights.push_back(light);
+        } else {
+            error = where + "неизвестная команда \"" + keyword + "\"";
+            return false;
+        }
+        if (!(tokens >> std::ws).eof()) {
+            error = where + "лишние символы в конце строки";
+            return false;
+        }
+    }
+    if (!lights.empty()) {
+        state.lights = std::move(lights);
+    }
+    return true;
+}
+
+SceneDiff diffScenes(const SceneState &resident, const SceneState &loaded) {
+    SceneDiff diff;
+    for (const auto &[name, material]: loaded.materials) {
+        const auto old = resident.materials.find(name);
+        if (old == resident.materials.end() || !sameMaterial(old->second, material)) {
+            diff.materials.push_back(name);
+        }
+    }
+    for (const auto &[name, offset]: loaded.offsets) {
+        const auto old = resident.offsets.find(name);
+        if (old == resident.offsets.end() || !sameVector(old->second, offset)) {
+            diff.moved.push_back(name);
+        }
+    }
+    diff.lights = resident.lights.size() != loaded.lights.size();
+    for (std::size_t k = 0; k < loaded.lights.size() && !diff.lights; ++k) {
+        const LightSpec &a = resident.lights[k], &b = loaded.lights[k];
+        diff.lights = a.directional != b.directional || !sameVector(a.vector, b.vector) ||
+                      !sameColor(a.intensity, b.intensity);
+    }
+    return diff;
+}
+
+std::unique_ptr<Light> createLight(const LightSpec &spec) {
+    if (spec.directional) {
+        return std::make_unique<DirectionalLight>(spec.vector, spec.intensity);
+    }
+    return std::make_unique<PointLight>(spec.vector, spec.intensity);
+}
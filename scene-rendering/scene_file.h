@@ -0,0 +1,74 @@
+#ifndef SCENE_FILE_H
+#define SCENE_FILE_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "vector3d.h"
+#include "color.h"
+#include "material.h"
+#include "light.h"
+
+/**
+ * @brief A point or directional light as written in a scene file
+ */
+struct LightSpec {
+    bool directional = false;  ///< Directional (vector is the direction) or point (vector is the position)
+    Vector3D vector;
+    Color intensity;
+};
+
+/**
+ * @brief Editable state of the built-in scene: materials and offsets of the
+ * named objects, and the lights
+ */
+struct SceneState {
+    std::map<std::string, Material> materials;  ///< Material of each named object
+    std::map<std::string, Vector3D> offsets;    ///< Translation of each named object from where it was built
+    std::vector<LightSpec> lights;
+};
+
+/**
+ * @brief What differs between two scene states
+ */
+struct SceneDiff {
+    std::vector<std::string> materials;  ///< Objects whose material changed
+    std::vector<std::string> moved;      ///< Objects whose offset changed
+    bool lights = false;                 ///< Lights were added, removed or changed
+
+    bool empty() const { return materials.empty() && moved.empty() && !lights; }
+};
+
+/**
+ * @brief Read a scene file on top of the built-in scene
+ *
+ * One statement per line, '#' starts a comment:
+ *
+ *     material <object> <r> <g> <b> <diffuse> <specular> <exponent> <reflectivity> [<transparency> <ior>]
+ *     offset <object> <dx> <dy> <dz>
+ *     light point <x> <y> <z> <r> <g> <b>
+ *     light directional <dx> <dy> <dz> <r> <g> <b>
+ *
+ * Objects are those named in defaults. What the file does not mention keeps
+ * its default; if the file has any light, its lights replace the defaults.
+ *
+ * @param path File to read
+ * @param defaults Built-in scene
+ * @param state Receives the scene with the file applied
+ * @param error Receives the line and description of the problem
+ * @return false if the file cannot be read or has an error
+ */
+bool loadSceneFile(const std::string &path, const SceneState &defaults, SceneState &state, std::string &error);
+
+/**
+ * @brief Compare the resident scene with a reloaded one
+ */
+SceneDiff diffScenes(const SceneState &resident, const SceneState &loaded);
+
+/**
+ * @brief Create the light a spec describes
+ */
+std::unique_ptr<Light> createLight(const LightSpec &spec);
+
+#endif // SCENE_FILE_H
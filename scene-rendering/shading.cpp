@@ -0,0 +1,114 @@
+#include "shading.h"
+#include <algorithm>
+#include <cmath>
+#include "cpu_dispatch.h"
+
+namespace {
+
+// Phong lighting kernel body, compiled once per instruction set
+KERNEL_INLINE Color accumulatePhongBody(const LightSample *samples, const std::size_t count, const Vector3D &normal,
+                                        const Vector3D &viewDir, const Material &material) {
+    Color totalColor(0, 0, 0);
+    for (std::size_t i = 0; i < count; ++i) {
+        const Vector3D &L = samples[i].direction;
+        Vector3D H = (viewDir + L).normalized();
+        double NdotL = std::max(0.0, normal.dot(L));
+        double HdotN = std::max(0.0, H.dot(normal));
+        Color diffuse = material.color * material.diffuse * NdotL;
+        Color specular = material.specular_color * material.specular * std::pow(HdotN, material.exponent);
+        Color contribution = (diffuse + specular) * samples[i].intensity * samples[i].attenuation;
+        totalColor = totalColor + contribution;
+    }
+    return totalColor;
+}
+
+// Clamp in floating point before the conversion so out-of-range values stay defined
+KERNEL_INLINE std::uint8_t toByte(const double value) {
+    return static_cast<std::uint8_t>(std::min(255.0, std::max(0.0, value)));
+}
+
+// Tonemap kernel body, compiled once per instruction set
+KERNEL_INLINE void tonemapBody(const Color *image, const std::size_t count, const double scale, std::uint8_t *rgb) {
+    for (std::size_t i = 0; i < count; ++i) {
+        rgb[3 * i] = toByte(image[i].r * scale);
+        rgb[3 * i + 1] = toByte(image[i].g * scale);
+        rgb[3 * i + 2] = toByte(image[i].b * scale);
+    }
+}
+
+using PhongFn = Color (*)(const LightSample *, std::size_t, const Vector3D &, const Vector3D &, const Material &);
+using TonemapFn = void (*)(const Color *, std::size_t, double, std::uint8_t *);
+
+Color accumulatePhongBaseline(const LightSample *samples, std::size_t count, const Vector3D &normal,
+                              const Vector3D &viewDir, const Material &material) {
+    return accumulatePhongBody(samples, count, normal, viewDir, material);
+}
+
+void tonemapBaseline(const Color *image, std::size_t count, double scale, std::uint8_t *rgb) {
+    tonemapBody(image, count, scale, rgb);
+}
+
+#if CPU_DISPATCH_X86
+TARGET_SSE4 Color accumulatePhongSse4(const LightSample *samples, std::size_t count, const Vector3D &normal,
+                                      const Vector3D &viewDir, const Material &material) {
+    return accumulatePhongBody(samples, count, normal, viewDir, material);
+}
+
+TARGET_AVX2 Color accumulatePhongAvx2(const LightSample *samples, std::size_t count, const Vector3D &normal,
+                                      const Vector3D &viewDir, const Material &material) {
+    return accumulatePhongBody(samples, count, normal, viewDir, material);
+}
+
+TARGET_AVX512 Color accumulatePhongAvx512(const LightSample *samples, std::size_t count, const Vector3D &normal,
+                                          const Vector3D &viewDir, const Material &material) {
+    return accumulatePhongBody(samples, count, normal, viewDir, material);
+}
+
+TARGET_SSE4 void tonemapSse4(const Color *image, std::size_t count, double scale, std::uint8_t *rgb) {
+    tonemapBody(image, count, scale, rgb);
+}
+
+TARGET_AVX2 void tonemapAvx2(const Color *image, std::size_t count, double scale, std::uint8_t *rgb) {
+    tonemapBody(image, count, scale, rgb);
+}
+
+TARGET_AVX512 void tonemapAvx512(const Color *image, std::size_t count, double scale, std::uint8_t *rgb) {
+    tonemapBody(image, count, scale, rgb);
+}
+
+constexpr DispatchTable<PhongFn> kAccumulatePhong{
+    accumulatePhongBaseline, accumulatePhongSse4, accumulatePhongAvx2, accumulatePhongAvx512};
+constexpr DispatchTable<TonemapFn> kTonemap{tonemapBaseline, tonemapSse4, tonemapAvx2, tonemapAvx512};
+#else
+constexpr DispatchTable<PhongFn> kAccumulatePhong{accumulatePhongBaseline, nullptr, nullptr, nullptr};
+constexpr DispatchTable<TonemapFn> kTonemap{tonemapBaseline, nullptr, nullptr, nullptr};
+#endif
+
+} // namespace
+
+Color accumulatePhong(const LightSample *samples, const std::size_t count, const Vector3D &normal,
+                      const Vector3D &viewDir, const Material &material) {
+    return kAccumulatePhong.select()(samples, count, normal, viewDir, material);
+}
+
+void tonemapToRgb8(const Color *image, const std::size_t count, const double scale, std::uint8_t *rgb) {
+    kTonemap.select()(image, count, scale, rgb);
+}
+
+Color accumulateStrand(const LightSample *samples, const std::size_t count, const Vector3D &tangent,
+                       const Vector3D &viewDir, const Material &material) {
+    // The eye looks back along viewDir, so cos(tangent, eye) = -tangent.viewDir
+    const double TdotV = tangent.dot(viewDir);
+    const double sinTV = std::sqrt(std::max(0.0, 1.0 - TdotV * TdotV));
+    Color totalColor(0, 0, 0);
+    for (std::size_t i = 0; i < count; ++i) {
+        const double TdotL = tangent.dot(samples[i].direction);
+        const double sinTL = std::sqrt(std::max(0.0, 1.0 - TdotL * TdotL));
+        // Light reflected off a cylinder keeps its tangential component: cos(mirror cone - eye angle)
+        const double cone = std::max(0.0, sinTL * sinTV + TdotL * TdotV);
+        Color diffuse = material.color * material.diffuse * sinTL;
+        Color specular = material.specular_color * material.specular * std::pow(cone, material.exponent);
+        totalColor = totalColor + (diffuse + specular) * samples[i].intensity * samples[i].attenuation;
+    }
+    return totalColor;
+}
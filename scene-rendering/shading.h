@@ -0,0 +1,66 @@
+#ifndef SHADING_H
+#define SHADING_H
+
+#include <cstddef>
+#include <cstdint>
+#include "vector3d.h"
+#include "color.h"
+#include "material.h"
+
+/**
+ * @brief Unoccluded light as seen from a shading point
+ */
+struct LightSample {
+    Vector3D direction;  ///< Normalized direction from the point to the light
+    Color intensity;     ///< Light intensity
+    double attenuation;  ///< Attenuation at the point
+};
+
+/**
+ * @brief Sum of the Phong diffuse and specular contributions of several lights
+ *
+ * Runtime-dispatched to the best kernel variant for this CPU (see
+ * cpu_dispatch.h).
+ *
+ * @param samples Visible lights at the point
+ * @param count Number of samples
+ * @param normal Normalized surface normal
+ * @param viewDir View direction (ray direction)
+ * @param material Surface material
+ * @return Direct lighting at the point
+ */
+Color accumulatePhong(const LightSample *samples, std::size_t count, const Vector3D &normal,
+                      const Vector3D &viewDir, const Material &material);
+
+/**
+ * @brief Sum of the Kajiya-Kay strand contributions of several lights
+ *
+ * A thin fibre has no single normal: it reflects into a cone around its
+ * tangent. The diffuse term is proportional to the sine between the
+ * tangent and the light; the specular term peaks where the view direction
+ * lies on the cone of mirror directions of the light (Kajiya & Kay 1989).
+ *
+ * @param samples Visible lights at the point
+ * @param count Number of samples
+ * @param tangent Normalized direction along the strand
+ * @param viewDir View direction (ray direction)
+ * @param material Strand material
+ * @return Direct lighting at the point
+ */
+Color accumulateStrand(const LightSample *samples, std::size_t count, const Vector3D &tangent,
+                       const Vector3D &viewDir, const Material &material);
+
+/**
+ * @brief Convert linear colors to 8-bit RGB
+ *
+ * Each channel is multiplied by scale, clamped to [0, 255] and truncated.
+ * Runtime-dispatched to the best kernel variant for this CPU.
+ *
+ * @param image Input colors
+ * @param count Number of pixels
+ * @param scale Exposure scale
+ * @param rgb Output, 3 * count bytes
+ */
+void tonemapToRgb8(const Color *image, std::size_t count, double scale, std::uint8_t *rgb);
+
+#endif // SHADING_H
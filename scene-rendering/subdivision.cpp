@@ -0,0 +1,158 @@
+#include "subdivision.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <map>
+
+namespace {
+
+// Tessellation cache bytes per grid vertex: position, uv and the share of
+// the grid's bounding boxes
+constexpr double kBytesPerGridVertex = 32.0;
+
+// Signed distance of a camera-space point from a side plane of the view
+// pyramid through the eye, positive outside
+double outsideSide(double lateral, double depth, double distance, double halfExtent) {
+    return (lateral * distance - depth * halfExtent) / std::sqrt(distance * distance + halfExtent * halfExtent);
+}
+
+} // namespace
+
+SubdivisionMesh makeCubeCage(const Vector3D &center, double halfSize, int segments) {
+    SubdivisionMesh mesh;
+    std::map<std::array<int, 3>, unsigned> vertexIndex;
+    auto vertex = [&](const std::array<int, 3> &grid) {
+        const auto it = vertexIndex.find(grid);
+        if (it != vertexIndex.end()) {
+            return it->second;
+        }
+        const unsigned index = static_cast<unsigned>(mesh.vertexCount());
+        for (int axis = 0; axis < 3; ++axis) {
+            const double offset = (2.0 * grid[axis] / segments - 1.0) * halfSize;
+            const double base = axis == 0 ? center.x : axis == 1 ? center.y : center.z;
+            mesh.vertices.push_back(static_cast<float>(base + offset));
+        }
+        vertexIndex.emplace(grid, index);
+        return index;
+    };
+
+    for (int axis = 0; axis < 3; ++axis) {
+        // (axis, b, c) is right-handed, so u along b and v along c turn counter-clockwise about +axis
+        const int b = (axis + 1) % 3, c = (axis + 2) % 3;
+        for (int side: {0, segments}) {
+            for (int v = 0; v < segments; ++v) {
+                for (int u = 0; u < segments; ++u) {
+                    std::array<std::array<int, 3>, 4> corners;
+                    const int cornerUV[4][2] = {{u, v}, {u + 1, v}, {u + 1, v + 1}, {u, v + 1}};
+                    for (int k = 0; k < 4; ++k) {
+                        corners[k][axis] = side;
+                        corners[k][b] = cornerUV[k][0];
+                        corners[k][c] = cornerUV[k][1];
+                    }
+                    if (side == 0) {
+                        std::reverse(corners.begin(), corners.end()); // Face looks along -axis
+                    }
+                    for (const auto &corner: corners) {
+                        mesh.indices.push_back(vertex(corner));
+                    }
+                    mesh.faceSizes.push_back(4);
+                }
+            }
+        }
+    }
+    return mesh;
+}
+
+std::vector<float> computeEdgeLevels(const SubdivisionMesh &mesh, const Camera &camera, int imageWidth,
+                                     double pixelsPerSegment) {
+    const Vector3D view = (camera.center - camera.eye).normalized();
+    const Vector3D right = view.cross(camera.up).normalized();
+    const Vector3D actualUp = right.cross(view).normalized();
+    const double halfWidth = camera.screen_width / 2;
+    const double halfHeight = camera.screen_height / 2;
+    auto position = [&](unsigned v) {
+        return Vector3D(mesh.vertices[3 * v], mesh.vertices[3 * v + 1], mesh.vertices[3 * v + 2]);
+    };
+
+    std::vector<float> levels(mesh.edgeCount(), 1.0f);
+    std::size_t offset = 0;
+    for (const unsigned size: mesh.faceSizes) {
+        for (unsigned k = 0; k < size; ++k) {
+            const Vector3D a = position(mesh.indices[offset + k]);
+            const Vector3D b = position(mesh.indices[offset + (k + 1) % size]);
+            const double radius = (b - a).norm() / 2;
+            const Vector3D relative = (a + b) * 0.5 - camera.eye;
+            const double depth = relative.dot(view);
+            const double x = relative.dot(right);
+            const double y = relative.dot(actualUp);
+            const bool visible = depth > -radius &&
+                                 outsideSide(x, depth, camera.distance, halfWidth) < radius &&
+                                 outsideSide(-x, depth, camera.distance, halfWidth) < radius &&
+                                 outsideSide(y, depth, camera.distance, halfHeight) < radius &&
+                                 outsideSide(-y, depth, camera.distance, halfHeight) < radius;
+            if (visible) {
+                const double nearest = std::max(depth - radius, 1e-3);
+                const double pixels = 2 * radius * camera.distance / nearest * imageWidth / camera.screen_width;
+                levels[offset + k] = static_cast<float>(std::clamp(pixels / pixelsPerSegment, 1.0,
+                                                                   static_cast<double>(kMaxEdgeLevel)));
+            }
+        }
+        offset += size;
+    }
+    return levels;
+}
+
+std::size_t estimateTessellationBytes(const SubdivisionMesh &mesh, const std::vector<float> &levels) {
+    double vertices = 0.0;
+    std::size_t offset = 0;
+    for (const unsigned size: mesh.faceSizes) {
+        const float *edge = levels.data() + offset;
+        if (size == 4) {
+            vertices += (std::ceil(std::max(edge[0], edge[2])) + 1.0) * (std::ceil(std::max(edge[1], edge[3])) + 1.0);
+        } else {
+            const float largest = *std::max_element(edge, edge + size);
+            const double side = std::ceil(largest / 2.0) + 1.0;
+            vertices += size * side * side;
+        }
+        offset += size;
+    }
+    return static_cast<std::size_t>(vertices * kBytesPerGridVertex);
+}
+
+std::size_t fitTessellationBudget(const SubdivisionMesh &mesh, std::vector<float> &levels, std::size_t budgetBytes) {
+    std::size_t estimate = estimateTessellationBytes(mesh, levels);
+    // Levels clamped at 1 do not shrink, so a few rounds may be needed
+    for (int round = 0; round < 8 && estimate > budgetBytes; ++round) {
+        const double scale = std::sqrt(static_cast<double>(budgetBytes) / estimate);
+        bool changed = false;
+        for (float &level: levels) {
+            const float scaled = std::max(1.0f, static_cast<float>(level * scale));
+            changed |= scaled != level;
+            level = scaled;
+        }
+        if (!changed) {
+            break; // Everything is at level 1 already
+        }
+        estimate = estimateTessellationBytes(mesh, levels);
+    }
+    return estimate;
+}
+
+RTCGeometry createSubdivisionGeometry(RTCDevice device, const SubdivisionMesh &mesh,
+                                      const std::vector<float> &levels) {
+    RTCGeometry geometry = rtcNewGeometry(device, RTC_GEOMETRY_TYPE_SUBDIVISION);
+    auto *vertices = static_cast<float *>(rtcSetNewGeometryBuffer(
+        geometry, RTC_BUFFER_TYPE_VERTEX, 0, RTC_FORMAT_FLOAT3, 3 * sizeof(float), mesh.vertexCount()));
+    auto *faces = static_cast<unsigned *>(rtcSetNewGeometryBuffer(
+        geometry, RTC_BUFFER_TYPE_FACE, 0, RTC_FORMAT_UINT, sizeof(unsigned), mesh.faceCount()));
+    auto *indices = static_cast<unsigned *>(rtcSetNewGeometryBuffer(
+        geometry, RTC_BUFFER_TYPE_INDEX, 0, RTC_FORMAT_UINT, sizeof(unsigned), mesh.edgeCount()));
+    auto *edgeLevels = static_cast<float *>(rtcSetNewGeometryBuffer(
+        geometry, RTC_BUFFER_TYPE_LEVEL, 0, RTC_FORMAT_FLOAT, sizeof(float), mesh.edgeCount()));
+    std::copy(mesh.vertices.begin(), mesh.vertices.end(), vertices);
+    std::copy(mesh.faceSizes.begin(), mesh.faceSizes.end(), faces);
+    std::copy(mesh.indices.begin(), mesh.indices.end(), indices);
+    std::copy(levels.begin(), levels.end(), edgeLevels);
+    rtcCommitGeometry(geometry);
+    return geometry;
+}
@@ -0,0 +1,95 @@
+#ifndef SUBDIVISION_H
+#define SUBDIVISION_H
+
+#include <embree4/rtcore.h>
+#include <cstddef>
+#include <vector>
+#include "vector3d.h"
+#include "camera.h"
+
+/**
+ * @brief Control cage of a Catmull-Clark subdivision surface
+ *
+ * Faces may have any number of vertices; the layout is that of Embree's
+ * subdivision buffers. Edge k of a face runs from its vertex k to vertex
+ * k + 1, so there is one edge per entry of indices.
+ */
+struct SubdivisionMesh {
+    std::vector<float> vertices;      ///< x, y, z per control vertex (RTC_FORMAT_FLOAT3)
+    std::vector<unsigned> faceSizes;  ///< Vertices per face (RTC_BUFFER_TYPE_FACE)
+    std::vector<unsigned> indices;    ///< Vertex indices of all faces in order (RTC_BUFFER_TYPE_INDEX)
+
+    std::size_t vertexCount() const { return vertices.size() / 3; }
+
+    std::size_t faceCount() const { return faceSizes.size(); }
+
+    /// Edges counted once per face, the length of the level buffer
+    std::size_t edgeCount() const { return indices.size(); }
+};
+
+/**
+ * @brief Cube cage with every side split into segments x segments quads
+ *
+ * Faces are counter-clockwise seen from outside. Its limit surface is a
+ * smooth rounded blob, somewhat smaller than the cage.
+ */
+SubdivisionMesh makeCubeCage(const Vector3D &center, double halfSize, int segments);
+
+/**
+ * @brief Tessellation level of every edge from its size on screen
+ *
+ * An edge is bounded by the sphere around its midpoint through its
+ * endpoints. If that sphere is outside the view pyramid the edge gets level
+ * 1; otherwise its length is projected at the depth of the sphere's nearest
+ * point and divided into segments of pixelsPerSegment pixels. The level
+ * depends only on the two endpoints, so both faces of an edge agree on it
+ * and the tessellation has no cracks.
+ *
+ * @param mesh Control cage
+ * @param camera Camera the image is rendered from
+ * @param imageWidth Image width in pixels
+ * @param pixelsPerSegment Target length of a tessellated segment in pixels
+ * @return One level per edge, in [1, kMaxEdgeLevel]
+ */
+std::vector<float> computeEdgeLevels(const SubdivisionMesh &mesh, const Camera &camera, int imageWidth,
+                                     double pixelsPerSegment);
+
+/// Highest tessellation level computeEdgeLevels() assigns
+constexpr float kMaxEdgeLevel = 64.0f;
+
+/**
+ * @brief Estimated tessellation cache bytes of a cage with these edge levels
+ *
+ * A quad becomes a grid with one row of vertices more than its larger
+ * opposite edge level in each direction; other faces are split into one
+ * quad per vertex at half the level first, as Embree does.
+ */
+std::size_t estimateTessellationBytes(const SubdivisionMesh &mesh, const std::vector<float> &levels);
+
+/**
+ * @brief Scale the edge levels down until the tessellation fits a budget
+ *
+ * The grid size of a face grows with the square of its levels, so all
+ * levels are scaled by the square root of budget / estimate, never below
+ * 1, until the estimate fits. Relative detail between edges is kept: what
+ * is large on screen stays finer than what is small or off screen.
+ *
+ * @param mesh Control cage
+ * @param levels Edge levels, scaled in place
+ * @param budgetBytes Tessellation cache size
+ * @return Estimated bytes after scaling
+ */
+std::size_t fitTessellationBudget(const SubdivisionMesh &mesh, std::vector<float> &levels, std::size_t budgetBytes);
+
+/**
+ * @brief Create an Embree Catmull-Clark subdivision geometry
+ *
+ * Copies the cage and the edge levels into Embree buffers and commits the
+ * geometry; the caller attaches it and sets its user data. Embree
+ * tessellates patches lazily into its tessellation cache when rays reach
+ * them.
+ */
+RTCGeometry createSubdivisionGeometry(RTCDevice device, const SubdivisionMesh &mesh,
+                                      const std::vector<float> &levels);
+
+#endif // SUBDIVISION_H
@@ -0,0 +1,35 @@
+#ifndef VECTOR3D_H
+#define VECTOR3D_H
+
+#include <cmath>
+
+/**
+ * @brief 3D Vector class for geometric operations
+ * Provides basic vector arithmetic and operations for 3D graphics
+ */
+class Vector3D {
+public:
+    double x, y, z;
+
+    Vector3D(double x_ = 0, double y_ = 0, double z_ = 0) : x(x_), y(y_), z(z_) {
+    }
+
+    Vector3D operator+(const Vector3D &other) const { return Vector3D(x + other.x, y + other.y, z + other.z); }
+    Vector3D operator-(const Vector3D &other) const { return Vector3D(x - other.x, y - other.y, z - other.z); }
+    Vector3D operator*(double scalar) const { return Vector3D(x * scalar, y * scalar, z * scalar); }
+    Vector3D operator-() const { return Vector3D(-x, -y, -z); }
+    double dot(const Vector3D &other) const { return x * other.x + y * other.y + z * other.z; }
+
+    Vector3D cross(const Vector3D &other) const {
+        return Vector3D(y * other.z - z * other.y, z * other.x - x * other.z, x * other.y - y * other.x);
+    }
+
+    double norm() const { return std::sqrt(x * x + y * y + z * z); }
+
+    Vector3D normalized() const {
+        double n = norm();
+        return n > 0 ? *this * (1.0 / n) : *this;
+    }
+};
+
+#endif // VECTOR3D_H